@@ -0,0 +1,194 @@
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+package aio
+
+import (
+	"errors"
+	"fmt"
+	"io"
+	"os"
+	"sync"
+	"sync/atomic"
+)
+
+// OpType is the I/O request type.
+type OpType int
+
+const (
+	// OpRead reads len(Buf) bytes at Offset.
+	OpRead OpType = iota
+	// OpWrite writes Buf at Offset.
+	OpWrite
+	// OpDiscard discards Length bytes at Offset of a block device.
+	OpDiscard
+)
+
+// Op is a single I/O request.
+//
+// N and Err are set once the request completes.
+//
+//nolint:govet
+type Op struct {
+	File   *os.File
+	Buf    []byte
+	Offset int64
+	Length int64
+	Type   OpType
+
+	N   int
+	Err error
+
+	// eof is set by the engine on a zero-length read
+	eof bool
+}
+
+// Engine executes batches of I/O requests.
+type Engine interface {
+	// Submit issues all requests and waits for their completion.
+	//
+	// The errors of the individual requests are reported in Op.Err, see Err.
+	Submit(ops []Op) error
+	// Close releases the engine.
+	Close() error
+}
+
+// Options is the functional options struct.
+type Options struct {
+	QueueDepth int
+	Sync       bool
+}
+
+// Option is the functional option func.
+type Option func(*Options)
+
+// WithQueueDepth sets the maximum number of requests in flight.
+func WithQueueDepth(value int) Option {
+	return func(args *Options) {
+		args.QueueDepth = value
+	}
+}
+
+// WithSync forces the synchronous engine.
+func WithSync(value bool) Option {
+	return func(args *Options) {
+		args.Sync = value
+	}
+}
+
+// NewDefaultOptions initializes a Options struct with default values.
+func NewDefaultOptions(setters ...Option) *Options {
+	opts := &Options{
+		QueueDepth: 64,
+	}
+
+	for _, setter := range setters {
+		setter(opts)
+	}
+
+	if opts.QueueDepth < 1 {
+		opts.QueueDepth = 1
+	}
+
+	return opts
+}
+
+// New returns the best engine supported by the system.
+func New(setters ...Option) Engine { //nolint:ireturn
+	opts := NewDefaultOptions(setters...)
+
+	if !opts.Sync {
+		if e, err := newURing(opts.QueueDepth); err == nil {
+			return e
+		}
+	}
+
+	return NewSync(opts.QueueDepth)
+}
+
+// Err returns the first error of the requests.
+//
+// Short reads are reported as io.ErrUnexpectedEOF.
+func Err(ops []Op) error {
+	for i := range ops {
+		if ops[i].Err != nil {
+			return ops[i].Err
+		}
+
+		if ops[i].Type != OpDiscard && ops[i].N < len(ops[i].Buf) {
+			return io.ErrUnexpectedEOF
+		}
+	}
+
+	return nil
+}
+
+// syncEngine issues the requests with the blocking syscalls from a pool of goroutines.
+type syncEngine struct {
+	depth int
+}
+
+// NewSync returns the engine which issues requests synchronously, up to depth at a time.
+func NewSync(depth int) Engine { //nolint:ireturn
+	if depth < 1 {
+		depth = 1
+	}
+
+	return &syncEngine{depth: depth}
+}
+
+// Submit implements Engine.
+func (e *syncEngine) Submit(ops []Op) error {
+	workers := e.depth
+	if workers > len(ops) {
+		workers = len(ops)
+	}
+
+	var (
+		wg   sync.WaitGroup
+		next atomic.Int32
+	)
+
+	for i := 0; i < workers; i++ {
+		wg.Add(1)
+
+		go func() {
+			defer wg.Done()
+
+			for {
+				idx := int(next.Add(1)) - 1
+				if idx >= len(ops) {
+					return
+				}
+
+				execSync(&ops[idx])
+			}
+		}()
+	}
+
+	wg.Wait()
+
+	return nil
+}
+
+// Close implements Engine.
+func (e *syncEngine) Close() error {
+	return nil
+}
+
+func execSync(op *Op) {
+	switch op.Type {
+	case OpRead:
+		op.N, op.Err = op.File.ReadAt(op.Buf, op.Offset)
+		if errors.Is(op.Err, io.EOF) {
+			op.Err = nil
+		}
+	case OpWrite:
+		op.N, op.Err = op.File.WriteAt(op.Buf, op.Offset)
+	case OpDiscard:
+		op.Err = discard(op.File, op.Offset, op.Length)
+	default:
+		op.Err = fmt.Errorf("unknown op type %d", op.Type)
+	}
+}
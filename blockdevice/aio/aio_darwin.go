@@ -0,0 +1,18 @@
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+package aio
+
+import (
+	"fmt"
+	"os"
+)
+
+func newURing(depth int) (Engine, error) { //nolint:ireturn
+	return nil, fmt.Errorf("not implemented")
+}
+
+func discard(f *os.File, off, length int64) error {
+	return fmt.Errorf("not implemented")
+}
@@ -0,0 +1,410 @@
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+package aio
+
+import (
+	"errors"
+	"fmt"
+	"io"
+	"os"
+	"runtime"
+	"sync"
+	"sync/atomic"
+	"unsafe"
+
+	"golang.org/x/sys/unix"
+)
+
+// io_uring ABI, see include/uapi/linux/io_uring.h.
+const (
+	sysIOURingSetup = 425
+	sysIOURingEnter = 426
+
+	ioringOffSQRing = 0
+	ioringOffCQRing = 0x8000000
+	ioringOffSQEs   = 0x10000000
+
+	ioringFeatSingleMmap = 1 << 0
+	// ioringFeatRWCurPos comes with Linux 5.6, which also added IORING_OP_READ and IORING_OP_WRITE
+	ioringFeatRWCurPos   = 1 << 3
+	ioringEnterGetEvents = 1 << 0
+
+	ioringOpRead  = 22
+	ioringOpWrite = 23
+
+	// blkDiscard is BLKDISCARD ioctl.
+	blkDiscard = 0x1277
+)
+
+type sqringOffsets struct {
+	head, tail, ringMask, ringEntries, flags, dropped, array, resv1 uint32
+	userAddr                                                        uint64
+}
+
+type cqringOffsets struct {
+	head, tail, ringMask, ringEntries, overflow, cqes, flags, resv1 uint32
+	userAddr                                                        uint64
+}
+
+type uringParams struct {
+	sqEntries, cqEntries, flags, sqThreadCPU, sqThreadIdle, features, wqFD uint32
+	resv                                                                   [3]uint32
+	sqOff                                                                  sqringOffsets
+	cqOff                                                                  cqringOffsets
+}
+
+type sqe struct {
+	opcode      uint8
+	flags       uint8
+	ioprio      uint16
+	fd          int32
+	off         uint64
+	addr        uint64
+	len         uint32
+	rwFlags     uint32
+	userData    uint64
+	bufIndex    uint16
+	personality uint16
+	spliceFDIn  int32
+	addr3       uint64
+	_           uint64
+}
+
+type cqe struct {
+	userData uint64
+	res      int32
+	flags    uint32
+}
+
+// ioURingEnter issues io_uring_enter, it is replaced in the tests to inject failures.
+var ioURingEnter = func(fd int, toSubmit, minComplete, flags uint32) (uint32, unix.Errno) {
+	n, _, errno := unix.Syscall6(sysIOURingEnter, uintptr(fd), uintptr(toSubmit), uintptr(minComplete), uintptr(flags), 0, 0)
+
+	return uint32(n), errno
+}
+
+// uring is the io_uring engine.
+//
+// Submit calls are serialized, each batch is pushed to the submission queue
+// at once and the completions are gathered with a single io_uring_enter when possible.
+type uring struct {
+	mu sync.Mutex
+
+	// gen is the generation of the current batch, stored in the upper half of the user data,
+	// so that stray completions of an aborted batch are never attributed to other requests
+	gen uint32
+
+	// broken is set if the requests of an aborted batch couldn't be waited for,
+	// pinned keeps their buffers alive until the ring is closed
+	broken error
+	pinned []Op
+
+	fd         int
+	sqRing     []byte
+	cqRing     []byte
+	sqeMem     []byte
+	entries    uint32
+	singleMmap bool
+
+	sqHead, sqTail, sqMask, sqArray *uint32
+	cqHead, cqTail, cqMask          *uint32
+	sqes                            []sqe
+	cqes                            []cqe
+}
+
+func newURing(depth int) (Engine, error) { //nolint:ireturn
+	var params uringParams
+
+	fd, _, errno := unix.Syscall(sysIOURingSetup, uintptr(depth), uintptr(unsafe.Pointer(&params)), 0)
+	if errno != 0 {
+		return nil, fmt.Errorf("io_uring_setup failed: %w", errno)
+	}
+
+	r := &uring{
+		fd:         int(fd),
+		entries:    params.sqEntries,
+		singleMmap: params.features&ioringFeatSingleMmap != 0,
+	}
+
+	if params.features&ioringFeatRWCurPos == 0 {
+		r.Close() //nolint:errcheck
+
+		return nil, fmt.Errorf("io_uring doesn't support read and write operations")
+	}
+
+	if err := r.mmap(&params); err != nil {
+		r.Close() //nolint:errcheck
+
+		return nil, err
+	}
+
+	return r, nil
+}
+
+//nolint:gocyclo
+func (r *uring) mmap(params *uringParams) error {
+	sqSize := int(params.sqOff.array + params.sqEntries*4)
+	cqSize := int(params.cqOff.cqes + params.cqEntries*uint32(unsafe.Sizeof(cqe{})))
+
+	if r.singleMmap && cqSize > sqSize {
+		sqSize = cqSize
+	}
+
+	var err error
+
+	if r.sqRing, err = unix.Mmap(r.fd, ioringOffSQRing, sqSize, unix.PROT_READ|unix.PROT_WRITE, unix.MAP_SHARED|unix.MAP_POPULATE); err != nil {
+		return fmt.Errorf("failed to map io_uring submission ring: %w", err)
+	}
+
+	if r.singleMmap {
+		r.cqRing = r.sqRing
+	} else if r.cqRing, err = unix.Mmap(r.fd, ioringOffCQRing, cqSize, unix.PROT_READ|unix.PROT_WRITE, unix.MAP_SHARED|unix.MAP_POPULATE); err != nil {
+		return fmt.Errorf("failed to map io_uring completion ring: %w", err)
+	}
+
+	sqeSize := int(params.sqEntries) * int(unsafe.Sizeof(sqe{}))
+
+	if r.sqeMem, err = unix.Mmap(r.fd, ioringOffSQEs, sqeSize, unix.PROT_READ|unix.PROT_WRITE, unix.MAP_SHARED|unix.MAP_POPULATE); err != nil {
+		return fmt.Errorf("failed to map io_uring submission entries: %w", err)
+	}
+
+	u32 := func(ring []byte, off uint32) *uint32 {
+		return (*uint32)(unsafe.Pointer(&ring[off]))
+	}
+
+	r.sqHead = u32(r.sqRing, params.sqOff.head)
+	r.sqTail = u32(r.sqRing, params.sqOff.tail)
+	r.sqMask = u32(r.sqRing, params.sqOff.ringMask)
+	r.sqArray = u32(r.sqRing, params.sqOff.array)
+	r.cqHead = u32(r.cqRing, params.cqOff.head)
+	r.cqTail = u32(r.cqRing, params.cqOff.tail)
+	r.cqMask = u32(r.cqRing, params.cqOff.ringMask)
+
+	r.sqes = unsafe.Slice((*sqe)(unsafe.Pointer(&r.sqeMem[0])), params.sqEntries)
+	r.cqes = unsafe.Slice((*cqe)(unsafe.Pointer(&r.cqRing[params.cqOff.cqes])), params.cqEntries)
+
+	return nil
+}
+
+// Submit implements Engine.
+func (r *uring) Submit(ops []Op) error {
+	r.mu.Lock()
+	defer r.mu.Unlock()
+
+	if r.broken != nil {
+		return r.broken
+	}
+
+	// pending holds the indexes of the requests to (re)submit, short transfers are resubmitted for the rest
+	pending := make([]int, 0, len(ops))
+
+	for i := range ops {
+		ops[i].N, ops[i].Err = 0, nil
+
+		switch ops[i].Type {
+		case OpRead, OpWrite:
+			if len(ops[i].Buf) > 0 {
+				pending = append(pending, i)
+			}
+		case OpDiscard:
+			// there's no portable discard opcode, issue it directly
+			execSync(&ops[i])
+		default:
+			ops[i].Err = fmt.Errorf("unknown op type %d", ops[i].Type)
+		}
+	}
+
+	for len(pending) > 0 {
+		batch := pending
+		if uint32(len(batch)) > r.entries {
+			batch = batch[:r.entries]
+		}
+
+		if err := r.submitBatch(ops, batch); err != nil {
+			return err
+		}
+
+		rest := pending[len(batch):]
+		pending = pending[:0]
+
+		for _, i := range batch {
+			op := &ops[i]
+
+			if op.Err == nil && op.N < len(op.Buf) && !op.eof {
+				pending = append(pending, i)
+			}
+		}
+
+		pending = append(pending, rest...)
+	}
+
+	for i := range ops {
+		ops[i].eof = false
+	}
+
+	runtime.KeepAlive(ops)
+
+	return nil
+}
+
+func (r *uring) submitBatch(ops []Op, batch []int) error {
+	r.gen++
+
+	start := atomic.LoadUint32(r.sqTail)
+	tail := start
+	mask := *r.sqMask
+
+	for _, i := range batch {
+		op := &ops[i]
+		idx := tail & mask
+
+		entry := &r.sqes[idx]
+		*entry = sqe{
+			fd:       int32(op.File.Fd()),
+			off:      uint64(op.Offset) + uint64(op.N),
+			addr:     uint64(uintptr(unsafe.Pointer(&op.Buf[op.N]))),
+			len:      uint32(len(op.Buf) - op.N),
+			userData: uint64(r.gen)<<32 | uint64(i),
+		}
+
+		if op.Type == OpRead {
+			entry.opcode = ioringOpRead
+		} else {
+			entry.opcode = ioringOpWrite
+		}
+
+		*(*uint32)(unsafe.Add(unsafe.Pointer(r.sqArray), uintptr(idx)*4)) = idx
+
+		tail++
+	}
+
+	atomic.StoreUint32(r.sqTail, tail)
+
+	toSubmit := uint32(len(batch))
+	completed := uint32(0)
+
+	for completed < uint32(len(batch)) {
+		n, errno := ioURingEnter(r.fd, toSubmit, uint32(len(batch))-completed, ioringEnterGetEvents)
+		if errno != 0 && !errors.Is(errno, unix.EINTR) {
+			err := fmt.Errorf("io_uring_enter failed: %w", errno)
+
+			r.abort(ops, start, completed, err)
+
+			return err
+		}
+
+		if errno == 0 {
+			toSubmit -= n
+		}
+
+		completed += r.reap(ops)
+	}
+
+	return nil
+}
+
+// abort cancels the batch after io_uring_enter failed.
+//
+// The requests which were not consumed by the kernel are dropped from the submission queue,
+// and the requests in flight are waited for, so that the kernel never writes to the buffers
+// after Submit returns. If waiting fails as well, the ring is marked as broken.
+func (r *uring) abort(ops []Op, start, completed uint32, cause error) {
+	// without SQPOLL the kernel consumes the submission queue only within io_uring_enter
+	head := atomic.LoadUint32(r.sqHead)
+	atomic.StoreUint32(r.sqTail, head)
+
+	inflight := head - start - completed
+
+	for inflight > 0 {
+		_, errno := ioURingEnter(r.fd, 0, inflight, ioringEnterGetEvents)
+		if errno != 0 && !errors.Is(errno, unix.EINTR) {
+			r.broken = fmt.Errorf("io_uring is unusable after failing to wait for requests: %w", errors.Join(cause, errno))
+			r.pinned = ops
+
+			return
+		}
+
+		inflight -= r.reap(ops)
+	}
+}
+
+// reap gathers the completions of the current batch, and returns the number of them.
+func (r *uring) reap(ops []Op) uint32 {
+	head := atomic.LoadUint32(r.cqHead)
+	tail := atomic.LoadUint32(r.cqTail)
+	mask := *r.cqMask
+
+	var n uint32
+
+	for ; head != tail; head++ {
+		c := r.cqes[head&mask]
+
+		i := c.userData & 0xffffffff
+		if uint32(c.userData>>32) != r.gen || i >= uint64(len(ops)) {
+			// stray completion of an aborted batch
+			continue
+		}
+
+		op := &ops[i]
+
+		switch {
+		case c.res < 0:
+			op.Err = unix.Errno(-c.res)
+		case c.res == 0 && op.Type == OpRead:
+			op.eof = true
+		case c.res == 0:
+			op.Err = io.ErrShortWrite
+		default:
+			op.N += int(c.res)
+		}
+
+		n++
+	}
+
+	atomic.StoreUint32(r.cqHead, head)
+
+	return n
+}
+
+// leakedOps keeps the buffers of the requests which might still be in flight when a broken ring is closed.
+var (
+	leakedOpsMu sync.Mutex
+	leakedOps   [][]Op
+)
+
+// Close implements Engine.
+func (r *uring) Close() error {
+	if r.pinned != nil {
+		// the kernel cancels the requests asynchronously once the ring is closed,
+		// so the buffers are never released
+		leakedOpsMu.Lock()
+		leakedOps = append(leakedOps, r.pinned)
+		leakedOpsMu.Unlock()
+	}
+
+	mappings := [][]byte{r.sqeMem, r.sqRing}
+
+	if !r.singleMmap {
+		mappings = append(mappings, r.cqRing)
+	}
+
+	for _, m := range mappings {
+		if m != nil {
+			unix.Munmap(m) //nolint:errcheck
+		}
+	}
+
+	return os.NewFile(uintptr(r.fd), "io_uring").Close()
+}
+
+func discard(f *os.File, off, length int64) error {
+	r := [2]uint64{uint64(off), uint64(length)}
+
+	if _, _, errno := unix.Syscall(unix.SYS_IOCTL, f.Fd(), blkDiscard, uintptr(unsafe.Pointer(&r[0]))); errno != 0 {
+		return errno
+	}
+
+	return nil
+}
@@ -0,0 +1,106 @@
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+package aio_test
+
+import (
+	"bytes"
+	"os"
+	"path/filepath"
+	"testing"
+
+	"github.com/stretchr/testify/assert"
+	"github.com/stretchr/testify/require"
+	"golang.org/x/sys/unix"
+
+	"github.com/siderolabs/go-blockdevice/blockdevice/aio"
+)
+
+func TestURingEnterFailure(t *testing.T) {
+	for _, tc := range []struct {
+		name string
+		// failWait makes waiting for the requests in flight fail as well
+		failWait bool
+	}{
+		{"recovered", false},
+		{"broken", true},
+	} {
+		tc := tc
+
+		t.Run(tc.name, func(t *testing.T) {
+			e := aio.New(aio.WithQueueDepth(8))
+
+			t.Cleanup(func() { assert.NoError(t, e.Close()) })
+
+			if !aio.IsURing(e) {
+				t.Skip("io_uring is not available")
+			}
+
+			f, err := os.Create(filepath.Join(t.TempDir(), "data"))
+			require.NoError(t, err)
+
+			t.Cleanup(func() { f.Close() }) //nolint:errcheck
+
+			_, err = f.Write(bytes.Repeat([]byte{0xaa}, 8*4096))
+			require.NoError(t, err)
+
+			newReads := func() []aio.Op {
+				reads := make([]aio.Op, 8)
+
+				for i := range reads {
+					reads[i] = aio.Op{Type: aio.OpRead, File: f, Buf: make([]byte, 4096), Offset: int64(i) * 4096}
+				}
+
+				return reads
+			}
+
+			calls := 0
+
+			restore := aio.SetURingEnter(func(enter func(int, uint32, uint32, uint32) (uint32, unix.Errno), fd int, toSubmit, minComplete, flags uint32) (uint32, unix.Errno) {
+				calls++
+
+				switch {
+				case calls == 1:
+					// the requests are submitted, but the call fails before they complete
+					enter(fd, toSubmit, 0, 0)
+
+					return 0, unix.EBUSY
+				case tc.failWait:
+					return 0, unix.EIO
+				default:
+					return enter(fd, toSubmit, minComplete, flags)
+				}
+			})
+
+			reads := newReads()
+
+			err = e.Submit(reads)
+			require.ErrorIs(t, err, unix.EBUSY)
+
+			restore()
+
+			if tc.failWait {
+				// the ring can't be used anymore
+				assert.ErrorIs(t, e.Submit(newReads()), unix.EIO)
+
+				return
+			}
+
+			// the requests in flight were waited for
+			for i := range reads {
+				assert.Equal(t, 4096, reads[i].N)
+			}
+
+			// no stray completions are left for the next batch
+			reads = newReads()
+
+			require.NoError(t, e.Submit(reads))
+			require.NoError(t, aio.Err(reads))
+
+			for i := range reads {
+				assert.Equal(t, bytes.Repeat([]byte{0xaa}, 4096), reads[i].Buf)
+			}
+		})
+	}
+}
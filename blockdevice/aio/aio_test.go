@@ -0,0 +1,83 @@
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+package aio_test
+
+import (
+	"bytes"
+	"os"
+	"path/filepath"
+	"testing"
+
+	"github.com/stretchr/testify/assert"
+	"github.com/stretchr/testify/require"
+
+	"github.com/siderolabs/go-blockdevice/blockdevice/aio"
+)
+
+func TestEngines(t *testing.T) {
+	for _, engine := range []struct {
+		name string
+		new  func() aio.Engine
+	}{
+		{"default", func() aio.Engine { return aio.New(aio.WithQueueDepth(4)) }},
+		{"sync", func() aio.Engine { return aio.New(aio.WithSync(true), aio.WithQueueDepth(4)) }},
+	} {
+		engine := engine
+
+		t.Run(engine.name, func(t *testing.T) {
+			f, err := os.Create(filepath.Join(t.TempDir(), "data"))
+			require.NoError(t, err)
+
+			t.Cleanup(func() { f.Close() }) //nolint:errcheck
+
+			e := engine.new()
+
+			t.Cleanup(func() { assert.NoError(t, e.Close()) })
+
+			// more requests than the queue depth
+			writes := make([]aio.Op, 10)
+
+			for i := range writes {
+				writes[i] = aio.Op{
+					Type:   aio.OpWrite,
+					File:   f,
+					Buf:    bytes.Repeat([]byte{byte(i + 1)}, 4096),
+					Offset: int64(i) * 4096,
+				}
+			}
+
+			require.NoError(t, e.Submit(writes))
+			require.NoError(t, aio.Err(writes))
+
+			reads := make([]aio.Op, 10)
+
+			for i := range reads {
+				reads[i] = aio.Op{
+					Type:   aio.OpRead,
+					File:   f,
+					Buf:    make([]byte, 4096),
+					Offset: int64(9-i) * 4096,
+				}
+			}
+
+			// read past the end is short
+			reads[0].Offset = 9*4096 + 1024
+
+			require.NoError(t, e.Submit(reads))
+
+			assert.Equal(t, 3072, reads[0].N)
+			assert.NoError(t, reads[0].Err)
+			assert.Equal(t, bytes.Repeat([]byte{10}, 3072), reads[0].Buf[:3072])
+
+			for i := 1; i < len(reads); i++ {
+				assert.Equal(t, 4096, reads[i].N)
+				assert.Equal(t, bytes.Repeat([]byte{byte(10 - i)}, 4096), reads[i].Buf)
+			}
+
+			assert.Error(t, aio.Err(reads))
+			assert.NoError(t, aio.Err(reads[1:]))
+		})
+	}
+}
@@ -0,0 +1,9 @@
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+// Package aio provides batched asynchronous I/O engines for block devices.
+//
+// On Linux io_uring is used when the kernel supports it, with a fallback to
+// the synchronous engine which issues the requests from a pool of goroutines.
+package aio
@@ -0,0 +1,25 @@
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+package aio
+
+import "golang.org/x/sys/unix"
+
+// IsURing returns true if the engine is the io_uring engine.
+func IsURing(e Engine) bool {
+	_, ok := e.(*uring)
+
+	return ok
+}
+
+// SetURingEnter replaces io_uring_enter, f gets the original implementation.
+func SetURingEnter(f func(enter func(fd int, toSubmit, minComplete, flags uint32) (uint32, unix.Errno), fd int, toSubmit, minComplete, flags uint32) (uint32, unix.Errno)) (restore func()) {
+	orig := ioURingEnter
+
+	ioURingEnter = func(fd int, toSubmit, minComplete, flags uint32) (uint32, unix.Errno) {
+		return f(orig, fd, toSubmit, minComplete, flags)
+	}
+
+	return func() { ioURingEnter = orig }
+}
@@ -5,9 +5,11 @@
 package blkpg
 
 import (
+	"errors"
 	"fmt"
 	"os"
 	"path/filepath"
+	"sort"
 	"strconv"
 	"strings"
 	"syscall"
@@ -18,25 +20,27 @@ import (
 	"golang.org/x/sys/unix"
 
 	"github.com/siderolabs/go-blockdevice/blockdevice/lba"
-	"github.com/siderolabs/go-blockdevice/blockdevice/util"
+	"github.com/siderolabs/go-blockdevice/blockdevice/observe"
 )
 
 // InformKernelOfAdd invokes the BLKPG_ADD_PARTITION ioctl.
-func InformKernelOfAdd(f *os.File, first, length uint64, n int32) error {
-	return inform(f, first, length, n, unix.BLKPG_ADD_PARTITION)
+func InformKernelOfAdd(f *os.File, first, length uint64, n int32, setters ...Option) error {
+	return inform(f, first, length, n, unix.BLKPG_ADD_PARTITION, setters...)
 }
 
 // InformKernelOfResize invokes the BLKPG_RESIZE_PARTITION ioctl.
-func InformKernelOfResize(f *os.File, first, length uint64, n int32) error {
-	return inform(f, first, length, n, unix.BLKPG_RESIZE_PARTITION)
+func InformKernelOfResize(f *os.File, first, length uint64, n int32, setters ...Option) error {
+	return inform(f, first, length, n, unix.BLKPG_RESIZE_PARTITION, setters...)
 }
 
 // InformKernelOfDelete invokes the BLKPG_DEL_PARTITION ioctl.
-func InformKernelOfDelete(f *os.File, first, length uint64, n int32) error {
-	return inform(f, first, length, n, unix.BLKPG_DEL_PARTITION)
+func InformKernelOfDelete(f *os.File, first, length uint64, n int32, setters ...Option) error {
+	return inform(f, first, length, n, unix.BLKPG_DEL_PARTITION, setters...)
 }
 
-func inform(f *os.File, first, length uint64, n, op int32) error {
+func inform(f *os.File, first, length uint64, n, op int32, setters ...Option) error {
+	opts := NewDefaultOptions(setters...)
+
 	var (
 		start int64
 		end   int64
@@ -72,7 +76,11 @@ func inform(f *os.File, first, length uint64, n, op int32) error {
 		Data:    (*byte)(unsafe.Pointer(data)),
 	}
 
-	err = retry.Constant(10*time.Second, retry.WithUnits(500*time.Millisecond)).Retry(func() error {
+	opName := blkpgOpName(op)
+
+	err = retry.Constant(10*time.Second, retry.WithUnits(500*time.Millisecond)).Retry(observe.Retry(opts.Observer, f.Name(), opName, func() error {
+		s := observe.Start(opts.Observer, observe.KindIoctl, f.Name(), opName)
+
 		_, _, errno := syscall.Syscall(
 			syscall.SYS_IOCTL,
 			f.Fd(),
@@ -80,6 +88,8 @@ func inform(f *os.File, first, length uint64, n, op int32) error {
 			uintptr(unsafe.Pointer(arg)),
 		)
 
+		s.EndErrno(errno)
+
 		if errno != 0 {
 			//nolint: exhaustive
 			switch errno {
@@ -91,7 +101,7 @@ func inform(f *os.File, first, length uint64, n, op int32) error {
 		}
 
 		return f.Sync()
-	})
+	}))
 
 	if err != nil {
 		return fmt.Errorf("failed to inform kernel: %w", err)
@@ -100,49 +110,92 @@ func inform(f *os.File, first, length uint64, n, op int32) error {
 	return nil
 }
 
+func blkpgOpName(op int32) string {
+	switch op {
+	case unix.BLKPG_ADD_PARTITION:
+		return "BLKPG_ADD_PARTITION"
+	case unix.BLKPG_DEL_PARTITION:
+		return "BLKPG_DEL_PARTITION"
+	case unix.BLKPG_RESIZE_PARTITION:
+		return "BLKPG_RESIZE_PARTITION"
+	default:
+		return "BLKPG"
+	}
+}
+
 // GetKernelPartitions returns kernel partition table state.
+//
+// Partitions are discovered with a single scan of the device sysfs directory.
 func GetKernelPartitions(f *os.File) ([]KernelPartition, error) {
 	result := []KernelPartition{}
 
-	for i := 1; i <= 256; i++ {
-		partName := util.PartName(f.Name(), i)
-		partPath := filepath.Join("/sys/block", filepath.Base(f.Name()), partName)
-
-		_, err := os.Stat(partPath)
-		if err != nil {
-			if os.IsNotExist(err) {
-				continue
-			}
+	devName := filepath.Base(f.Name())
+	devPath := filepath.Join("/sys/block", devName)
 
-			return nil, err
+	entries, err := os.ReadDir(devPath)
+	if err != nil {
+		if os.IsNotExist(err) {
+			return result, nil
 		}
 
-		startS, err := os.ReadFile(filepath.Join(partPath, "start"))
-		if err != nil {
-			return nil, err
+		return nil, err
+	}
+
+	// attribute values are short, so one buffer is reused for all reads
+	buf := make([]byte, 32)
+
+	for _, entry := range entries {
+		// partitions are subdirectories named after the device, e.g. sda1, nvme0n1p1
+		if !entry.IsDir() || !strings.HasPrefix(entry.Name(), devName) {
+			continue
 		}
 
-		sizeS, err := os.ReadFile(filepath.Join(partPath, "size"))
+		partPath := filepath.Join(devPath, entry.Name())
+
+		no, err := readSysfsInt(filepath.Join(partPath, "partition"), buf)
 		if err != nil {
+			if errors.Is(err, unix.ENOENT) {
+				continue
+			}
+
 			return nil, err
 		}
 
-		start, err := strconv.ParseInt(strings.TrimSpace(string(startS)), 10, 64)
+		start, err := readSysfsInt(filepath.Join(partPath, "start"), buf)
 		if err != nil {
 			return nil, err
 		}
 
-		size, err := strconv.ParseInt(strings.TrimSpace(string(sizeS)), 10, 64)
+		size, err := readSysfsInt(filepath.Join(partPath, "size"), buf)
 		if err != nil {
 			return nil, err
 		}
 
 		result = append(result, KernelPartition{
-			No:     i,
+			No:     int(no),
 			Start:  start,
 			Length: size,
 		})
 	}
 
+	sort.Slice(result, func(i, j int) bool { return result[i].No < result[j].No })
+
 	return result, nil
 }
+
+// readSysfsInt reads an integer sysfs attribute using buf.
+func readSysfsInt(path string, buf []byte) (int64, error) {
+	fd, err := unix.Open(path, unix.O_RDONLY|unix.O_CLOEXEC, 0)
+	if err != nil {
+		return 0, err
+	}
+
+	defer unix.Close(fd) //nolint:errcheck
+
+	n, err := unix.Read(fd, buf)
+	if err != nil {
+		return 0, fmt.Errorf("error reading %q: %w", path, err)
+	}
+
+	return strconv.ParseInt(strings.TrimSpace(string(buf[:n])), 10, 64)
+}
@@ -10,17 +10,17 @@ import (
 )
 
 // InformKernelOfAdd invokes the BLKPG_ADD_PARTITION ioctl.
-func InformKernelOfAdd(f *os.File, first, length uint64, n int32) error {
+func InformKernelOfAdd(f *os.File, first, length uint64, n int32, setters ...Option) error {
 	return fmt.Errorf("not implemented")
 }
 
 // InformKernelOfResize invokes the BLKPG_RESIZE_PARTITION ioctl.
-func InformKernelOfResize(f *os.File, first, length uint64, n int32) error {
+func InformKernelOfResize(f *os.File, first, length uint64, n int32, setters ...Option) error {
 	return fmt.Errorf("not implemented")
 }
 
 // InformKernelOfDelete invokes the BLKPG_DEL_PARTITION ioctl.
-func InformKernelOfDelete(f *os.File, first, length uint64, n int32) error {
+func InformKernelOfDelete(f *os.File, first, length uint64, n int32, setters ...Option) error {
 	return fmt.Errorf("not implemented")
 }
 
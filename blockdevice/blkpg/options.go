@@ -0,0 +1,35 @@
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+package blkpg
+
+import "github.com/siderolabs/go-blockdevice/blockdevice/observe"
+
+// Options is the functional options struct.
+type Options struct {
+	Observer observe.Observer
+}
+
+// Option is the functional option func.
+type Option func(*Options)
+
+// WithObserver sets the observer for the BLKPG ioctls and their retries.
+//
+// If not set, the process-wide observer (see observe.Register) is used.
+func WithObserver(o observe.Observer) Option {
+	return func(args *Options) {
+		args.Observer = o
+	}
+}
+
+// NewDefaultOptions initializes a Options struct with default values.
+func NewDefaultOptions(setters ...Option) *Options {
+	opts := &Options{}
+
+	for _, setter := range setters {
+		setter(opts)
+	}
+
+	return opts
+}
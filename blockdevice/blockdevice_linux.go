@@ -5,11 +5,14 @@
 package blockdevice
 
 import (
+	"context"
 	"errors"
 	"fmt"
-	"io"
 	"os"
 	"path/filepath"
+	"strconv"
+	"strings"
+	"sync"
 	"syscall"
 	"time"
 	"unsafe"
@@ -17,6 +20,9 @@ import (
 	"github.com/siderolabs/go-retry/retry"
 	"golang.org/x/sys/unix"
 
+	"github.com/siderolabs/go-blockdevice/blockdevice/aio"
+	"github.com/siderolabs/go-blockdevice/blockdevice/lba"
+	"github.com/siderolabs/go-blockdevice/blockdevice/observe"
 	"github.com/siderolabs/go-blockdevice/blockdevice/partition/gpt"
 )
 
@@ -44,13 +50,27 @@ type BlockDevice struct {
 	g *gpt.GPT
 
 	f *os.File
+
+	cachePartitionTable  bool
+	partitionTableLoaded bool
+
+	wipeCapsOnce sync.Once
+	wipeCaps     *wipeCapabilities
+
+	wipeMu     sync.Mutex
+	wipeMethod string
+
+	observer observe.Observer
 }
 
 // Open initializes and returns a block device.
 // TODO(andrewrynhard): Use BLKGETSIZE ioctl to get the size.
 func Open(devname string, setters ...Option) (_ *BlockDevice, rerr error) { //nolint:nonamedreturns
 	opts := NewDefaultOptions(setters...)
-	bd := &BlockDevice{}
+	bd := &BlockDevice{
+		cachePartitionTable: opts.CachePartitionTable,
+		observer:            opts.Observer,
+	}
 
 	var (
 		f   *os.File
@@ -86,19 +106,22 @@ func Open(devname string, setters ...Option) (_ *BlockDevice, rerr error) { //no
 	if opts.CreateGPT {
 		var g *gpt.GPT
 
-		g, err = gpt.New(f)
+		g, err = gpt.New(f, gpt.WithDirectIO(opts.DirectIO), gpt.WithObserver(opts.Observer))
 		if err != nil {
 			return nil, err
 		}
 
 		if err = g.Write(); err != nil {
+			g.Close() //nolint:errcheck
+
 			return nil, err
 		}
 
 		bd.g = g
+		bd.partitionTableLoaded = true
 	} else {
 		var g *gpt.GPT
-		if g, err = gpt.Open(f); err != nil {
+		if g, err = gpt.Open(f, gpt.WithDirectIO(opts.DirectIO), gpt.WithObserver(opts.Observer)); err != nil {
 			if errors.Is(err, gpt.ErrPartitionTableDoesNotExist) {
 				return bd, nil
 			}
@@ -114,16 +137,61 @@ func Open(devname string, setters ...Option) (_ *BlockDevice, rerr error) { //no
 
 // Close closes the block devices's open file.
 func (bd *BlockDevice) Close() error {
+	if bd.g != nil {
+		if err := bd.g.Close(); err != nil {
+			bd.f.Close() //nolint:errcheck
+
+			return err
+		}
+	}
+
 	return bd.f.Close()
 }
 
 // PartitionTable returns the block device partition table.
+//
+// If the partition table cache is enabled, the partition table is re-read only
+// if it was invalidated or if the header on disk has changed, so in-memory
+// modifications are kept until they are written.
 func (bd *BlockDevice) PartitionTable() (*gpt.GPT, error) {
 	if bd.g == nil {
 		return nil, ErrMissingPartitionTable
 	}
 
-	return bd.g, bd.g.Read()
+	if bd.cachePartitionTable && bd.partitionTableLoaded {
+		changed, err := bd.g.Changed()
+		if err != nil {
+			return nil, err
+		}
+
+		if !changed {
+			return bd.g, nil
+		}
+	}
+
+	return bd.ReloadPartitionTable()
+}
+
+// ReloadPartitionTable re-reads the block device partition table from disk.
+func (bd *BlockDevice) ReloadPartitionTable() (*gpt.GPT, error) {
+	if bd.g == nil {
+		return nil, ErrMissingPartitionTable
+	}
+
+	if err := bd.g.Read(); err != nil {
+		bd.partitionTableLoaded = false
+
+		return bd.g, err
+	}
+
+	bd.partitionTableLoaded = true
+
+	return bd.g, nil
+}
+
+// InvalidatePartitionTable drops the cached partition table, so that it is re-read on next access.
+func (bd *BlockDevice) InvalidatePartitionTable() {
+	bd.partitionTableLoaded = false
 }
 
 // RereadPartitionTable invokes the BLKRRPART ioctl to have the kernel read the
@@ -139,7 +207,7 @@ func (bd *BlockDevice) RereadPartitionTable() error {
 		return err
 	}
 	// Flush the block device buffers.
-	if _, _, ret := unix.Syscall(unix.SYS_IOCTL, bd.f.Fd(), unix.BLKFLSBUF, 0); ret != 0 {
+	if ret := bd.ioctl("BLKFLSBUF", unix.BLKFLSBUF, nil); ret != 0 {
 		return fmt.Errorf("flush block device buffers: %w", ret)
 	}
 
@@ -149,18 +217,18 @@ func (bd *BlockDevice) RereadPartitionTable() error {
 	)
 
 	// Reread the partition table.
-	err = retry.Constant(5*time.Second, retry.WithUnits(50*time.Millisecond)).Retry(func() error {
-		if _, _, ret = unix.Syscall(unix.SYS_IOCTL, bd.f.Fd(), unix.BLKRRPART, 0); ret == 0 {
+	err = retry.Constant(5*time.Second, retry.WithUnits(50*time.Millisecond)).Retry(observe.Retry(bd.observer, bd.f.Name(), "BLKRRPART", func() error {
+		if ret = bd.ioctl("BLKRRPART", unix.BLKRRPART, nil); ret == 0 {
 			return nil
 		}
 		//nolint: exhaustive
 		switch ret {
 		case syscall.EBUSY:
-			return retry.ExpectedError(err)
+			return retry.ExpectedError(ret)
 		default:
-			return err
+			return ret
 		}
-	})
+	}))
 	if err != nil {
 		return fmt.Errorf("failed to re-read partition table: %w", err)
 	}
@@ -204,16 +272,32 @@ func (bd *BlockDevice) Wipe() (string, error) {
 // This method is much faster than Wipe(), but it doesn't guarantee
 // that device will be zeroed out completely.
 func (bd *BlockDevice) FastWipe() error {
+	_, _, err := bd.FastWipeContext(context.Background())
+
+	return err
+}
+
+// FastWipeContext is FastWipe which stops when the context is canceled.
+//
+// It returns the method used to wipe the head of the device, and whether the whole
+// device was discarded.
+func (bd *BlockDevice) FastWipeContext(ctx context.Context, setters ...WipeOption) (method string, discarded bool, err error) {
 	size, err := bd.Size()
 	if err != nil {
-		return err
+		return "", false, err
+	}
+
+	if err = ctx.Err(); err != nil {
+		return "", false, err
 	}
 
 	// BLKDISCARD is implemented via TRIM on SSDs, it might or might not zero out device contents.
-	r := [2]uint64{0, size}
+	if bd.capabilities().canDiscard() {
+		r := [2]uint64{0, size}
 
-	// ignoring the error here as DISCARD might be not supported by the device
-	unix.Syscall(unix.SYS_IOCTL, bd.f.Fd(), BLKDISCARD, uintptr(unsafe.Pointer(&r[0]))) //nolint: errcheck
+		// ignoring the error here as DISCARD might be not supported by the device
+		discarded = bd.ioctl("BLKDISCARD", BLKDISCARD, unsafe.Pointer(&r[0])) == 0
+	}
 
 	// zero out the first N bytes of the device to clear any partition table
 	wipeLength := uint64(FastWipeRange)
@@ -222,44 +306,448 @@ func (bd *BlockDevice) FastWipe() error {
 		wipeLength = size
 	}
 
-	_, err = bd.WipeRange(0, wipeLength)
+	method, err = bd.WipeRangeContext(ctx, 0, wipeLength, setters...)
 
-	return err
+	return method, discarded, err
 }
 
 // WipeRange the blockdevice [start, start+length).
 func (bd *BlockDevice) WipeRange(start, length uint64) (string, error) {
-	var err error
+	return bd.WipeRangeContext(context.Background(), start, length)
+}
 
-	r := [2]uint64{start, length}
+// Wipe methods in the order of preference.
+const (
+	wipeSecDiscard     = "blksecdiscard"
+	wipeDiscardZeroes  = "blkdiscardzeros"
+	wipeZeroOut        = "blkzeroout"
+	wipeWriteZeroes    = "writezeroes"
+	wipeZeroBufferSize = 4 * 1024 * 1024
+)
+
+// zeroBuffer is the source for writing zeroes, it is never written to.
+var zeroBuffer [wipeZeroBufferSize]byte
+
+// WipeRangeContext wipes the blockdevice [start, start+length) in chunks.
+//
+// The wipe method is picked with the first chunk and cached for the block device, the remaining
+// chunks are wiped with the same method by the concurrent workers. If the cached method fails,
+// the method is picked again for the chunk, and the new method is cached. Discard is issued only for
+// the part of the range aligned to the discard granularity, the unaligned head and tail are
+// zeroed out. The wipe stops at the chunk boundary when the context is canceled.
+//
+//nolint:gocyclo,cyclop
+func (bd *BlockDevice) WipeRangeContext(ctx context.Context, start, length uint64, setters ...WipeOption) (string, error) {
+	opts := NewDefaultWipeOptions(setters...)
+	caps := bd.capabilities()
+
+	chunkSize := opts.ChunkSize
+	if chunkSize == 0 {
+		chunkSize = DefaultWipeChunkSize
+	}
 
-	if _, _, errno := unix.Syscall(unix.SYS_IOCTL, bd.f.Fd(), BLKSECDISCARD, uintptr(unsafe.Pointer(&r[0]))); errno == 0 {
-		return "blksecdiscard", nil
+	if caps.optimalIOSize > 0 {
+		chunkSize = roundUp(chunkSize, caps.optimalIOSize)
 	}
 
-	var zeroes int
+	if caps.discardGranularity > 1 {
+		chunkSize = roundUp(chunkSize, caps.discardGranularity)
+	}
+
+	var (
+		progressMu sync.Mutex
+		done       uint64
+	)
 
-	if _, _, errno := unix.Syscall(unix.SYS_IOCTL, bd.f.Fd(), BLKDISCARDZEROES, uintptr(unsafe.Pointer(&zeroes))); errno == 0 && zeroes != 0 {
-		if _, _, errno = unix.Syscall(unix.SYS_IOCTL, bd.f.Fd(), BLKDISCARD, uintptr(unsafe.Pointer(&r[0]))); errno == 0 {
-			return "blkdiscardzeros", nil
+	report := func(n uint64) {
+		if opts.Progress == nil {
+			return
 		}
+
+		progressMu.Lock()
+		defer progressMu.Unlock()
+
+		done += n
+
+		opts.Progress(done, length)
+	}
+
+	if err := ctx.Err(); err != nil {
+		return "", err
+	}
+
+	end := start + length
+	alignedStart, alignedEnd := start, end
+
+	if g := caps.discardGranularity; g > 1 {
+		alignedStart, alignedEnd = roundUp(start, g), end/g*g
+
+		if alignedStart >= alignedEnd {
+			alignedStart, alignedEnd = end, end
+		}
+	}
+
+	var (
+		method string
+		err    error
+	)
+
+	for _, r := range [][2]uint64{{start, alignedStart - start}, {alignedEnd, end - alignedEnd}} {
+		if r[1] == 0 {
+			continue
+		}
+
+		if method, err = bd.zeroRange(opts.Engine, r[0], r[1]); err != nil {
+			return method, err
+		}
+
+		report(r[1])
 	}
 
-	if _, _, errno := unix.Syscall(unix.SYS_IOCTL, bd.f.Fd(), BLKZEROOUT, uintptr(unsafe.Pointer(&r[0]))); errno == 0 {
-		return "blkzeroout", nil
+	if alignedStart == alignedEnd {
+		return method, nil
 	}
 
-	var zero *os.File
+	next := alignedStart
+	method = bd.cachedWipeMethod()
+
+	if method == "" {
+		// the first chunk picks the method
+		first := alignedEnd - alignedStart
+		if first > chunkSize {
+			first = chunkSize
+		}
+
+		if method, err = bd.detectWipeMethod(opts.Engine, alignedStart, first); err != nil {
+			return method, err
+		}
+
+		bd.setWipeMethod(method)
+
+		report(first)
+
+		next += first
+	}
 
-	if zero, err = os.Open("/dev/zero"); err != nil {
+	chunks := make(chan [2]uint64)
+	errCh := make(chan error, opts.Concurrency)
+
+	ctx, cancel := context.WithCancel(ctx)
+	defer cancel()
+
+	var (
+		wg       sync.WaitGroup
+		methodMu sync.Mutex
+	)
+
+	for i := 0; i < opts.Concurrency; i++ {
+		wg.Add(1)
+
+		go func() {
+			defer wg.Done()
+
+			methodMu.Lock()
+			chunkMethod := method
+			methodMu.Unlock()
+
+			for r := range chunks {
+				err := bd.wipeChunk(opts.Engine, chunkMethod, r[0], r[1])
+				if err != nil && chunkMethod != wipeWriteZeroes {
+					// the cached method doesn't work anymore, pick the method again
+					bd.resetWipeMethod(chunkMethod)
+
+					var detected string
+
+					if detected, err = bd.detectWipeMethod(opts.Engine, r[0], r[1]); err == nil {
+						chunkMethod = detected
+
+						bd.setWipeMethod(chunkMethod)
+
+						methodMu.Lock()
+						method = chunkMethod
+						methodMu.Unlock()
+					}
+				}
+
+				if err != nil {
+					errCh <- fmt.Errorf("failed to wipe range %d+%d with %s: %w", r[0], r[1], chunkMethod, err)
+
+					cancel()
+
+					return
+				}
+
+				report(r[1])
+			}
+		}()
+	}
+
+	for off := next; off < alignedEnd; off += chunkSize {
+		n := alignedEnd - off
+		if n > chunkSize {
+			n = chunkSize
+		}
+
+		select {
+		case chunks <- [2]uint64{off, n}:
+			continue
+		case <-ctx.Done():
+		}
+
+		break
+	}
+
+	close(chunks)
+	wg.Wait()
+
+	select {
+	case err = <-errCh:
+		return method, err
+	default:
+	}
+
+	return method, ctx.Err()
+}
+
+// wipeCapabilities describes the discard support of the device as reported by the kernel.
+type wipeCapabilities struct {
+	// known is false if the queue attributes couldn't be read
+	known              bool
+	discardGranularity uint64
+	discardMaxBytes    uint64
+	optimalIOSize      uint64
+	// writeZeroesKnown is false if write_zeroes_max_bytes couldn't be read (kernels before 4.10)
+	writeZeroesKnown    bool
+	writeZeroesMaxBytes uint64
+}
+
+func (caps *wipeCapabilities) canDiscard() bool {
+	return !caps.known || caps.discardMaxBytes > 0
+}
+
+func (caps *wipeCapabilities) canZeroOut() bool {
+	return !caps.writeZeroesKnown || caps.writeZeroesMaxBytes > 0
+}
+
+// capabilities returns the discard capabilities of the block device, they are read once.
+func (bd *BlockDevice) capabilities() *wipeCapabilities {
+	bd.wipeCapsOnce.Do(func() {
+		bd.wipeCaps = readWipeCapabilities(bd.f)
+	})
+
+	return bd.wipeCaps
+}
+
+func readWipeCapabilities(f *os.File) *wipeCapabilities {
+	caps := &wipeCapabilities{}
+
+	if l, err := lba.NewLBA(f); err == nil && l.OptimalIOSize > 0 {
+		caps.optimalIOSize = uint64(l.OptimalIOSize)
+	}
+
+	dir, err := queueDir(f.Name())
+	if err != nil {
+		return caps
+	}
+
+	if writeZeroesMaxBytes, err := readSysfsUint(filepath.Join(dir, "write_zeroes_max_bytes")); err == nil {
+		caps.writeZeroesKnown = true
+		caps.writeZeroesMaxBytes = writeZeroesMaxBytes
+	}
+
+	granularity, err := readSysfsUint(filepath.Join(dir, "discard_granularity"))
+	if err != nil {
+		return caps
+	}
+
+	maxBytes, err := readSysfsUint(filepath.Join(dir, "discard_max_bytes"))
+	if err != nil {
+		return caps
+	}
+
+	caps.known = true
+	caps.discardGranularity = granularity
+	caps.discardMaxBytes = maxBytes
+
+	return caps
+}
+
+// cachedWipeMethod returns the wipe method picked by a previous wipe, if any.
+func (bd *BlockDevice) cachedWipeMethod() string {
+	bd.wipeMu.Lock()
+	defer bd.wipeMu.Unlock()
+
+	return bd.wipeMethod
+}
+
+// setWipeMethod remembers the wipe method for the next wipes.
+func (bd *BlockDevice) setWipeMethod(method string) {
+	bd.wipeMu.Lock()
+	defer bd.wipeMu.Unlock()
+
+	bd.wipeMethod = method
+}
+
+// resetWipeMethod drops the cached wipe method if it is still the method.
+func (bd *BlockDevice) resetWipeMethod(method string) {
+	bd.wipeMu.Lock()
+	defer bd.wipeMu.Unlock()
+
+	if bd.wipeMethod == method {
+		bd.wipeMethod = ""
+	}
+}
+
+// queueDir returns the sysfs queue directory of the device, partitions use the queue of the whole disk.
+func queueDir(devname string) (string, error) {
+	path, err := filepath.EvalSymlinks(filepath.Join("/sys/class/block", filepath.Base(devname)))
+	if err != nil {
 		return "", err
 	}
 
-	defer zero.Close() //nolint: errcheck
+	if _, err = os.Stat(filepath.Join(path, "partition")); err == nil {
+		path = filepath.Dir(path)
+	}
+
+	return filepath.Join(path, "queue"), nil
+}
+
+func readSysfsUint(path string) (uint64, error) {
+	b, err := os.ReadFile(path)
+	if err != nil {
+		return 0, err
+	}
+
+	return strconv.ParseUint(strings.TrimSpace(string(b)), 10, 64)
+}
+
+func roundUp(v, align uint64) uint64 {
+	return (v + align - 1) / align * align
+}
+
+// detectWipeMethod wipes the range with the first supported method.
+func (bd *BlockDevice) detectWipeMethod(engine aio.Engine, start, length uint64) (string, error) {
+	r := [2]uint64{start, length}
+
+	if bd.capabilities().canDiscard() {
+		if errno := bd.ioctl("BLKSECDISCARD", BLKSECDISCARD, unsafe.Pointer(&r[0])); errno == 0 {
+			return wipeSecDiscard, nil
+		}
+
+		var zeroes int
+
+		if errno := bd.ioctl("BLKDISCARDZEROES", BLKDISCARDZEROES, unsafe.Pointer(&zeroes)); errno == 0 && zeroes != 0 {
+			if errno = bd.ioctl("BLKDISCARD", BLKDISCARD, unsafe.Pointer(&r[0])); errno == 0 {
+				return wipeDiscardZeroes, nil
+			}
+		}
+	}
+
+	return bd.zeroRange(engine, start, length)
+}
+
+// zeroRange zeroes out the range with BLKZEROOUT, falling back to writing zeroes.
+//
+// BLKZEROOUT is skipped for the devices which don't support write zeroes.
+func (bd *BlockDevice) zeroRange(engine aio.Engine, start, length uint64) (string, error) {
+	r := [2]uint64{start, length}
+
+	if bd.capabilities().canZeroOut() {
+		if errno := bd.ioctl("BLKZEROOUT", BLKZEROOUT, unsafe.Pointer(&r[0])); errno == 0 {
+			return wipeZeroOut, nil
+		}
+	}
+
+	return wipeWriteZeroes, bd.writeZeroes(engine, start, length)
+}
+
+// wipeChunk wipes the range with the method.
+func (bd *BlockDevice) wipeChunk(engine aio.Engine, method string, start, length uint64) error {
+	var (
+		op   uintptr
+		name string
+	)
+
+	switch method {
+	case wipeSecDiscard:
+		op, name = BLKSECDISCARD, "BLKSECDISCARD"
+	case wipeDiscardZeroes:
+		op, name = BLKDISCARD, "BLKDISCARD"
+	case wipeZeroOut:
+		op, name = BLKZEROOUT, "BLKZEROOUT"
+	default:
+		return bd.writeZeroes(engine, start, length)
+	}
+
+	r := [2]uint64{start, length}
+
+	if errno := bd.ioctl(name, op, unsafe.Pointer(&r[0])); errno != 0 {
+		return errno
+	}
+
+	return nil
+}
+
+// ioctl issues the ioctl on the block device, reporting it to the observer as op.
+func (bd *BlockDevice) ioctl(op string, req uintptr, arg unsafe.Pointer) syscall.Errno {
+	s := observe.Start(bd.observer, observe.KindIoctl, bd.f.Name(), op)
 
-	_, err = io.CopyN(bd.f, zero, int64(r[1]))
+	_, _, errno := unix.Syscall(unix.SYS_IOCTL, bd.f.Fd(), req, uintptr(arg))
 
-	return "writezeroes", err
+	s.EndErrno(errno)
+
+	return errno
+}
+
+// writeZeroes writes zeroes to the range from the shared zero buffer.
+//
+// With the engine set, all writes for the range are submitted as a single batch.
+func (bd *BlockDevice) writeZeroes(engine aio.Engine, start, length uint64) error {
+	if engine != nil {
+		ops := make([]aio.Op, 0, (length+wipeZeroBufferSize-1)/wipeZeroBufferSize)
+
+		for off := start; off < start+length; off += wipeZeroBufferSize {
+			n := start + length - off
+			if n > wipeZeroBufferSize {
+				n = wipeZeroBufferSize
+			}
+
+			ops = append(ops, aio.Op{Type: aio.OpWrite, File: bd.f, Buf: zeroBuffer[:n], Offset: int64(off)})
+		}
+
+		s := observe.Start(bd.observer, observe.KindIO, bd.f.Name(), "write zeroes")
+
+		err := engine.Submit(ops)
+		if err == nil {
+			err = aio.Err(ops)
+		}
+
+		s.End(err)
+
+		return err
+	}
+
+	for length > 0 {
+		n := length
+		if n > wipeZeroBufferSize {
+			n = wipeZeroBufferSize
+		}
+
+		s := observe.Start(bd.observer, observe.KindIO, bd.f.Name(), "write zeroes")
+
+		_, err := bd.f.WriteAt(zeroBuffer[:n], int64(start))
+
+		s.End(err)
+
+		if err != nil {
+			return err
+		}
+
+		start += n
+		length -= n
+	}
+
+	return nil
 }
 
 // Reset will reset a block device given a device name.
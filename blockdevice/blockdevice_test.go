@@ -5,12 +5,361 @@
 package blockdevice_test
 
 import (
+	"bytes"
+	"context"
+	"os"
+	"sync"
 	"testing"
+
+	"github.com/stretchr/testify/suite"
+
+	"github.com/siderolabs/go-blockdevice/blockdevice"
+	"github.com/siderolabs/go-blockdevice/blockdevice/aio"
+	"github.com/siderolabs/go-blockdevice/blockdevice/observe"
+	"github.com/siderolabs/go-blockdevice/blockdevice/partition/gpt"
+	"github.com/siderolabs/go-blockdevice/blockdevice/test"
 )
 
-func TestEmpty(_ *testing.T) {
-	// added for accurate coverage estimation
-	//
-	// please remove it once any unit-test is added
-	// for this package
+type BlockDeviceSuite struct {
+	test.BlockDeviceSuite
+}
+
+func (suite *BlockDeviceSuite) SetupTest() {
+	suite.CreateBlockDevice(1024 * 1024 * 1024)
+}
+
+func (suite *BlockDeviceSuite) TestPartitionTableCache() {
+	bd, err := blockdevice.Open(suite.LoopbackDevice.Name(), blockdevice.WithNewGPT(true), blockdevice.WithPartitionTableCache(true))
+	suite.Require().NoError(err)
+
+	defer bd.Close() //nolint:errcheck
+
+	g, err := bd.PartitionTable()
+	suite.Require().NoError(err)
+
+	_, err = g.Add(1024*1024, gpt.WithPartitionName("boot"))
+	suite.Require().NoError(err)
+
+	suite.Require().NoError(g.Write())
+
+	// in-memory table is still valid after the write
+	cached, err := bd.PartitionTable()
+	suite.Require().NoError(err)
+	suite.Require().Same(g, cached)
+	suite.Require().Len(cached.Partitions().Items(), 1)
+
+	// update the partition table bypassing the block device
+	other, err := gpt.Open(suite.Dev)
+	suite.Require().NoError(err)
+	suite.Require().NoError(other.Read())
+
+	_, err = other.Add(1024*1024, gpt.WithPartitionName("efi"))
+	suite.Require().NoError(err)
+
+	suite.Require().NoError(other.Write())
+
+	// header change is detected
+	g, err = bd.PartitionTable()
+	suite.Require().NoError(err)
+	suite.Require().Len(g.Partitions().Items(), 2)
+
+	part, err := bd.GetPartition("efi")
+	suite.Require().NoError(err)
+	suite.Assert().EqualValues(2, part.Number)
+
+	// in-memory changes are kept until invalidated
+	suite.Require().NoError(g.Delete(part))
+
+	_, err = bd.GetPartition("efi")
+	suite.Require().ErrorIs(err, os.ErrNotExist)
+
+	bd.InvalidatePartitionTable()
+
+	_, err = bd.GetPartition("efi")
+	suite.Require().NoError(err)
+}
+
+func (suite *BlockDeviceSuite) TestWipeRangeContext() {
+	const (
+		start  = 1024 * 1024
+		length = 16 * 1024 * 1024
+	)
+
+	data := bytes.Repeat([]byte{0xaa}, start+length+1024*1024)
+
+	_, err := suite.Dev.WriteAt(data, 0)
+	suite.Require().NoError(err)
+
+	bd, err := blockdevice.Open(suite.LoopbackDevice.Name())
+	suite.Require().NoError(err)
+
+	defer bd.Close() //nolint:errcheck
+
+	var reported []uint64
+
+	method, err := bd.WipeRangeContext(context.Background(), start, length,
+		blockdevice.WithWipeConcurrency(4),
+		blockdevice.WithWipeChunkSize(1024*1024),
+		blockdevice.WithWipeProgress(func(done, total uint64) {
+			suite.Assert().EqualValues(length, total)
+
+			reported = append(reported, done)
+		}),
+	)
+	suite.Require().NoError(err)
+	suite.Assert().NotEmpty(method)
+
+	suite.Assert().Len(reported, 16)
+	suite.Assert().EqualValues(length, reported[len(reported)-1])
+
+	_, err = suite.Dev.ReadAt(data, 0)
+	suite.Require().NoError(err)
+
+	suite.Assert().Equal(bytes.Repeat([]byte{0xaa}, start), data[:start])
+	suite.Assert().Equal(make([]byte, length), data[start:start+length])
+	suite.Assert().Equal(bytes.Repeat([]byte{0xaa}, 1024*1024), data[start+length:])
+
+	// unaligned range, the method is cached
+	_, err = suite.Dev.WriteAt(bytes.Repeat([]byte{0xbb}, 3*4096), 0)
+	suite.Require().NoError(err)
+
+	cached, err := bd.WipeRangeContext(context.Background(), 1000, 2*4096)
+	suite.Require().NoError(err)
+	suite.Assert().Equal(method, cached)
+
+	_, err = suite.Dev.ReadAt(data[:3*4096], 0)
+	suite.Require().NoError(err)
+
+	suite.Assert().Equal(bytes.Repeat([]byte{0xbb}, 1000), data[:1000])
+	suite.Assert().Equal(make([]byte, 2*4096), data[1000:1000+2*4096])
+	suite.Assert().Equal(bytes.Repeat([]byte{0xbb}, 3*4096-1000-2*4096), data[1000+2*4096:3*4096])
+
+	ctx, cancel := context.WithCancel(context.Background())
+	cancel()
+
+	_, err = bd.WipeRangeContext(ctx, 0, length)
+	suite.Assert().ErrorIs(err, context.Canceled)
+}
+
+func (suite *BlockDeviceSuite) TestWipeRangeConcurrent() {
+	const length = 8 * 1024 * 1024
+
+	data := bytes.Repeat([]byte{0xaa}, 2*length)
+
+	_, err := suite.Dev.WriteAt(data, 0)
+	suite.Require().NoError(err)
+
+	bd, err := blockdevice.Open(suite.LoopbackDevice.Name())
+	suite.Require().NoError(err)
+
+	defer bd.Close() //nolint:errcheck
+
+	// both wipes detect the capabilities and the method of the fresh device
+	var (
+		wg      sync.WaitGroup
+		methods [2]string
+		errs    [2]error
+	)
+
+	for i := range methods {
+		i := i
+
+		wg.Add(1)
+
+		go func() {
+			defer wg.Done()
+
+			methods[i], errs[i] = bd.WipeRangeContext(context.Background(), uint64(i)*length, length,
+				blockdevice.WithWipeChunkSize(1024*1024),
+			)
+		}()
+	}
+
+	wg.Wait()
+
+	for i := range methods {
+		suite.Require().NoError(errs[i])
+		suite.Assert().NotEmpty(methods[i])
+	}
+
+	_, err = suite.Dev.ReadAt(data, 0)
+	suite.Require().NoError(err)
+
+	suite.Assert().Equal(make([]byte, 2*length), data)
+}
+
+func (suite *BlockDeviceSuite) TestWipeRangeMethodFallback() {
+	const length = 8 * 1024 * 1024
+
+	data := bytes.Repeat([]byte{0xaa}, length)
+
+	_, err := suite.Dev.WriteAt(data, 0)
+	suite.Require().NoError(err)
+
+	bd, err := blockdevice.Open(suite.LoopbackDevice.Name())
+	suite.Require().NoError(err)
+
+	defer bd.Close() //nolint:errcheck
+
+	// loop devices don't support secure discard, the method is picked again
+	bd.SetWipeMethod("blksecdiscard")
+
+	method, err := bd.WipeRangeContext(context.Background(), 0, length, blockdevice.WithWipeChunkSize(1024*1024))
+	suite.Require().NoError(err)
+	suite.Assert().NotEqual("blksecdiscard", method)
+
+	_, err = suite.Dev.ReadAt(data, 0)
+	suite.Require().NoError(err)
+
+	suite.Assert().Equal(make([]byte, length), data)
+
+	// the new method is cached
+	again, err := bd.WipeRangeContext(context.Background(), 0, length, blockdevice.WithWipeChunkSize(1024*1024))
+	suite.Require().NoError(err)
+	suite.Assert().Equal(method, again)
+}
+
+func (suite *BlockDeviceSuite) TestFastWipeContext() {
+	data := bytes.Repeat([]byte{0xaa}, blockdevice.FastWipeRange)
+
+	_, err := suite.Dev.WriteAt(data, 0)
+	suite.Require().NoError(err)
+
+	bd, err := blockdevice.Open(suite.LoopbackDevice.Name())
+	suite.Require().NoError(err)
+
+	defer bd.Close() //nolint:errcheck
+
+	ctx, cancel := context.WithCancel(context.Background())
+	cancel()
+
+	_, _, err = bd.FastWipeContext(ctx)
+	suite.Require().ErrorIs(err, context.Canceled)
+
+	method, _, err := bd.FastWipeContext(context.Background())
+	suite.Require().NoError(err)
+	suite.Assert().NotEmpty(method)
+
+	_, err = suite.Dev.ReadAt(data, 0)
+	suite.Require().NoError(err)
+
+	suite.Assert().Equal(make([]byte, blockdevice.FastWipeRange), data)
+}
+
+func (suite *BlockDeviceSuite) TestObserver() {
+	var events []observe.Event
+
+	bd, err := blockdevice.Open(suite.LoopbackDevice.Name(), blockdevice.WithObserver(observe.Func(func(ev observe.Event) {
+		events = append(events, ev)
+	})))
+	suite.Require().NoError(err)
+
+	defer bd.Close() //nolint:errcheck
+
+	// drop the partition table probe done by Open
+	events = nil
+
+	suite.Require().NoError(bd.RereadPartitionTable())
+
+	suite.Require().Len(events, 3)
+
+	suite.Assert().Equal(observe.KindIoctl, events[0].Kind)
+	suite.Assert().Equal("BLKFLSBUF", events[0].Op)
+	suite.Assert().Equal(suite.LoopbackDevice.Name(), events[0].Device)
+
+	suite.Assert().Equal(observe.KindIoctl, events[1].Kind)
+	suite.Assert().Equal("BLKRRPART", events[1].Op)
+	suite.Assert().NoError(events[1].Err)
+
+	suite.Assert().Equal(observe.KindRetry, events[2].Kind)
+	suite.Assert().Equal(1, events[2].Attempt)
+}
+
+func (suite *BlockDeviceSuite) TestObserverPartitionTable() {
+	ops := map[observe.Kind][]string{}
+
+	bd, err := blockdevice.Open(suite.LoopbackDevice.Name(), blockdevice.WithNewGPT(true), blockdevice.WithObserver(observe.Func(func(ev observe.Event) {
+		suite.Assert().Equal(suite.LoopbackDevice.Name(), ev.Device)
+
+		ops[ev.Kind] = append(ops[ev.Kind], ev.Op)
+	})))
+	suite.Require().NoError(err)
+
+	defer bd.Close() //nolint:errcheck
+
+	pt, err := bd.PartitionTable()
+	suite.Require().NoError(err)
+
+	_, err = pt.Add(1024*1024, gpt.WithPartitionName("boot"))
+	suite.Require().NoError(err)
+
+	suite.Require().NoError(pt.Write())
+
+	suite.Assert().Contains(ops[observe.KindIO], "read")
+	suite.Assert().Contains(ops[observe.KindIO], "writev")
+	suite.Assert().Contains(ops[observe.KindIO], "sync")
+	suite.Assert().Contains(ops[observe.KindIoctl], "BLKPG_ADD_PARTITION")
+	suite.Assert().Contains(ops[observe.KindRetry], "BLKPG_ADD_PARTITION")
+}
+
+func TestBlockDeviceSuite(t *testing.T) {
+	if os.Getuid() != 0 {
+		t.Skip("can't run the test as non-root")
+	}
+
+	suite.Run(t, new(BlockDeviceSuite))
+}
+
+func BenchmarkWipeRange(b *testing.B) {
+	const size = 64 * 1024 * 1024
+
+	for _, tc := range []struct {
+		name   string
+		method string
+		engine bool
+	}{
+		{name: "blksecdiscard", method: "blksecdiscard"},
+		{name: "blkdiscardzeros", method: "blkdiscardzeros"},
+		{name: "blkzeroout", method: "blkzeroout"},
+		{name: "writezeroes", method: "writezeroes"},
+		{name: "writezeroes-aio", method: "writezeroes", engine: true},
+	} {
+		tc := tc
+
+		b.Run(tc.name, func(b *testing.B) {
+			d := test.CreateBenchmarkBlockDevice(b, size)
+
+			bd, err := blockdevice.Open(d.LoopbackDevice.Name())
+			if err != nil {
+				b.Fatal(err)
+			}
+
+			defer bd.Close() //nolint:errcheck
+
+			var opts []blockdevice.WipeOption
+
+			if tc.engine {
+				e := aio.New()
+				defer e.Close() //nolint:errcheck
+
+				opts = append(opts, blockdevice.WithWipeEngine(e))
+			}
+
+			bd.SetWipeMethod(tc.method)
+
+			if _, err = bd.WipeRangeContext(context.Background(), 0, size, opts...); err != nil {
+				b.Skipf("%s is not supported: %s", tc.method, err)
+			}
+
+			b.SetBytes(size)
+			b.ReportAllocs()
+			b.ResetTimer()
+
+			for i := 0; i < b.N; i++ {
+				if _, err = bd.WipeRangeContext(context.Background(), 0, size, opts...); err != nil {
+					b.Fatal(err)
+				}
+			}
+		})
+	}
 }
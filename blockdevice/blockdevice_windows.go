@@ -41,6 +41,14 @@ func (bd *BlockDevice) PartitionTable() (*gpt.GPT, error) {
 	return nil, fmt.Errorf("not implemented")
 }
 
+// ReloadPartitionTable re-reads the block device partition table from disk.
+func (bd *BlockDevice) ReloadPartitionTable() (*gpt.GPT, error) {
+	return nil, fmt.Errorf("not implemented")
+}
+
+// InvalidatePartitionTable drops the cached partition table, so that it is re-read on next access.
+func (bd *BlockDevice) InvalidatePartitionTable() {}
+
 // RereadPartitionTable invokes the BLKRRPART ioctl to have the kernel read the
 // partition table.
 //
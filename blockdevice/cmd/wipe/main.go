@@ -6,43 +6,149 @@
 package main
 
 import (
+	"context"
+	"encoding/json"
 	"flag"
 	"log"
+	"os"
+	"os/signal"
+	"sync"
+	"syscall"
+	"time"
 
 	"github.com/siderolabs/go-blockdevice/blockdevice"
 )
 
+// result is the outcome of wiping a single device.
+type result struct {
+	Device    string  `json:"device"`
+	Method    string  `json:"method,omitempty"`
+	Bytes     uint64  `json:"bytes"`
+	Discarded bool    `json:"discarded,omitempty"`
+	Duration  float64 `json:"duration_seconds"`
+	MBps      float64 `json:"mb_per_second"`
+	Error     string  `json:"error,omitempty"`
+}
+
 func main() {
 	fastWipe := flag.Bool("fast", true, "Use fast wipe instead of full wipe")
+	parallel := flag.Int("parallel", 1, "Number of devices to wipe concurrently")
+	jsonOutput := flag.Bool("json", false, "Print JSON summary to stdout")
 	flag.Parse()
 
-	for _, dev := range flag.Args() {
-		dev := dev
+	ctx, cancel := signal.NotifyContext(context.Background(), os.Interrupt, syscall.SIGTERM)
+	defer cancel()
+
+	if *parallel < 1 {
+		*parallel = 1
+	}
 
-		log.Printf("Processing device %q", dev)
+	devices := flag.Args()
+	results := make([]result, len(devices))
 
-		var method string
+	sem := make(chan struct{}, *parallel)
 
-		if err := func() error {
-			bd, err := blockdevice.Open(dev)
-			if err != nil {
-				return err
-			}
+	var wg sync.WaitGroup
+
+	for i, dev := range devices {
+		i, dev := i, dev
+
+		wg.Add(1)
+
+		go func() {
+			defer wg.Done()
+
+			sem <- struct{}{}
+			defer func() { <-sem }()
+
+			results[i] = wipe(ctx, dev, *fastWipe)
+		}()
+	}
 
-			defer bd.Close() //nolint: errcheck
+	wg.Wait()
 
-			if *fastWipe {
-				err = bd.FastWipe()
-				method = "fast"
-			} else {
-				method, err = bd.Wipe()
+	failed := 0
+
+	for _, r := range results {
+		if r.Error != "" {
+			failed++
+
+			log.Printf("Failed wiping %q: %s", r.Device, r.Error)
+		}
+	}
+
+	if *jsonOutput {
+		enc := json.NewEncoder(os.Stdout)
+		enc.SetIndent("", "  ")
+
+		if err := enc.Encode(results); err != nil {
+			log.Fatalf("Failed to encode summary: %s", err)
+		}
+	}
+
+	if failed > 0 {
+		log.Fatalf("Failed wiping %d of %d devices", failed, len(devices))
+	}
+}
+
+func wipe(ctx context.Context, dev string, fastWipe bool) result {
+	log.Printf("Processing device %q", dev)
+
+	r := result{Device: dev}
+	start := time.Now()
+
+	err := func() error {
+		bd, err := blockdevice.Open(dev)
+		if err != nil {
+			return err
+		}
+
+		defer bd.Close() //nolint: errcheck
+
+		size, err := bd.Size()
+		if err != nil {
+			return err
+		}
+
+		if fastWipe {
+			r.Method, r.Discarded, err = bd.FastWipeContext(ctx)
+
+			switch {
+			case r.Discarded:
+				r.Bytes = size
+			case size > blockdevice.FastWipeRange:
+				r.Bytes = blockdevice.FastWipeRange
+			default:
+				r.Bytes = size
 			}
 
 			return err
-		}(); err != nil {
-			log.Fatalf("Failed wiping %q: %s", dev, err)
 		}
 
-		log.Printf("Successfully wiped %q via %q", dev, method)
+		r.Bytes = size
+		r.Method, err = bd.WipeRangeContext(ctx, 0, size)
+
+		return err
+	}()
+
+	r.Duration = time.Since(start).Seconds()
+
+	if err != nil {
+		r.Error = err.Error()
+
+		return r
+	}
+
+	if r.Duration > 0 {
+		r.MBps = float64(r.Bytes) / 1e6 / r.Duration
+	}
+
+	method := r.Method
+	if r.Discarded {
+		method = "blkdiscard+" + method
 	}
+
+	log.Printf("Successfully wiped %q via %q: %d bytes in %.1fs (%.1f MB/s)", dev, method, r.Bytes, r.Duration, r.MBps)
+
+	return r
 }
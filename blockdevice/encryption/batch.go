@@ -0,0 +1,145 @@
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+package encryption
+
+import (
+	"errors"
+	"fmt"
+	"sync"
+
+	"github.com/siderolabs/go-blockdevice/blockdevice/encryption/token"
+)
+
+// OperationType is the kind of keyslot or token change applied by a batch.
+type OperationType int
+
+const (
+	// OperationAddKey adds a new key.
+	OperationAddKey OperationType = iota
+	// OperationSetKey replaces the key in the slot.
+	OperationSetKey
+	// OperationRemoveKey removes the key and the token in the slot.
+	OperationRemoveKey
+	// OperationSetToken sets the token for the slot.
+	OperationSetToken
+	// OperationRemoveToken removes the token for the slot.
+	OperationRemoveToken
+)
+
+// Operation is a single step of a batch.
+type Operation struct {
+	Key   *Key
+	Token token.Token
+	Type  OperationType
+	Slot  int
+}
+
+// AddKeyOperation adds a new key at the key slot.
+func AddKeyOperation(newKey *Key) Operation {
+	return Operation{Type: OperationAddKey, Key: newKey, Slot: newKey.Slot}
+}
+
+// SetKeyOperation replaces the key at the key slot with the new key.
+func SetKeyOperation(newKey *Key) Operation {
+	return Operation{Type: OperationSetKey, Key: newKey, Slot: newKey.Slot}
+}
+
+// RemoveKeyOperation removes the key (and the token) at the key slot.
+func RemoveKeyOperation(slot int) Operation {
+	return Operation{Type: OperationRemoveKey, Slot: slot}
+}
+
+// SetTokenOperation sets the token for the key slot.
+func SetTokenOperation(slot int, token token.Token) Operation {
+	return Operation{Type: OperationSetToken, Slot: slot, Token: token}
+}
+
+// RemoveTokenOperation removes the token for the key slot.
+func RemoveTokenOperation(slot int) Operation {
+	return Operation{Type: OperationRemoveToken, Slot: slot}
+}
+
+// Batch is a list of operations applied to a device unlocked with the key.
+type Batch struct {
+	Key        *Key
+	DeviceName string
+	Operations []Operation
+}
+
+// ApplyBatches applies the batches concurrently, at most concurrency devices at a time.
+//
+// The batches are applied with BatchProvider.Batch if the provider implements it, otherwise
+// the operations are applied one by one. All batches are attempted, the errors are joined.
+func ApplyBatches(provider Provider, concurrency int, batches ...Batch) error {
+	if concurrency < 1 {
+		concurrency = 1
+	}
+
+	var (
+		wg   sync.WaitGroup
+		errs = make([]error, len(batches))
+		sem  = make(chan struct{}, concurrency)
+	)
+
+	for i := range batches {
+		i := i
+
+		wg.Add(1)
+
+		go func() {
+			defer wg.Done()
+
+			sem <- struct{}{}
+			defer func() { <-sem }()
+
+			if err := applyBatch(provider, batches[i]); err != nil {
+				errs[i] = fmt.Errorf("error applying batch to %q: %w", batches[i].DeviceName, err)
+			}
+		}()
+	}
+
+	wg.Wait()
+
+	return errors.Join(errs...)
+}
+
+func applyBatch(provider Provider, batch Batch) error {
+	if batchProvider, ok := provider.(BatchProvider); ok {
+		return batchProvider.Batch(batch.DeviceName, batch.Key, batch.Operations...)
+	}
+
+	for i, op := range batch.Operations {
+		if err := applyOperation(provider, batch.DeviceName, batch.Key, op); err != nil {
+			return fmt.Errorf("batch operation %d failed: %w", i, err)
+		}
+	}
+
+	return nil
+}
+
+func applyOperation(provider Provider, devname string, key *Key, op Operation) error {
+	switch op.Type {
+	case OperationAddKey:
+		return provider.AddKey(devname, key, op.Key)
+	case OperationSetKey:
+		return provider.SetKey(devname, key, op.Key)
+	case OperationRemoveKey:
+		if err := provider.RemoveKey(devname, op.Slot, key); err != nil {
+			return err
+		}
+
+		if err := provider.RemoveToken(devname, op.Slot); err != nil && !errors.Is(err, ErrTokenNotFound) {
+			return err
+		}
+
+		return nil
+	case OperationSetToken:
+		return provider.SetToken(devname, op.Slot, op.Token)
+	case OperationRemoveToken:
+		return provider.RemoveToken(devname, op.Slot)
+	default:
+		return fmt.Errorf("unknown batch operation %d", op.Type)
+	}
+}
@@ -0,0 +1,104 @@
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+package encryption_test
+
+import (
+	"fmt"
+	"sync"
+	"testing"
+
+	"github.com/stretchr/testify/assert"
+	"github.com/stretchr/testify/require"
+
+	"github.com/siderolabs/go-blockdevice/blockdevice/encryption"
+	"github.com/siderolabs/go-blockdevice/blockdevice/encryption/token"
+)
+
+// mockProvider records the calls, it doesn't implement encryption.BatchProvider.
+type mockProvider struct {
+	calls []string
+	mu    sync.Mutex
+}
+
+func (p *mockProvider) record(format string, args ...any) error {
+	p.mu.Lock()
+	defer p.mu.Unlock()
+
+	p.calls = append(p.calls, fmt.Sprintf(format, args...))
+
+	return nil
+}
+
+func (p *mockProvider) Encrypt(string, *encryption.Key) error { return nil }
+
+func (p *mockProvider) Open(string, *encryption.Key) (string, error) { return "", nil }
+
+func (p *mockProvider) Close(string) error { return nil }
+
+func (p *mockProvider) AddKey(devname string, key, newKey *encryption.Key) error {
+	return p.record("%s: add %d with %d", devname, newKey.Slot, key.Slot)
+}
+
+func (p *mockProvider) SetKey(devname string, key, newKey *encryption.Key) error {
+	return p.record("%s: set %d with %d", devname, newKey.Slot, key.Slot)
+}
+
+func (p *mockProvider) CheckKey(string, *encryption.Key) (bool, error) { return true, nil }
+
+func (p *mockProvider) RemoveKey(devname string, slot int, key *encryption.Key) error {
+	return p.record("%s: remove %d with %d", devname, slot, key.Slot)
+}
+
+func (p *mockProvider) ReadKeyslots(string) (*encryption.Keyslots, error) {
+	return &encryption.Keyslots{}, nil
+}
+
+func (p *mockProvider) SetToken(devname string, slot int, _ token.Token) error {
+	return p.record("%s: set token %d", devname, slot)
+}
+
+func (p *mockProvider) ReadToken(string, int, token.Token) error { return nil }
+
+func (p *mockProvider) RemoveToken(devname string, slot int) error {
+	if err := p.record("%s: remove token %d", devname, slot); err != nil {
+		return err
+	}
+
+	return encryption.ErrTokenNotFound
+}
+
+func TestApplyBatchesFallback(t *testing.T) {
+	t.Parallel()
+
+	provider := &mockProvider{}
+	key := encryption.NewKey(0, []byte("key"))
+
+	require.NoError(t, encryption.ApplyBatches(provider, 1, encryption.Batch{
+		DeviceName: "/dev/sda",
+		Key:        key,
+		Operations: []encryption.Operation{
+			encryption.AddKeyOperation(encryption.NewKey(1, []byte("new"))),
+			encryption.SetTokenOperation(1, nil),
+			encryption.SetKeyOperation(encryption.NewKey(1, []byte("newer"))),
+			encryption.RemoveKeyOperation(1),
+		},
+	}))
+
+	assert.Equal(t, []string{
+		"/dev/sda: add 1 with 0",
+		"/dev/sda: set token 1",
+		"/dev/sda: set 1 with 0",
+		"/dev/sda: remove 1 with 0",
+		"/dev/sda: remove token 1",
+	}, provider.calls)
+
+	err := encryption.ApplyBatches(provider, 1, encryption.Batch{
+		DeviceName: "/dev/sdb",
+		Key:        key,
+		Operations: []encryption.Operation{encryption.RemoveTokenOperation(2)},
+	})
+	require.ErrorIs(t, err, encryption.ErrTokenNotFound)
+	assert.Contains(t, err.Error(), "batch operation 0 failed")
+}
@@ -0,0 +1,323 @@
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+package luks
+
+import (
+	"bytes"
+	"encoding/hex"
+	"errors"
+	"fmt"
+	"io"
+	"os/exec"
+	"strconv"
+
+	"github.com/siderolabs/go-blockdevice/blockdevice/encryption"
+	"github.com/siderolabs/go-blockdevice/blockdevice/observe"
+)
+
+// Batch implements encryption.BatchProvider.
+//
+// The device is unlocked once with the key before the first keyslot change, and the
+// volume key is reused for all keyslot changes, so that the key derivation for the
+// unlock key runs only once. The volume key is kept in an anonymous memory file and
+// never hits the disk.
+//
+// The batch refuses to remove or replace the last keyslot of the device.
+func (l *LUKS) Batch(devname string, key *encryption.Key, ops ...encryption.Operation) error {
+	var vk *volumeKeyFile
+
+	defer func() {
+		if vk != nil {
+			vk.Close() //nolint:errcheck
+		}
+	}()
+
+	for i, op := range ops {
+		// dumping the volume key verifies the key, it is done for the key removals as well,
+		// as the keyslots are killed without asking for a passphrase
+		if vk == nil && isKeyslotOperation(op.Type) {
+			volumeKey, err := l.dumpVolumeKey(devname, key)
+			if err != nil {
+				return err
+			}
+
+			vk, err = newVolumeKeyFile(volumeKey)
+
+			wipe(volumeKey)
+
+			if err != nil {
+				return err
+			}
+		}
+
+		if err := l.applyOperation(devname, vk, op); err != nil {
+			return fmt.Errorf("batch operation %d failed: %w", i, err)
+		}
+	}
+
+	return nil
+}
+
+func (l *LUKS) applyOperation(devname string, vk *volumeKeyFile, op encryption.Operation) error {
+	switch op.Type {
+	case encryption.OperationAddKey:
+		return l.addKeyWithVolumeKey(devname, vk, op.Key)
+	case encryption.OperationSetKey:
+		if op.Key.Slot == encryption.AnyKeyslot {
+			return fmt.Errorf("key slot must be set to replace the key")
+		}
+
+		md, err := ReadMetadata(devname)
+		if err != nil {
+			return err
+		}
+
+		if _, inUse := md.Keyslots[strconv.Itoa(op.Key.Slot)]; inUse {
+			// the slot is killed before the new key is added, make sure the device stays accessible
+			if len(md.Keyslots) < 2 {
+				return fmt.Errorf("refusing to replace the only keyslot %d in a batch", op.Key.Slot)
+			}
+
+			if err = l.killSlot(devname, op.Key.Slot); err != nil {
+				return err
+			}
+		}
+
+		return l.addKeyWithVolumeKey(devname, vk, op.Key)
+	case encryption.OperationRemoveKey:
+		md, err := ReadMetadata(devname)
+		if err != nil {
+			return err
+		}
+
+		if _, inUse := md.Keyslots[strconv.Itoa(op.Slot)]; inUse && len(md.Keyslots) < 2 {
+			return fmt.Errorf("refusing to remove the only keyslot %d in a batch", op.Slot)
+		}
+
+		if err = l.killSlot(devname, op.Slot); err != nil {
+			return err
+		}
+
+		if err = l.RemoveToken(devname, op.Slot); err != nil && !errors.Is(err, encryption.ErrTokenNotFound) {
+			return err
+		}
+
+		return nil
+	case encryption.OperationSetToken:
+		return l.SetToken(devname, op.Slot, op.Token)
+	case encryption.OperationRemoveToken:
+		return l.RemoveToken(devname, op.Slot)
+	default:
+		return fmt.Errorf("unknown batch operation %d", op.Type)
+	}
+}
+
+func isKeyslotOperation(typ encryption.OperationType) bool {
+	switch typ {
+	case encryption.OperationAddKey, encryption.OperationSetKey, encryption.OperationRemoveKey:
+		return true
+	default:
+		return false
+	}
+}
+
+// dumpVolumeKey unlocks the device with the key and returns the volume key.
+//
+// cryptsetup refuses to store the volume key into an existing file, so the key is parsed
+// from the luksDump output. The output is kept in memory which is wiped once the key is
+// parsed, it never goes through a Go string.
+func (l *LUKS) dumpVolumeKey(devname string, key *encryption.Key) ([]byte, error) {
+	args := []string{"luksDump", devname, "--dump-volume-key", "--key-file=-", "-q"}
+	args = append(args, keyslotArgs(key)...)
+
+	var (
+		stdout wipingBuffer
+		stderr bytes.Buffer
+	)
+
+	defer stdout.Wipe()
+
+	c := exec.Command("cryptsetup", args...)
+	c.Stdin = bytes.NewReader(key.Value)
+	c.Stdout = &stdout
+	c.Stderr = &stderr
+
+	s := observe.Start(l.observer, observe.KindExec, devname, "cryptsetup luksDump")
+
+	err := c.Run()
+
+	s.End(err)
+
+	if err != nil {
+		var exitError *exec.ExitError
+
+		if errors.As(err, &exitError) {
+			if exitErr := exitCodeError(exitError.ExitCode(), stderr.Bytes()); exitErr != nil {
+				return nil, exitErr
+			}
+		}
+
+		return nil, fmt.Errorf("failed to call cryptsetup: %w: %s", err, stderr.Bytes())
+	}
+
+	return parseVolumeKeyDump(stdout.Bytes())
+}
+
+// parseVolumeKeyDump extracts the hex encoded volume key from the luksDump output.
+//
+//	MK bits:       	512
+//	MK dump:	1c 59 9d ...
+//			...
+//
+// The label of the dump differs between cryptsetup versions, so any label ending with
+// "dump" is accepted. The key length is checked against the "bits" line if it is present.
+func parseVolumeKeyDump(out []byte) ([]byte, error) {
+	var (
+		bits    int
+		dumping bool
+	)
+
+	// the hex dump is at least twice the size of the key, so the key is never reallocated
+	key := make([]byte, 0, len(out)/2)
+
+	fail := func(err error) ([]byte, error) {
+		wipe(key[:cap(key)])
+
+		return nil, err
+	}
+
+	for rest := out; len(rest) > 0; {
+		var line []byte
+
+		line, rest, _ = bytes.Cut(rest, []byte("\n"))
+
+		if !dumping {
+			label, value, found := bytes.Cut(line, []byte(":"))
+			if !found {
+				continue
+			}
+
+			label = bytes.TrimSpace(label)
+
+			if bytes.HasSuffix(label, []byte("bits")) {
+				bits, _ = strconv.Atoi(string(bytes.TrimSpace(value))) //nolint:errcheck
+			}
+
+			if !bytes.HasSuffix(label, []byte("dump")) {
+				continue
+			}
+
+			line = value
+			dumping = true
+		} else if !bytes.HasPrefix(line, []byte(" ")) && !bytes.HasPrefix(line, []byte("\t")) {
+			break
+		}
+
+		for _, field := range bytes.Fields(line) {
+			n, err := hex.Decode(key[len(key):cap(key)], field)
+			if err != nil {
+				// the decoding error is not wrapped, it quotes the dump
+				return fail(errors.New("failed to decode volume key in cryptsetup output"))
+			}
+
+			key = key[:len(key)+n]
+		}
+	}
+
+	if len(key) == 0 {
+		return fail(errors.New("failed to find volume key in cryptsetup output"))
+	}
+
+	if bits != 0 && len(key)*8 != bits {
+		return fail(fmt.Errorf("volume key in cryptsetup output is %d bits, expected %d", len(key)*8, bits))
+	}
+
+	return key, nil
+}
+
+// wipingBuffer collects the command output, the memory is zeroed when it is released.
+type wipingBuffer struct {
+	buf []byte
+}
+
+// ReadFrom implements io.ReaderFrom, so that the output is read right into the buffer,
+// and not via the intermediate buffer of io.Copy.
+func (w *wipingBuffer) ReadFrom(r io.Reader) (int64, error) {
+	var total int64
+
+	for {
+		if len(w.buf) == cap(w.buf) {
+			w.grow(4096)
+		}
+
+		n, err := r.Read(w.buf[len(w.buf):cap(w.buf)])
+
+		w.buf = w.buf[:len(w.buf)+n]
+		total += int64(n)
+
+		if errors.Is(err, io.EOF) {
+			return total, nil
+		}
+
+		if err != nil {
+			return total, err
+		}
+	}
+}
+
+// Write implements io.Writer.
+func (w *wipingBuffer) Write(p []byte) (int, error) {
+	if len(w.buf)+len(p) > cap(w.buf) {
+		w.grow(len(p))
+	}
+
+	w.buf = append(w.buf, p...)
+
+	return len(p), nil
+}
+
+// Bytes returns the collected output, it is valid until the buffer is wiped.
+func (w *wipingBuffer) Bytes() []byte {
+	return w.buf
+}
+
+// Wipe zeroes the buffer.
+func (w *wipingBuffer) Wipe() {
+	wipe(w.buf[:cap(w.buf)])
+
+	w.buf = w.buf[:0]
+}
+
+func (w *wipingBuffer) grow(n int) {
+	buf := make([]byte, len(w.buf), 2*cap(w.buf)+n)
+	copy(buf, w.buf)
+
+	wipe(w.buf[:cap(w.buf)])
+
+	w.buf = buf
+}
+
+func wipe(b []byte) {
+	for i := range b {
+		b[i] = 0
+	}
+}
+
+func (l *LUKS) addKeyWithVolumeKey(devname string, vk *volumeKeyFile, newKey *encryption.Key) error {
+	args := []string{"luksAddKey", devname, "--volume-key-file=" + vk.Path(), "-"}
+	args = append(args, l.argonArgs()...)
+	args = append(args, keyslotArgs(newKey)...)
+
+	_, err := l.runCommand(args, newKey.Value)
+
+	return err
+}
+
+// killSlot removes the keyslot without asking for a passphrase, the batch was already unlocked.
+func (l *LUKS) killSlot(devname string, slot int) error {
+	_, err := l.runCommand([]string{"luksKillSlot", "-q", devname, strconv.Itoa(slot)}, nil)
+
+	return err
+}
@@ -0,0 +1,110 @@
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+package luks_test
+
+import (
+	"encoding/hex"
+	"strings"
+	"testing"
+
+	"github.com/stretchr/testify/assert"
+	"github.com/stretchr/testify/require"
+
+	"github.com/siderolabs/go-blockdevice/blockdevice/encryption/luks"
+)
+
+// luksDump --dump-volume-key output in the format printed by cryptsetup 2.3.
+const volumeKeyDump23 = `LUKS header information for /dev/loop0
+Cipher name:   	aes
+Cipher mode:   	xts-plain64
+Payload offset:	32768
+UUID:          	0f3b8a3e-5d0c-4e44-9d1b-2f6f5b1b0c67
+MK bits:       	512
+MK dump:	5c 5f c3 aa c9 5d a9 54 a6 2f 11 09 8b 97 c5 cc
+		4c 05 df 4b 57 be 89 6d 75 73 5f e3 3f c4 3e ce
+		25 dc c0 62 a4 1d 23 1a db 01 03 ac d6 a2 ed f7
+		71 a9 0a 25 b2 2e 07 dd 93 49 96 f7 26 7a 9d 82
+`
+
+// luksDump --dump-volume-key output in the format printed by cryptsetup 2.6.
+const volumeKeyDump26 = `LUKS header information for /dev/loop0
+Cipher name:   	xchacha20,aes-adiantum
+Cipher mode:   	plain64
+Payload offset:	32768
+UUID:          	b2a4c9e1-8d0e-4f35-a7c5-6e1d0a9f3b42
+MK bits:       	256
+MK dump:	65 fb 97 39 01 dc 46 9f b2 52 6a d8 84 95 41 39
+		04 7f 9e 2c 9f 06 a3 86 64 e6 83 a9 66 26 74 61
+`
+
+func TestParseVolumeKeyDump(t *testing.T) {
+	t.Parallel()
+
+	for _, tc := range []struct {
+		name string
+		dump string
+		key  string
+		err  string
+	}{
+		{
+			name: "cryptsetup 2.3",
+			dump: volumeKeyDump23,
+			key:  "5c5fc3aac95da954a62f11098b97c5cc4c05df4b57be896d75735fe33fc43ece25dcc062a41d231adb0103acd6a2edf771a90a25b22e07dd934996f7267a9d82",
+		},
+		{
+			name: "cryptsetup 2.6",
+			dump: volumeKeyDump26,
+			key:  "65fb973901dc469fb2526ad884954139047f9e2c9f06a38664e683a966267461",
+		},
+		{
+			name: "renamed labels",
+			dump: strings.NewReplacer("MK bits:       ", "Volume key bits:", "MK dump:", "Volume key dump:").Replace(volumeKeyDump26),
+			key:  "65fb973901dc469fb2526ad884954139047f9e2c9f06a38664e683a966267461",
+		},
+		{
+			name: "trailing spaces",
+			dump: strings.ReplaceAll(volumeKeyDump23, "\n", " \n"),
+			key:  "5c5fc3aac95da954a62f11098b97c5cc4c05df4b57be896d75735fe33fc43ece25dcc062a41d231adb0103acd6a2edf771a90a25b22e07dd934996f7267a9d82",
+		},
+		{
+			name: "no bits",
+			dump: strings.Replace(volumeKeyDump26, "MK bits:       \t256\n", "", 1),
+			key:  "65fb973901dc469fb2526ad884954139047f9e2c9f06a38664e683a966267461",
+		},
+		{
+			name: "truncated",
+			dump: volumeKeyDump23[:strings.LastIndex(volumeKeyDump23, "\n\t\t")],
+			err:  "volume key in cryptsetup output is 384 bits, expected 512",
+		},
+		{
+			name: "malformed",
+			dump: strings.Replace(volumeKeyDump26, "65 fb", "65 fg", 1),
+			err:  "failed to decode volume key in cryptsetup output",
+		},
+		{
+			name: "no dump",
+			dump: volumeKeyDump26[:strings.Index(volumeKeyDump26, "MK dump:")],
+			err:  "failed to find volume key in cryptsetup output",
+		},
+	} {
+		tc := tc
+
+		t.Run(tc.name, func(t *testing.T) {
+			t.Parallel()
+
+			key, err := luks.ParseVolumeKeyDump([]byte(tc.dump))
+
+			if tc.err != "" {
+				require.EqualError(t, err, tc.err)
+				assert.Nil(t, key)
+
+				return
+			}
+
+			require.NoError(t, err)
+			assert.Equal(t, tc.key, hex.EncodeToString(key))
+		})
+	}
+}
@@ -8,22 +8,18 @@ package luks
 import (
 	"bytes"
 	"context"
-	"encoding/binary"
-	"encoding/json"
 	"errors"
 	"fmt"
-	"os"
 	"regexp"
 	"strconv"
 	"strings"
 	"time"
 
 	"github.com/siderolabs/go-cmd/pkg/cmd"
-	"golang.org/x/sys/unix"
 
 	"github.com/siderolabs/go-blockdevice/blockdevice/encryption"
 	"github.com/siderolabs/go-blockdevice/blockdevice/encryption/token"
-	"github.com/siderolabs/go-blockdevice/blockdevice/filesystem/luks"
+	"github.com/siderolabs/go-blockdevice/blockdevice/observe"
 	"github.com/siderolabs/go-blockdevice/blockdevice/util"
 )
 
@@ -113,6 +109,8 @@ type LUKS struct {
 	pbkdfMemory          uint64
 	blockSize            uint64
 	keySize              uint
+	tuning               *tuningOptions
+	observer             observe.Observer
 }
 
 // New creates new LUKS2 encryption provider.
@@ -134,6 +132,12 @@ func New(cipher Cipher, options ...Option) *LUKS {
 
 // Open runs luksOpen on a device and returns mapped device path.
 func (l *LUKS) Open(deviceName string, key *encryption.Key) (string, error) {
+	// the cipher is stored in the header, so there is nothing to benchmark
+	l, err := l.tune(deviceName, false)
+	if err != nil {
+		return "", err
+	}
+
 	parts := strings.Split(deviceName, "/")
 	mappedPath := util.PartPathEncrypted(parts[len(parts)-1])
 	parts = strings.Split(mappedPath, "/")
@@ -143,7 +147,7 @@ func (l *LUKS) Open(deviceName string, key *encryption.Key) (string, error) {
 	args = append(args, keyslotArgs(key)...)
 	args = append(args, l.perfArgs()...)
 
-	_, err := l.runCommand(args, key.Value)
+	_, err = l.runCommand(args, key.Value)
 	if err != nil {
 		return "", err
 	}
@@ -153,6 +157,11 @@ func (l *LUKS) Open(deviceName string, key *encryption.Key) (string, error) {
 
 // Encrypt implements encryption.Provider.
 func (l *LUKS) Encrypt(deviceName string, key *encryption.Key) error {
+	l, err := l.tune(deviceName, true)
+	if err != nil {
+		return err
+	}
+
 	cipher, err := l.cipher.String()
 	if err != nil {
 		return err
@@ -240,7 +249,20 @@ func (l *LUKS) SetKey(devname string, oldKey, newKey *encryption.Key) error {
 }
 
 // CheckKey checks if the key is valid.
+//
+// Keys for the keyslots which are not in use are rejected without running cryptsetup.
 func (l *LUKS) CheckKey(devname string, key *encryption.Key) (bool, error) {
+	if key.Slot != encryption.AnyKeyslot {
+		md, err := ReadMetadata(devname)
+		if err != nil {
+			return false, err
+		}
+
+		if _, ok := md.Keyslots[strconv.Itoa(key.Slot)]; !ok {
+			return false, nil
+		}
+	}
+
 	args := []string{"luksOpen", "--test-passphrase", devname, "--key-file=-"}
 
 	args = append(args, keyslotArgs(key)...)
@@ -273,36 +295,20 @@ func (l *LUKS) RemoveKey(devname string, slot int, key *encryption.Key) error {
 
 // ReadKeyslots returns deserialized LUKS2 keyslots JSON.
 func (l *LUKS) ReadKeyslots(deviceName string) (*encryption.Keyslots, error) {
-	f, err := os.OpenFile(deviceName, os.O_RDONLY|unix.O_CLOEXEC, os.ModeDevice)
+	md, err := ReadMetadata(deviceName)
 	if err != nil {
 		return nil, err
 	}
 
-	defer f.Close() //nolint:errcheck
-
-	sb := &luks.SuperBlock{}
-
-	if err = binary.Read(f, binary.BigEndian, sb); err != nil {
-		return nil, err
-	}
-
-	size := binary.Size(sb)
-	if _, err = f.Seek(int64(size), 0); err != nil {
-		return nil, err
-	}
-
-	jsonArea := make([]byte, int(sb.HeaderSize)-size)
-
-	if _, err = f.Read(jsonArea); err != nil {
-		return nil, err
+	keyslots := &encryption.Keyslots{
+		Keyslots: make(map[string]*encryption.Keyslot, len(md.Keyslots)),
 	}
 
-	jsonArea = bytes.Trim(bytes.TrimSpace(jsonArea), "\x00")
-
-	var keyslots *encryption.Keyslots
-
-	if err = json.Unmarshal(jsonArea, &keyslots); err != nil {
-		return nil, err
+	for id, keyslot := range md.Keyslots {
+		keyslots.Keyslots[id] = &encryption.Keyslot{
+			Type:    keyslot.Type,
+			KeySize: keyslot.KeySize,
+		}
 	}
 
 	return keyslots, nil
@@ -324,13 +330,20 @@ func (l *LUKS) SetToken(devname string, slot int, token token.Token) error {
 }
 
 // ReadToken reads arbitrary token from the luks metadata.
+//
+// The metadata is read directly from the LUKS2 header.
 func (l *LUKS) ReadToken(devname string, slot int, token token.Token) error {
-	stdout, err := l.runCommand([]string{"token", "export", "-q", devname, "--token-id", strconv.Itoa(slot), "--json-file=-"}, nil)
+	md, err := ReadMetadata(devname)
 	if err != nil {
 		return err
 	}
 
-	return token.Decode([]byte(stdout))
+	data, ok := md.Tokens[strconv.Itoa(slot)]
+	if !ok {
+		return encryption.ErrTokenNotFound
+	}
+
+	return token.Decode(data)
 }
 
 // RemoveToken removes token from the luks metadata.
@@ -344,26 +357,26 @@ var notFoundMatcher = regexp.MustCompile("(is not in use|Failed to get token)")
 
 // runCommand executes cryptsetup with arguments.
 func (l *LUKS) runCommand(args []string, stdin []byte) (string, error) {
+	var op string
+
+	if len(args) > 0 {
+		op = "cryptsetup " + args[0]
+	}
+
+	s := observe.Start(l.observer, observe.KindExec, commandDevice(args), op)
+
 	stdout, err := cmd.RunContext(cmd.WithStdin(
 		context.Background(),
 		bytes.NewBuffer(stdin)), "cryptsetup", args...)
+
+	s.End(err)
+
 	if err != nil {
 		var exitError *cmd.ExitError
 
 		if errors.As(err, &exitError) {
-			switch exitError.ExitCode {
-			case 1:
-				if strings.Contains(string(exitError.Output), "No usable keyslot is available.") {
-					return "", encryption.ErrEncryptionKeyRejected
-				}
-
-				if notFoundMatcher.Match(exitError.Output) {
-					return "", encryption.ErrTokenNotFound
-				}
-			case 2:
-				return "", encryption.ErrEncryptionKeyRejected
-			case 5:
-				return "", encryption.ErrDeviceBusy
+			if exitErr := exitCodeError(exitError.ExitCode, exitError.Output); exitErr != nil {
+				return "", exitErr
 			}
 		}
 
@@ -373,6 +386,37 @@ func (l *LUKS) runCommand(args []string, stdin []byte) (string, error) {
 	return stdout, nil
 }
 
+// exitCodeError maps the cryptsetup exit code and error output to the encryption errors.
+func exitCodeError(exitCode int, output []byte) error {
+	switch exitCode {
+	case 1:
+		if bytes.Contains(output, []byte("No usable keyslot is available.")) {
+			return encryption.ErrEncryptionKeyRejected
+		}
+
+		if notFoundMatcher.Match(output) {
+			return encryption.ErrTokenNotFound
+		}
+	case 2:
+		return encryption.ErrEncryptionKeyRejected
+	case 5:
+		return encryption.ErrDeviceBusy
+	}
+
+	return nil
+}
+
+// commandDevice returns the device the cryptsetup command operates on.
+func commandDevice(args []string) string {
+	for _, arg := range args {
+		if strings.HasPrefix(arg, "/dev/") {
+			return arg
+		}
+	}
+
+	return ""
+}
+
 func (l *LUKS) argonArgs() []string {
 	args := []string{}
 
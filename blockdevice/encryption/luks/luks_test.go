@@ -5,19 +5,26 @@
 package luks_test
 
 import (
+	"bytes"
+	"crypto/sha256"
+	"encoding/binary"
 	"os"
 	"os/exec"
 	"testing"
 	"time"
 
+	"github.com/stretchr/testify/assert"
+	"github.com/stretchr/testify/require"
 	"github.com/stretchr/testify/suite"
 	"golang.org/x/sys/unix"
 
 	"github.com/siderolabs/go-blockdevice/blockdevice"
 	"github.com/siderolabs/go-blockdevice/blockdevice/encryption"
 	"github.com/siderolabs/go-blockdevice/blockdevice/encryption/luks"
+	fsluks "github.com/siderolabs/go-blockdevice/blockdevice/filesystem/luks"
 	"github.com/siderolabs/go-blockdevice/blockdevice/partition/gpt"
 	"github.com/siderolabs/go-blockdevice/blockdevice/test"
+	"github.com/siderolabs/go-blockdevice/blockdevice/util/disk"
 )
 
 const (
@@ -38,7 +45,7 @@ func (suite *LUKSSuite) TestEncrypt() {
 		blockdevice.WithNewGPT(true),
 	)
 
-	var _ encryption.Provider = &luks.LUKS{}
+	var _ encryption.BatchProvider = &luks.LUKS{}
 
 	suite.Require().NoError(err)
 
@@ -126,6 +133,13 @@ func (suite *LUKSSuite) TestEncrypt() {
 
 	suite.Require().Equal(token.UserData.SealedKey, "aaaa")
 
+	md, err := luks.ReadMetadata(path)
+	suite.Require().NoError(err)
+	suite.Require().Contains(md.Tokens, "0")
+	suite.Require().Contains(md.Keyslots, "1")
+	suite.Require().Contains(md.Segments, "0")
+	suite.Require().NotEmpty(md.Digests)
+
 	suite.Require().NoError(provider.RemoveToken(path, 0))
 	suite.Require().Error(provider.ReadToken(path, 0, token))
 
@@ -160,6 +174,36 @@ func (suite *LUKSSuite) TestEncrypt() {
 	_, ok = keyslots.Keyslots["1"]
 	suite.Require().True(ok)
 
+	// rotate keys with a single unlock
+	keyRotated := encryption.NewKey(2, []byte("rotated"))
+
+	suite.Require().NoError(provider.Batch(path, key,
+		encryption.AddKeyOperation(keyRotated),
+		encryption.SetTokenOperation(2, token),
+		encryption.SetKeyOperation(encryption.NewKey(2, []byte("rotated-again"))),
+		encryption.RemoveKeyOperation(2),
+	))
+
+	keyslots, err = provider.ReadKeyslots(path)
+	suite.Require().NoError(err)
+	suite.Require().NotContains(keyslots.Keyslots, "2")
+	suite.Require().ErrorIs(provider.ReadToken(path, 2, token), encryption.ErrTokenNotFound)
+
+	// key removals are checked against the batch key
+	suite.Require().ErrorIs(provider.Batch(path, encryption.NewKey(0, []byte("wrong")),
+		encryption.RemoveKeyOperation(1),
+	), encryption.ErrEncryptionKeyRejected)
+
+	suite.Require().NoError(encryption.ApplyBatches(provider, 2, encryption.Batch{
+		DeviceName: path,
+		Key:        key,
+		Operations: []encryption.Operation{encryption.AddKeyOperation(keyRotated)},
+	}))
+
+	valid, err = provider.CheckKey(path, keyRotated)
+	suite.Require().NoError(err)
+	suite.Require().True(valid)
+
 	// remove key slot
 	err = provider.RemoveKey(path, 1, key)
 	suite.Require().NoError(err)
@@ -181,6 +225,127 @@ func (suite *LUKSSuite) TestEncrypt() {
 	suite.Require().Error(err)
 }
 
+func luksHeader(t *testing.T, magic string, offset, seqID uint64, metadata string) []byte {
+	t.Helper()
+
+	const headerSize = 16 * 1024
+
+	sb := fsluks.SuperBlock{
+		Version:          2,
+		HeaderSize:       headerSize,
+		SeqID:            seqID,
+		SuperBlockOffset: offset,
+	}
+
+	copy(sb.Magic[:], magic)
+	copy(sb.CSumAlg[:], "sha256")
+	copy(sb.UUID[:], "6d6b1e3a-4dca-4a5c-9c8a-0c0cb8a1a8a6")
+
+	var buf bytes.Buffer
+
+	require.NoError(t, binary.Write(&buf, binary.BigEndian, &sb))
+	buf.WriteString(metadata)
+
+	b := make([]byte, headerSize)
+	copy(b, buf.Bytes())
+
+	sum := sha256.Sum256(b)
+	copy(b[0x1c0:], sum[:])
+
+	return b
+}
+
+func TestDecodeMetadata(t *testing.T) {
+	const (
+		older = `{"keyslots":{"0":{"type":"luks2","key_size":64}},"tokens":{},"segments":{},"digests":{},"config":{}}`
+		newer = `{"keyslots":{"0":{"type":"luks2","key_size":64},"1":{"type":"luks2","key_size":64}},` +
+			`"tokens":{"0":{"UserData":{"sealed_key":"aaaa"},"type":"sealedkey","keyslots":[]}},` +
+			`"segments":{"0":{"type":"crypt","offset":"16777216","size":"dynamic","iv_tweak":"0","encryption":"aes-xts-plain64","sector_size":4096}},` +
+			`"digests":{"0":{"type":"pbkdf2","keyslots":["0","1"],"segments":["0"]}},"config":{"json_size":"12288","keyslots_size":"16744448"}}`
+	)
+
+	image := append(luksHeader(t, fsluks.Magic1, 0, 1, older), luksHeader(t, fsluks.Magic2, 16*1024, 2, newer)...)
+
+	// secondary header has the higher sequence id
+	md, err := luks.DecodeMetadata(bytes.NewReader(image))
+	require.NoError(t, err)
+
+	assert.EqualValues(t, 2, md.SeqID)
+	assert.Equal(t, "6d6b1e3a-4dca-4a5c-9c8a-0c0cb8a1a8a6", md.UUID)
+	assert.Len(t, md.Keyslots, 2)
+	assert.Equal(t, 4096, md.Segments["0"].SectorSize)
+	assert.Equal(t, []string{"0", "1"}, md.Digests["0"].Keyslots)
+
+	token := &luks.Token[struct {
+		SealedKey string `json:"sealed_key"`
+	}]{}
+
+	require.NoError(t, token.Decode(md.Tokens["0"]))
+	assert.Equal(t, "aaaa", token.UserData.SealedKey)
+
+	// corrupted secondary header is ignored
+	corrupted := append([]byte(nil), image...)
+	corrupted[16*1024+4096] ^= 0xff
+
+	md, err = luks.DecodeMetadata(bytes.NewReader(corrupted))
+	require.NoError(t, err)
+	assert.EqualValues(t, 1, md.SeqID)
+
+	// corrupted primary header falls back to the secondary one
+	corrupted = append([]byte(nil), image...)
+	corrupted[4096] ^= 0xff
+
+	md, err = luks.DecodeMetadata(bytes.NewReader(corrupted))
+	require.NoError(t, err)
+	assert.EqualValues(t, 2, md.SeqID)
+
+	_, err = luks.DecodeMetadata(bytes.NewReader(make([]byte, 64*1024)))
+	assert.ErrorIs(t, err, luks.ErrInvalidHeader)
+}
+
+func TestNewProfile(t *testing.T) {
+	nvme := &luks.DeviceInfo{
+		Type:              disk.TypeNVMe,
+		LogicalBlockSize:  512,
+		PhysicalBlockSize: 512,
+		Size:              1 << 30,
+	}
+
+	profile := luks.NewProfile(nvme, luks.AESXTSPlain64Cipher, nil)
+	assert.EqualValues(t, 4096, profile.SectorSize)
+	assert.Equal(t, []string{luks.PerfNoReadWorkqueue, luks.PerfNoWriteWorkqueue}, profile.PerfOptions)
+	assert.Equal(t, luks.AESXTSPlain64Cipher, profile.Cipher)
+
+	hdd := &luks.DeviceInfo{
+		Type:              disk.TypeHDD,
+		LogicalBlockSize:  512,
+		PhysicalBlockSize: 512,
+		Size:              1 << 30,
+	}
+
+	profile = luks.NewProfile(hdd, luks.AESXTSPlain64Cipher, nil)
+	assert.EqualValues(t, 0, profile.SectorSize)
+	assert.Empty(t, profile.PerfOptions)
+
+	// 4K physical blocks, but the size is not aligned
+	hdd.PhysicalBlockSize = 4096
+	hdd.Size = 1<<30 + 512
+
+	assert.EqualValues(t, 0, luks.NewProfile(hdd, luks.AESXTSPlain64Cipher, nil).SectorSize)
+
+	// ciphers are switched only if noticeably faster
+	benchmarks := []luks.Benchmark{
+		{Cipher: luks.AESXTSPlain64Cipher, Encryption: 1000, Decryption: 1100},
+		{Cipher: luks.XChaCha12Cipher, Encryption: 1100, Decryption: 1150},
+	}
+
+	assert.Equal(t, luks.AESXTSPlain64Cipher, luks.NewProfile(nvme, luks.AESXTSPlain64Cipher, benchmarks).Cipher)
+
+	benchmarks[0].Encryption = 300
+
+	assert.Equal(t, luks.XChaCha12Cipher, luks.NewProfile(nvme, luks.AESXTSPlain64Cipher, benchmarks).Cipher)
+}
+
 func TestLUKSSuite(t *testing.T) {
 	if os.Getuid() != 0 {
 		t.Skip("can't run the test as non-root")
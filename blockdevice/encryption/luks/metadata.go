@@ -0,0 +1,256 @@
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+package luks
+
+import (
+	"bytes"
+	"crypto/sha1" //nolint:gosec
+	"crypto/sha256"
+	"crypto/sha512"
+	"encoding/json"
+	"errors"
+	"fmt"
+	"hash"
+	"io"
+	"os"
+
+	"golang.org/x/sys/unix"
+
+	"github.com/siderolabs/go-blockdevice/blockdevice/filesystem/luks"
+)
+
+const (
+	// binaryHeaderSize is the size of the LUKS2 binary header.
+	binaryHeaderSize = luks.SuperBlockSize
+	// defaultHeaderSize is the default size of the LUKS2 header with the JSON area.
+	defaultHeaderSize = 16 * 1024
+	// maxHeaderSize is the largest LUKS2 header size allowed by the specification.
+	maxHeaderSize = 4 * 1024 * 1024
+	// checksumOffset is the offset of the checksum in the binary header.
+	checksumOffset = 0x1c0
+	// checksumSize is the size of the checksum field in the binary header.
+	checksumSize = 64
+)
+
+// ErrInvalidHeader is returned when neither of the LUKS2 header copies is valid.
+var ErrInvalidHeader = errors.New("no valid LUKS2 header found")
+
+// Metadata is the LUKS2 metadata read from the JSON area of the header.
+type Metadata struct {
+	// Keyslots by keyslot id.
+	Keyslots map[string]*MetadataKeyslot `json:"keyslots"`
+	// Tokens by token id, kept as raw JSON for token.Token to decode.
+	Tokens map[string]json.RawMessage `json:"tokens"`
+	// Segments by segment id.
+	Segments map[string]*Segment `json:"segments"`
+	// Digests by digest id.
+	Digests map[string]*Digest `json:"digests"`
+	// Config is the metadata config.
+	Config MetadataConfig `json:"config"`
+
+	// SeqID is the sequence id of the header the metadata was read from.
+	SeqID uint64 `json:"-"`
+	// UUID of the LUKS2 device.
+	UUID string `json:"-"`
+	// Label of the LUKS2 device.
+	Label string `json:"-"`
+}
+
+// MetadataKeyslot is a LUKS2 keyslot.
+type MetadataKeyslot struct {
+	Type     string `json:"type"`
+	KeySize  int64  `json:"key_size"`
+	Priority *int   `json:"priority,omitempty"`
+}
+
+// Segment is a LUKS2 data segment.
+type Segment struct {
+	Type       string `json:"type"`
+	Offset     string `json:"offset"`
+	Size       string `json:"size"`
+	IVTweak    string `json:"iv_tweak"`
+	Encryption string `json:"encryption"`
+	SectorSize int    `json:"sector_size"`
+}
+
+// Digest is a LUKS2 volume key digest.
+type Digest struct {
+	Type     string   `json:"type"`
+	Keyslots []string `json:"keyslots"`
+	Segments []string `json:"segments"`
+}
+
+// MetadataConfig is the LUKS2 metadata config.
+type MetadataConfig struct {
+	JSONSize     string `json:"json_size"`
+	KeyslotsSize string `json:"keyslots_size"`
+}
+
+// ReadMetadata reads LUKS2 metadata from the device.
+func ReadMetadata(deviceName string) (*Metadata, error) {
+	f, err := os.OpenFile(deviceName, os.O_RDONLY|unix.O_CLOEXEC, os.ModeDevice)
+	if err != nil {
+		return nil, err
+	}
+
+	defer f.Close() //nolint:errcheck
+
+	return DecodeMetadata(f)
+}
+
+// DecodeMetadata reads and verifies both LUKS2 header copies from r.
+//
+// The header which passes the checksum verification is used, if both are valid,
+// the one with the higher sequence id wins, as in cryptsetup.
+func DecodeMetadata(r io.ReaderAt) (*Metadata, error) {
+	primary, primaryErr := readHeader(r, 0, luks.Magic1)
+
+	var secondaryOffsets []int64
+
+	if primary != nil {
+		secondaryOffsets = []int64{int64(primary.sb.HeaderSize)}
+	} else {
+		// secondary header offset is the primary header size, try all allowed sizes
+		for size := int64(defaultHeaderSize); size <= maxHeaderSize; size *= 2 {
+			secondaryOffsets = append(secondaryOffsets, size)
+		}
+	}
+
+	var secondary *header
+
+	for _, off := range secondaryOffsets {
+		if secondary, _ = readHeader(r, off, luks.Magic2); secondary != nil { //nolint:errcheck
+			break
+		}
+	}
+
+	hdr := primary
+
+	if hdr == nil || (secondary != nil && secondary.sb.SeqID > primary.sb.SeqID) {
+		hdr = secondary
+	}
+
+	if hdr == nil {
+		if primaryErr != nil {
+			return nil, fmt.Errorf("%w: %w", ErrInvalidHeader, primaryErr)
+		}
+
+		return nil, ErrInvalidHeader
+	}
+
+	return hdr.metadata()
+}
+
+type header struct {
+	sb   luks.SuperBlock
+	json []byte
+}
+
+// readHeader reads the binary header and the JSON area with a single read, and verifies the checksum.
+func readHeader(r io.ReaderAt, off int64, magic string) (*header, error) {
+	buf := make([]byte, defaultHeaderSize)
+
+	if err := readFullAt(r, buf, off); err != nil {
+		return nil, err
+	}
+
+	hdr := &header{}
+
+	if err := hdr.sb.Decode(buf); err != nil {
+		return nil, err
+	}
+
+	if string(hdr.sb.Magic[:]) != magic || hdr.sb.Version != 2 {
+		return nil, fmt.Errorf("no LUKS2 header at offset %d", off)
+	}
+
+	size := hdr.sb.HeaderSize
+
+	if size < defaultHeaderSize || size > maxHeaderSize || size&(size-1) != 0 {
+		return nil, fmt.Errorf("invalid LUKS2 header size %d", size)
+	}
+
+	if hdr.sb.SuperBlockOffset != uint64(off) {
+		return nil, fmt.Errorf("LUKS2 header offset mismatch: %d != %d", hdr.sb.SuperBlockOffset, off)
+	}
+
+	if size > uint64(len(buf)) {
+		buf = append(buf, make([]byte, int(size)-len(buf))...)
+
+		if err := readFullAt(r, buf[defaultHeaderSize:], off+defaultHeaderSize); err != nil {
+			return nil, err
+		}
+	}
+
+	if err := verifyChecksum(&hdr.sb, buf); err != nil {
+		return nil, err
+	}
+
+	hdr.json = buf[binaryHeaderSize:]
+
+	return hdr, nil
+}
+
+// verifyChecksum checks the checksum calculated over the whole header with the checksum field zeroed.
+func verifyChecksum(sb *luks.SuperBlock, buf []byte) error {
+	var h hash.Hash
+
+	switch alg := cString(sb.CSumAlg[:]); alg {
+	case "sha256":
+		h = sha256.New()
+	case "sha512":
+		h = sha512.New()
+	case "sha1":
+		h = sha1.New() //nolint:gosec
+	default:
+		return fmt.Errorf("unsupported LUKS2 checksum algorithm %q", alg)
+	}
+
+	h.Write(buf[:checksumOffset])
+	h.Write(make([]byte, checksumSize))
+	h.Write(buf[checksumOffset+checksumSize:])
+
+	sum := h.Sum(nil)
+
+	if !bytes.Equal(sum, sb.Checksum[:len(sum)]) {
+		return fmt.Errorf("LUKS2 header checksum mismatch at offset %d", sb.SuperBlockOffset)
+	}
+
+	return nil
+}
+
+func (hdr *header) metadata() (*Metadata, error) {
+	jsonArea := hdr.json
+
+	if i := bytes.IndexByte(jsonArea, 0); i >= 0 {
+		jsonArea = jsonArea[:i]
+	}
+
+	md := &Metadata{}
+
+	if err := json.Unmarshal(jsonArea, md); err != nil {
+		return nil, fmt.Errorf("failed to decode LUKS2 metadata: %w", err)
+	}
+
+	md.SeqID = hdr.sb.SeqID
+	md.UUID = cString(hdr.sb.UUID[:])
+	md.Label = cString(hdr.sb.Label[:])
+
+	return md, nil
+}
+
+func readFullAt(r io.ReaderAt, buf []byte, off int64) error {
+	_, err := io.ReadFull(io.NewSectionReader(r, off, int64(len(buf))), buf)
+
+	return err
+}
+
+func cString(b []byte) string {
+	if i := bytes.IndexByte(b, 0); i >= 0 {
+		b = b[:i]
+	}
+
+	return string(b)
+}
@@ -5,7 +5,11 @@
 // Package luks provides a way to call LUKS2 cryptsetup.
 package luks
 
-import "time"
+import (
+	"time"
+
+	"github.com/siderolabs/go-blockdevice/blockdevice/observe"
+)
 
 // Option represents luks configuration callback.
 type Option func(l *LUKS)
@@ -51,3 +55,28 @@ func WithPerfOptions(options ...string) Option {
 		l.perfOptions = options
 	}
 }
+
+// WithObserver sets the observer for the cryptsetup runs.
+//
+// If not set, the process-wide observer (see observe.Register) is used.
+func WithObserver(o observe.Observer) Option {
+	return func(l *LUKS) {
+		l.observer = o
+	}
+}
+
+type tuningOptions struct {
+	benchmark bool
+}
+
+// WithTuning enables the device specific dm-crypt tuning in Encrypt and Open, see NewProfile.
+//
+// With benchmark enabled, Encrypt might replace the cipher with a faster one measured by
+// `cryptsetup benchmark`. If no cipher can be benchmarked, the configured cipher is used.
+func WithTuning(benchmark bool) Option {
+	return func(l *LUKS) {
+		l.tuning = &tuningOptions{
+			benchmark: benchmark,
+		}
+	}
+}
@@ -0,0 +1,294 @@
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+package luks
+
+import (
+	"errors"
+	"fmt"
+	"os"
+	"path/filepath"
+	"strconv"
+	"strings"
+	"sync"
+
+	"github.com/siderolabs/go-blockdevice/blockdevice/lba"
+	"github.com/siderolabs/go-blockdevice/blockdevice/util/disk"
+)
+
+const (
+	// tunedSectorSize is the dm-crypt sector size used for flash devices.
+	tunedSectorSize = 4096
+	// cipherSwitchRatio is how much faster another cipher should be to be picked over the requested one.
+	cipherSwitchRatio = 1.2
+)
+
+// DeviceInfo describes the device properties used to build the tuning profile.
+type DeviceInfo struct {
+	Type              disk.Type
+	LogicalBlockSize  int64
+	PhysicalBlockSize int64
+	OptimalIOSize     int64
+	Size              int64
+}
+
+// Benchmark is the measured cipher throughput in MiB/s.
+type Benchmark struct {
+	Cipher     Cipher
+	Encryption float64
+	Decryption float64
+}
+
+// Profile is a set of dm-crypt settings tuned for the device.
+type Profile struct {
+	PerfOptions []string
+	SectorSize  uint64
+	Cipher      Cipher
+}
+
+// NewProfile builds the tuning profile for the device.
+//
+// Flash devices (SSD, NVMe) and devices with 4K physical blocks get 4K dm-crypt sectors,
+// flash devices also bypass the dm-crypt read and write workqueues, as the queueing
+// only adds latency for them. If the benchmarks are provided, the cipher is switched from
+// the requested one only if another cipher is noticeably faster on this machine.
+func NewProfile(info *DeviceInfo, cipher Cipher, benchmarks []Benchmark) *Profile {
+	profile := &Profile{
+		Cipher: cipher,
+	}
+
+	flash := info.Type == disk.TypeNVMe || info.Type == disk.TypeSSD
+
+	if (flash || info.PhysicalBlockSize >= tunedSectorSize || info.OptimalIOSize >= tunedSectorSize) &&
+		info.LogicalBlockSize <= tunedSectorSize && info.Size%tunedSectorSize == 0 {
+		profile.SectorSize = tunedSectorSize
+	}
+
+	if flash {
+		profile.PerfOptions = []string{PerfNoReadWorkqueue, PerfNoWriteWorkqueue}
+	}
+
+	throughput := func(b Benchmark) float64 {
+		if b.Encryption < b.Decryption {
+			return b.Encryption
+		}
+
+		return b.Decryption
+	}
+
+	var requested float64
+
+	for _, b := range benchmarks {
+		if b.Cipher == cipher {
+			requested = throughput(b)
+		}
+	}
+
+	best := requested
+
+	for _, b := range benchmarks {
+		if t := throughput(b); t > best && t > requested*cipherSwitchRatio {
+			best = t
+			profile.Cipher = b.Cipher
+		}
+	}
+
+	return profile
+}
+
+// ReadDeviceInfo reads the tuning inputs for the disk or partition.
+func ReadDeviceInfo(devname string) (*DeviceInfo, error) {
+	f, err := os.OpenFile(devname, os.O_RDONLY, os.ModeDevice)
+	if err != nil {
+		return nil, err
+	}
+
+	defer f.Close() //nolint:errcheck
+
+	l, err := lba.NewLBA(f)
+	if err != nil {
+		return nil, err
+	}
+
+	info := &DeviceInfo{
+		LogicalBlockSize:  l.LogicalBlockSize,
+		PhysicalBlockSize: l.PhysicalBlockSize,
+		OptimalIOSize:     l.OptimalIOSize,
+		Size:              l.TotalSectors * l.LogicalBlockSize,
+	}
+
+	// the disk type is a property of the whole disk
+	if name, err := parentDisk(devname); err == nil {
+		info.Type = disk.Get(name).Type
+	}
+
+	return info, nil
+}
+
+// parentDisk returns the name of the disk for the disk or partition device.
+func parentDisk(devname string) (string, error) {
+	resolved, err := filepath.EvalSymlinks(devname)
+	if err != nil {
+		return "", err
+	}
+
+	sysPath, err := filepath.EvalSymlinks(filepath.Join("/sys/class/block", filepath.Base(resolved)))
+	if err != nil {
+		return "", err
+	}
+
+	if _, err = os.Stat(filepath.Join(sysPath, "partition")); err == nil {
+		return filepath.Base(filepath.Dir(sysPath)), nil
+	}
+
+	return filepath.Base(sysPath), nil
+}
+
+var (
+	benchmarkMu      sync.Mutex
+	benchmarkResults []Benchmark
+)
+
+// RunBenchmark measures the throughput of the supported ciphers with `cryptsetup benchmark`.
+//
+// The ciphers which fail to benchmark (e.g. not available in the kernel) are skipped, the error
+// is returned only if no cipher could be measured. The results are measured once per process,
+// a failed run is retried on the next call.
+func RunBenchmark() ([]Benchmark, error) {
+	benchmarkMu.Lock()
+	defer benchmarkMu.Unlock()
+
+	if benchmarkResults != nil {
+		return benchmarkResults, nil
+	}
+
+	var (
+		results []Benchmark
+		errs    []error
+	)
+
+	for _, cipher := range []Cipher{AESXTSPlain64Cipher, XChaCha12Cipher, XChaCha20Cipher} {
+		b, err := benchmarkCipher(cipher)
+		if err != nil {
+			errs = append(errs, err)
+
+			continue
+		}
+
+		results = append(results, b)
+	}
+
+	if len(results) == 0 {
+		return nil, errors.Join(errs...)
+	}
+
+	benchmarkResults = results
+
+	return results, nil
+}
+
+func benchmarkCipher(cipher Cipher) (Benchmark, error) {
+	name, err := cipher.String()
+	if err != nil {
+		return Benchmark{}, err
+	}
+
+	stdout, err := (&LUKS{}).runCommand([]string{"benchmark", "--cipher", name, fmt.Sprintf("--key-size=%d", keySizeDefaults[cipher])}, nil)
+	if err != nil {
+		return Benchmark{}, fmt.Errorf("failed to benchmark %s: %w", name, err)
+	}
+
+	b, err := parseBenchmark(stdout)
+	if err != nil {
+		return Benchmark{}, err
+	}
+
+	b.Cipher = cipher
+
+	return b, nil
+}
+
+// parseBenchmark parses the cipher benchmark line:
+//
+//	aes-xts        512b      2401.5 MiB/s      2430.3 MiB/s
+func parseBenchmark(out string) (Benchmark, error) {
+	lines := strings.Split(strings.TrimSpace(out), "\n")
+	fields := strings.Fields(lines[len(lines)-1])
+
+	var speeds []float64
+
+	for i := 1; i < len(fields); i++ {
+		if fields[i] != "MiB/s" {
+			continue
+		}
+
+		v, err := strconv.ParseFloat(fields[i-1], 64)
+		if err != nil {
+			return Benchmark{}, fmt.Errorf("failed to parse benchmark output %q: %w", lines[len(lines)-1], err)
+		}
+
+		speeds = append(speeds, v)
+	}
+
+	if len(speeds) != 2 {
+		return Benchmark{}, fmt.Errorf("unexpected benchmark output %q", lines[len(lines)-1])
+	}
+
+	return Benchmark{Encryption: speeds[0], Decryption: speeds[1]}, nil
+}
+
+// tune returns a copy of the provider with the tuning profile for the device applied.
+//
+// The ciphers are benchmarked only if benchmark is set and enabled in the tuning options,
+// if the benchmark fails, the requested cipher is kept. Explicitly configured settings are
+// not overridden.
+func (l *LUKS) tune(devname string, benchmark bool) (*LUKS, error) {
+	if l.tuning == nil {
+		return l, nil
+	}
+
+	info, err := ReadDeviceInfo(devname)
+	if err != nil {
+		return nil, fmt.Errorf("failed to read device info for tuning: %w", err)
+	}
+
+	var benchmarks []Benchmark
+
+	if benchmark && l.tuning.benchmark {
+		//nolint:errcheck
+		benchmarks, _ = RunBenchmark()
+	}
+
+	profile := NewProfile(info, l.cipher, benchmarks)
+
+	tuned := *l
+
+	if tuned.blockSize == 0 {
+		tuned.blockSize = profile.SectorSize
+	}
+
+	if profile.Cipher != tuned.cipher {
+		if tuned.keySize == keySizeDefaults[tuned.cipher] {
+			tuned.keySize = keySizeDefaults[profile.Cipher]
+		}
+
+		tuned.cipher = profile.Cipher
+	}
+
+	tuned.perfOptions = append([]string(nil), l.perfOptions...)
+
+	for _, o := range profile.PerfOptions {
+		found := false
+
+		for _, existing := range tuned.perfOptions {
+			found = found || existing == o
+		}
+
+		if !found {
+			tuned.perfOptions = append(tuned.perfOptions, o)
+		}
+	}
+
+	return &tuned, nil
+}
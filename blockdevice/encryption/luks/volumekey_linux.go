@@ -0,0 +1,49 @@
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+package luks
+
+import (
+	"fmt"
+	"os"
+
+	"golang.org/x/sys/unix"
+)
+
+// volumeKeyFile is an anonymous memory file holding the volume key.
+//
+// The file is close-on-exec, cryptsetup opens it via /proc/<pid>/fd, so that
+// it is not inherited by other processes started concurrently.
+type volumeKeyFile struct {
+	f *os.File
+}
+
+func newVolumeKeyFile(key []byte) (*volumeKeyFile, error) {
+	fd, err := unix.MemfdCreate("luks-volume-key", unix.MFD_CLOEXEC)
+	if err != nil {
+		return nil, fmt.Errorf("failed to create volume key file: %w", err)
+	}
+
+	f := os.NewFile(uintptr(fd), "luks-volume-key")
+
+	if _, err = f.Write(key); err != nil {
+		f.Close() //nolint:errcheck
+
+		return nil, fmt.Errorf("failed to write volume key file: %w", err)
+	}
+
+	return &volumeKeyFile{f: f}, nil
+}
+
+// Path returns the path to pass to cryptsetup.
+func (vk *volumeKeyFile) Path() string {
+	return fmt.Sprintf("/proc/%d/fd/%d", os.Getpid(), vk.f.Fd())
+}
+
+// Close wipes and releases the volume key file.
+func (vk *volumeKeyFile) Close() error {
+	vk.f.Truncate(0) //nolint:errcheck
+
+	return vk.f.Close()
+}
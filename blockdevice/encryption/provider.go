@@ -30,6 +30,12 @@ type Provider interface {
 	ReadKeyslots(deviceName string) (*Keyslots, error)
 }
 
+// BatchProvider is a Provider which applies a batch of operations with a single unlock.
+type BatchProvider interface {
+	Provider
+	Batch(devname string, key *Key, ops ...Operation) error
+}
+
 // TokenProvider represents token management methods.
 type TokenProvider interface {
 	SetToken(devname string, slot int, token token.Token) error
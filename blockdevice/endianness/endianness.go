@@ -13,6 +13,13 @@ import (
 func ToMiddleEndian(data []byte) []byte {
 	b := make([]byte, 16)
 
+	PutMiddleEndian(b, data)
+
+	return b
+}
+
+// PutMiddleEndian is like ToMiddleEndian, but it writes the result into b.
+func PutMiddleEndian(b, data []byte) {
 	// timeLow
 	binary.LittleEndian.PutUint32(b, binary.BigEndian.Uint32(data[0:4]))
 	// timeMid
@@ -20,9 +27,7 @@ func ToMiddleEndian(data []byte) []byte {
 	// timeHigh
 	binary.LittleEndian.PutUint16(b[6:], binary.BigEndian.Uint16(data[6:8]))
 	// clockSeqHi,clockSeqLo,node
-	copy(b[8:], data[8:16])
-
-	return b
+	copy(b[8:16], data[8:16])
 }
 
 // FromMiddleEndian converts a middle-endian byte slice representation of a
@@ -30,6 +35,13 @@ func ToMiddleEndian(data []byte) []byte {
 func FromMiddleEndian(data []byte) []byte {
 	b := make([]byte, 16)
 
+	PutFromMiddleEndian(b, data)
+
+	return b
+}
+
+// PutFromMiddleEndian is like FromMiddleEndian, but it writes the result into b.
+func PutFromMiddleEndian(b, data []byte) {
 	// timeLow
 	binary.BigEndian.PutUint32(b, binary.LittleEndian.Uint32(data[0:4]))
 	// timeMid
@@ -37,7 +49,5 @@ func FromMiddleEndian(data []byte) []byte {
 	// timeHigh
 	binary.BigEndian.PutUint16(b[6:], binary.LittleEndian.Uint16(data[6:8]))
 	// clockSeqHi,clockSeqLo,node
-	copy(b[8:], data[8:16])
-
-	return b
+	copy(b[8:16], data[8:16])
 }
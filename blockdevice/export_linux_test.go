@@ -0,0 +1,10 @@
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+package blockdevice
+
+// SetWipeMethod overrides the detected wipe method for the tests and benchmarks.
+func (bd *BlockDevice) SetWipeMethod(method string) {
+	bd.setWipeMethod(method)
+}
@@ -13,13 +13,16 @@ const (
 	Magic = 0xef53
 )
 
+//go:generate go run ../internal/sbgen -type SuperBlock -endian little
+
 // SuperBlock represents the ext filesystem super block.
 //
 // See https://ext4.wiki.kernel.org/index.php/Ext4_Disk_Layout#The_Super_Block for the reference.
 type SuperBlock struct {
 	_     [0x38]uint8
 	Magic [2]uint8
-	_     [0x3e]uint8
+	_     [0x2e]uint8
+	UUID  [0x10]uint8
 	Label [0x10]uint8
 	_     [0x378]uint8
 }
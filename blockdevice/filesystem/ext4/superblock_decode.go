@@ -0,0 +1,25 @@
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+// Code generated by sbgen from superblock.go. DO NOT EDIT.
+
+package ext4
+
+import "io"
+
+// SuperBlockSize is the size of the on-disk SuperBlock.
+const SuperBlockSize = 0x400
+
+// Decode decodes the SuperBlock from the first SuperBlockSize bytes of b.
+func (sb *SuperBlock) Decode(b []byte) error {
+	if len(b) < SuperBlockSize {
+		return io.ErrUnexpectedEOF
+	}
+
+	copy(sb.Magic[:], b[0x38:0x3a])
+	copy(sb.UUID[:], b[0x68:0x78])
+	copy(sb.Label[:], b[0x78:0x88])
+
+	return nil
+}
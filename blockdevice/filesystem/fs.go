@@ -5,20 +5,25 @@
 package filesystem
 
 import (
+	"context"
 	"encoding/binary"
+	"errors"
 	"io"
 	"os"
+	"sort"
+	"sync"
 	"syscall"
 	"time"
 
-	"github.com/siderolabs/go-retry/retry"
-
+	"github.com/siderolabs/go-blockdevice/blockdevice/aio"
 	"github.com/siderolabs/go-blockdevice/blockdevice/filesystem/ext4"
 	"github.com/siderolabs/go-blockdevice/blockdevice/filesystem/iso9660"
 	"github.com/siderolabs/go-blockdevice/blockdevice/filesystem/luks"
 	"github.com/siderolabs/go-blockdevice/blockdevice/filesystem/msdos"
 	"github.com/siderolabs/go-blockdevice/blockdevice/filesystem/vfat"
 	"github.com/siderolabs/go-blockdevice/blockdevice/filesystem/xfs"
+	"github.com/siderolabs/go-blockdevice/blockdevice/observe"
+	"github.com/siderolabs/go-blockdevice/blockdevice/watch"
 )
 
 // SuperBlocker describes the requirements for file system super blocks.
@@ -34,35 +39,74 @@ const (
 	Unknown string = "unknown"
 )
 
-// Probe checks partition type.
-func Probe(path string) (SuperBlocker, error) { //nolint:ireturn
-	var (
-		f   *os.File
-		err error
-	)
+// probeAlignment is the alignment of the regions read from the device while probing.
+const probeAlignment = 4096
 
-	// Sleep for up to 5s to wait for kernel to create the necessary device files.
-	// If we dont sleep this becomes racy in that the device file does not exist
-	// and it will fail to open.
-	err = retry.Constant(5*time.Second, retry.WithUnits((50 * time.Millisecond))).Retry(func() error {
-		if f, err = os.OpenFile(path, os.O_RDONLY|syscall.O_CLOEXEC, os.ModeDevice); err != nil {
-			if os.IsNotExist(err) {
-				return retry.ExpectedError(err)
+// region is a contiguous range of the device which covers one or more superblocks.
+type region struct {
+	offset int64
+	length int64
+	// bufOffset is the offset of the region in the probe buffer.
+	bufOffset int64
+}
+
+var (
+	probeRegions    []region
+	probeBufferPool sync.Pool
+)
+
+func init() {
+	// build the union of all superblock windows once, merging overlapping windows
+	// so that probing requires as few reads as possible
+	sbs := superblocks()
+
+	windows := make([]region, 0, len(sbs))
+
+	for _, sb := range sbs {
+		start := sb.Offset() / probeAlignment * probeAlignment
+		end := (sb.Offset() + int64(binary.Size(sb)) + probeAlignment - 1) / probeAlignment * probeAlignment
+
+		windows = append(windows, region{offset: start, length: end - start})
+	}
+
+	sort.Slice(windows, func(i, j int) bool { return windows[i].offset < windows[j].offset })
+
+	var size int64
+
+	for _, w := range windows {
+		if n := len(probeRegions); n > 0 && probeRegions[n-1].offset+probeRegions[n-1].length >= w.offset {
+			last := &probeRegions[n-1]
+
+			if end := w.offset + w.length; end > last.offset+last.length {
+				size += end - (last.offset + last.length)
+				last.length = end - last.offset
 			}
 
-			return err
+			continue
 		}
 
-		return nil
-	})
-	if err != nil {
-		return nil, err
+		w.bufOffset = size
+		size += w.length
+
+		probeRegions = append(probeRegions, w)
 	}
 
-	//nolint: errcheck
-	defer f.Close()
+	probeBufferPool.New = func() any {
+		buf := make([]byte, size)
 
-	superblocks := []SuperBlocker{
+		return &buf
+	}
+}
+
+// superBlock is a superblock with the generated decoder.
+type superBlock interface {
+	SuperBlocker
+	Decode(b []byte) error
+}
+
+// superblocks returns the list of supported superblocks in the order they are checked.
+func superblocks() []superBlock {
+	return []superBlock{
 		&iso9660.SuperBlock{},
 		&vfat.SuperBlock{},
 		&msdos.SuperBlock{},
@@ -70,14 +114,130 @@ func Probe(path string) (SuperBlocker, error) { //nolint:ireturn
 		&luks.SuperBlock{},
 		&ext4.SuperBlock{},
 	}
+}
 
-	for _, sb := range superblocks {
-		if _, err = f.Seek(sb.Offset(), io.SeekStart); err != nil {
+// Probe checks partition type.
+func Probe(path string, setters ...Option) (SuperBlocker, error) { //nolint:ireturn
+	opts := NewDefaultOptions(setters...)
+
+	var (
+		f   *os.File
+		err error
+	)
+
+	// Wait for up to 5s for the kernel to create the necessary device files.
+	// If we dont wait this becomes racy in that the device file does not exist
+	// and it will fail to open.
+	ctx, cancel := context.WithTimeout(context.Background(), 5*time.Second)
+	defer cancel()
+
+	open := observe.Retry(opts.Observer, path, "open", func() error {
+		f, err = os.OpenFile(path, os.O_RDONLY|syscall.O_CLOEXEC, os.ModeDevice)
+
+		return err
+	})
+
+	for {
+		if open() == nil {
+			break
+		}
+
+		if !os.IsNotExist(err) {
 			return nil, err
 		}
 
-		err = binary.Read(f, binary.BigEndian, sb)
-		if err != nil {
+		if watch.WaitForNode(ctx, path) != nil {
+			return nil, err
+		}
+	}
+
+	//nolint: errcheck
+	defer f.Close()
+
+	s := observe.Start(opts.Observer, observe.KindIO, path, "probe")
+
+	sb, err := ProbeReader(f)
+
+	s.End(err)
+
+	return sb, err
+}
+
+// ProbeReader checks the filesystem type of the data available via r.
+//
+// All superblock signatures are read at once into a shared buffer, and each
+// superblock is decoded from that buffer.
+func ProbeReader(r io.ReaderAt) (SuperBlocker, error) { //nolint:ireturn
+	bufp := probeBufferPool.Get().(*[]byte) //nolint:errcheck,forcetypeassert
+	defer probeBufferPool.Put(bufp)
+
+	buf := *bufp
+
+	// valid holds the number of bytes actually read for each region
+	valid := make([]int64, len(probeRegions))
+
+	for i, rg := range probeRegions {
+		n, err := r.ReadAt(buf[rg.bufOffset:rg.bufOffset+rg.length], rg.offset)
+		if err != nil && !errors.Is(err, io.EOF) {
+			return nil, err
+		}
+
+		valid[i] = int64(n)
+
+		if int64(n) < rg.length {
+			// short read, nothing past this point
+			break
+		}
+	}
+
+	return probeBuffer(buf, valid)
+}
+
+// ProbeWithEngine checks the filesystem type of f, reading all superblock regions
+// with a single batch submitted to the engine.
+func ProbeWithEngine(f *os.File, e aio.Engine) (SuperBlocker, error) { //nolint:ireturn
+	bufp := probeBufferPool.Get().(*[]byte) //nolint:errcheck,forcetypeassert
+	defer probeBufferPool.Put(bufp)
+
+	buf := *bufp
+
+	ops := make([]aio.Op, len(probeRegions))
+
+	for i, rg := range probeRegions {
+		ops[i] = aio.Op{
+			Type:   aio.OpRead,
+			File:   f,
+			Buf:    buf[rg.bufOffset : rg.bufOffset+rg.length],
+			Offset: rg.offset,
+		}
+	}
+
+	if err := e.Submit(ops); err != nil {
+		return nil, err
+	}
+
+	valid := make([]int64, len(probeRegions))
+
+	for i := range ops {
+		if ops[i].Err != nil {
+			return nil, ops[i].Err
+		}
+
+		valid[i] = int64(ops[i].N)
+
+		if ops[i].N < len(ops[i].Buf) {
+			// short read, nothing past this point
+			break
+		}
+	}
+
+	return probeBuffer(buf, valid)
+}
+
+// probeBuffer decodes the superblocks from the probe buffer.
+func probeBuffer(buf []byte, valid []int64) (SuperBlocker, error) { //nolint:ireturn
+	for _, sb := range superblocks() {
+		if err := sb.Decode(window(buf, valid, sb.Offset())); err != nil {
 			return nil, err
 		}
 
@@ -88,3 +248,21 @@ func Probe(path string) (SuperBlocker, error) { //nolint:ireturn
 
 	return nil, nil //nolint:nilnil
 }
+
+// window returns the contents of the probe buffer starting at device offset off.
+//
+// The returned slice is truncated to the data which was actually read from the device.
+func window(buf []byte, valid []int64, off int64) []byte {
+	for i, rg := range probeRegions {
+		if off >= rg.offset && off < rg.offset+rg.length {
+			start := off - rg.offset
+			if start > valid[i] {
+				start = valid[i]
+			}
+
+			return buf[rg.bufOffset+start : rg.bufOffset+valid[i]]
+		}
+	}
+
+	return nil
+}
@@ -0,0 +1,199 @@
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+package filesystem_test
+
+import (
+	"bytes"
+	"encoding/binary"
+	"math/rand"
+	"os"
+	"path/filepath"
+	"testing"
+
+	"github.com/stretchr/testify/assert"
+	"github.com/stretchr/testify/require"
+
+	"github.com/siderolabs/go-blockdevice/blockdevice/aio"
+	"github.com/siderolabs/go-blockdevice/blockdevice/filesystem"
+	"github.com/siderolabs/go-blockdevice/blockdevice/filesystem/ext4"
+	"github.com/siderolabs/go-blockdevice/blockdevice/filesystem/iso9660"
+	"github.com/siderolabs/go-blockdevice/blockdevice/filesystem/luks"
+	"github.com/siderolabs/go-blockdevice/blockdevice/filesystem/msdos"
+	"github.com/siderolabs/go-blockdevice/blockdevice/filesystem/vfat"
+	"github.com/siderolabs/go-blockdevice/blockdevice/filesystem/xfs"
+	"github.com/siderolabs/go-blockdevice/blockdevice/test"
+)
+
+func TestProbeReader(t *testing.T) {
+	// empty device
+	sb, err := filesystem.ProbeReader(bytes.NewReader(make([]byte, 1024*1024)))
+	require.NoError(t, err)
+	assert.Nil(t, sb)
+
+	// ext4 superblock with a label
+	data := make([]byte, 1024*1024)
+	data[0x438] = ext4.Magic & 0xff
+	data[0x439] = ext4.Magic >> 8
+	copy(data[0x478:], "EXTLABEL")
+
+	sb, err = filesystem.ProbeReader(bytes.NewReader(data))
+	require.NoError(t, err)
+	require.NotNil(t, sb)
+	assert.Equal(t, "ext4", sb.Type())
+	assert.Equal(t, "EXTLABEL", string(bytes.Trim(sb.(*ext4.SuperBlock).Label[:], "\x00")))
+
+	// device which is too small to hold all superblocks
+	_, err = filesystem.ProbeReader(bytes.NewReader(data[:4096]))
+	assert.Error(t, err)
+}
+
+type countingReader struct {
+	*bytes.Reader
+
+	reads int
+}
+
+func (r *countingReader) ReadAt(p []byte, off int64) (int, error) {
+	r.reads++
+
+	return r.Reader.ReadAt(p, off)
+}
+
+func TestIdentify(t *testing.T) {
+	data := make([]byte, 1024*1024)
+	data[0x438] = ext4.Magic & 0xff
+	data[0x439] = ext4.Magic >> 8
+	copy(data[0x468:], []byte{0x12, 0x34, 0x56, 0x78, 0x9a, 0xbc, 0xde, 0xf0, 0x12, 0x34, 0x56, 0x78, 0x9a, 0xbc, 0xde, 0xf0})
+	copy(data[0x478:], "EXTLABEL")
+
+	r := &countingReader{Reader: bytes.NewReader(data)}
+
+	sb, err := filesystem.ProbeType(r, "ext4")
+	require.NoError(t, err)
+	require.NotNil(t, sb)
+	assert.Equal(t, 1, r.reads)
+	assert.Equal(t, "EXTLABEL", filesystem.Label(sb))
+	assert.Equal(t, "12345678-9abc-def0-1234-56789abcdef0", filesystem.UUID(sb))
+
+	sb, err = filesystem.ProbeType(r, "xfs")
+	require.NoError(t, err)
+	assert.Nil(t, sb)
+
+	_, err = filesystem.ProbeType(r, "btrfs")
+	assert.Error(t, err)
+
+	// FAT32, vfat and msdos superblocks are both checked with a single read
+	data = make([]byte, 1024*1024)
+	copy(data[0x43:], []byte{0xef, 0xbe, 0xad, 0xde})
+	copy(data[0x47:], "FATLABEL   ")
+	copy(data[0x52:], "FAT32   ")
+
+	r = &countingReader{Reader: bytes.NewReader(data)}
+
+	sb, err = filesystem.ProbeType(r, "vfat")
+	require.NoError(t, err)
+	require.NotNil(t, sb)
+	assert.Equal(t, 1, r.reads)
+	assert.Equal(t, "FATLABEL", filesystem.Label(sb))
+	assert.Equal(t, "DEAD-BEEF", filesystem.UUID(sb))
+}
+
+func TestDecode(t *testing.T) {
+	data := make([]byte, 8192)
+	rand.New(rand.NewSource(1)).Read(data) //nolint:gosec
+
+	for _, tc := range []struct {
+		name    string
+		order   binary.ByteOrder
+		decoded interface{ Decode([]byte) error }
+		read    any
+	}{
+		{"ext4", binary.LittleEndian, &ext4.SuperBlock{}, &ext4.SuperBlock{}},
+		{"iso9660", binary.LittleEndian, &iso9660.SuperBlock{}, &iso9660.SuperBlock{}},
+		{"luks", binary.BigEndian, &luks.SuperBlock{}, &luks.SuperBlock{}},
+		{"msdos", binary.LittleEndian, &msdos.SuperBlock{}, &msdos.SuperBlock{}},
+		{"vfat", binary.LittleEndian, &vfat.SuperBlock{}, &vfat.SuperBlock{}},
+		{"xfs", binary.BigEndian, &xfs.SuperBlock{}, &xfs.SuperBlock{}},
+	} {
+		tc := tc
+
+		t.Run(tc.name, func(t *testing.T) {
+			require.NoError(t, binary.Read(bytes.NewReader(data), tc.order, tc.read))
+			require.NoError(t, tc.decoded.Decode(data))
+
+			assert.Equal(t, tc.read, tc.decoded)
+
+			assert.Error(t, tc.decoded.Decode(data[:binary.Size(tc.read)-1]))
+
+			assert.Zero(t, testing.AllocsPerRun(10, func() {
+				tc.decoded.Decode(data) //nolint:errcheck
+			}))
+		})
+	}
+}
+
+func TestProbeWithEngine(t *testing.T) {
+	data := make([]byte, 1024*1024)
+	data[0x438] = ext4.Magic & 0xff
+	data[0x439] = ext4.Magic >> 8
+
+	path := filepath.Join(t.TempDir(), "image")
+	require.NoError(t, os.WriteFile(path, data, 0o600))
+
+	f, err := os.Open(path)
+	require.NoError(t, err)
+
+	defer f.Close() //nolint:errcheck
+
+	e := aio.New()
+	defer e.Close() //nolint:errcheck
+
+	sb, err := filesystem.ProbeWithEngine(f, e)
+	require.NoError(t, err)
+	require.NotNil(t, sb)
+	assert.Equal(t, "ext4", sb.Type())
+}
+
+func BenchmarkProbe(b *testing.B) {
+	for _, tc := range []struct {
+		name      string
+		typ       string
+		offset    int64
+		signature string
+	}{
+		{name: "unknown"},
+		{name: "iso9660", typ: "iso9660", offset: 0x8001, signature: "CD001"},
+		{name: "vfat", typ: "vfat", offset: 0x52, signature: "FAT32   "},
+		{name: "msdos", typ: "vfat", offset: 0x36, signature: "FAT16   "},
+		{name: "xfs", typ: "xfs", offset: 0, signature: "XFSB"},
+		{name: "luks", typ: "luks2", offset: 0, signature: "LUKS\xba\xbe\x00\x02"},
+		{name: "ext4", typ: "ext4", offset: 0x438, signature: "\x53\xef"},
+	} {
+		tc := tc
+
+		b.Run(tc.name, func(b *testing.B) {
+			d := test.CreateBenchmarkBlockDevice(b, 16*1024*1024)
+
+			if tc.signature != "" {
+				_, err := d.Dev.WriteAt([]byte(tc.signature), tc.offset)
+				require.NoError(b, err)
+			}
+
+			b.ReportAllocs()
+			b.ResetTimer()
+
+			for i := 0; i < b.N; i++ {
+				sb, err := filesystem.Probe(d.LoopbackDevice.Name())
+				if err != nil {
+					b.Fatal(err)
+				}
+
+				if (sb == nil && tc.typ != "") || (sb != nil && sb.Type() != tc.typ) {
+					b.Fatalf("unexpected probe result %v", sb)
+				}
+			}
+		})
+	}
+}
@@ -0,0 +1,140 @@
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+package filesystem
+
+import (
+	"bytes"
+	"encoding/binary"
+	"errors"
+	"fmt"
+	"io"
+
+	"github.com/google/uuid"
+
+	"github.com/siderolabs/go-blockdevice/blockdevice/filesystem/ext4"
+	"github.com/siderolabs/go-blockdevice/blockdevice/filesystem/iso9660"
+	"github.com/siderolabs/go-blockdevice/blockdevice/filesystem/luks"
+	"github.com/siderolabs/go-blockdevice/blockdevice/filesystem/msdos"
+	"github.com/siderolabs/go-blockdevice/blockdevice/filesystem/vfat"
+	"github.com/siderolabs/go-blockdevice/blockdevice/filesystem/xfs"
+)
+
+// Label returns the filesystem label stored in the superblock, or an empty string.
+func Label(superblock SuperBlocker) string {
+	var label []byte
+
+	switch sb := superblock.(type) {
+	case *iso9660.SuperBlock:
+		label = sb.VolumeID[:]
+	case *vfat.SuperBlock:
+		label = sb.Label[:]
+	case *msdos.SuperBlock:
+		label = sb.Label[:]
+	case *xfs.SuperBlock:
+		label = sb.Fname[:]
+	case *ext4.SuperBlock:
+		label = sb.Label[:]
+	case *luks.SuperBlock:
+		label = sb.Label[:]
+	}
+
+	return string(bytes.Trim(label, " \x00"))
+}
+
+// UUID returns the filesystem UUID stored in the superblock, or an empty string.
+//
+// The UUID is formatted as blkid formats it, e.g. FAT volume serial numbers are
+// formatted as XXXX-XXXX.
+func UUID(superblock SuperBlocker) string {
+	switch sb := superblock.(type) {
+	case *vfat.SuperBlock:
+		return serial(sb.Serno)
+	case *msdos.SuperBlock:
+		return serial(sb.Serno)
+	case *xfs.SuperBlock:
+		return formatUUID(sb.UUID)
+	case *ext4.SuperBlock:
+		return formatUUID(sb.UUID)
+	case *luks.SuperBlock:
+		return string(bytes.Trim(sb.UUID[:], " \x00"))
+	}
+
+	return ""
+}
+
+func formatUUID(b [16]uint8) string {
+	if b == [16]uint8{} {
+		return ""
+	}
+
+	return uuid.UUID(b).String()
+}
+
+func serial(b [4]uint8) string {
+	if b == [4]uint8{} {
+		return ""
+	}
+
+	return fmt.Sprintf("%02X%02X-%02X%02X", b[3], b[2], b[1], b[0])
+}
+
+// ProbeType checks whether r contains a filesystem of the given type.
+//
+// Unlike ProbeReader, only the superblocks of the type are checked, and they are
+// read with a single read. Nil superblock is returned if the filesystem is not found.
+func ProbeType(r io.ReaderAt, typ string) (SuperBlocker, error) { //nolint:ireturn
+	var (
+		candidates []superBlock
+		start, end int64
+	)
+
+	for _, sb := range superblocks() {
+		if sb.Type() != typ {
+			continue
+		}
+
+		sbStart, sbEnd := sb.Offset(), sb.Offset()+int64(binary.Size(sb))
+
+		if len(candidates) == 0 || sbStart < start {
+			start = sbStart
+		}
+
+		if sbEnd > end {
+			end = sbEnd
+		}
+
+		candidates = append(candidates, sb)
+	}
+
+	if len(candidates) == 0 {
+		return nil, fmt.Errorf("unsupported filesystem type %q", typ)
+	}
+
+	buf := make([]byte, end-start)
+
+	n, err := r.ReadAt(buf, start)
+	if err != nil && !errors.Is(err, io.EOF) {
+		return nil, err
+	}
+
+	buf = buf[:n]
+
+	for _, sb := range candidates {
+		off := sb.Offset() - start
+		if off > int64(len(buf)) {
+			continue
+		}
+
+		if err = sb.Decode(buf[off:]); err != nil {
+			continue
+		}
+
+		if sb.Is() {
+			return sb, nil
+		}
+	}
+
+	return nil, nil //nolint:nilnil
+}
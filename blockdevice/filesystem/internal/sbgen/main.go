@@ -0,0 +1,302 @@
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+// Package main implements the superblock decoder generator.
+//
+// sbgen reads the struct definition from the Go source file and writes
+// a Decode method which decodes the struct from a byte slice at fixed offsets,
+// without reflection or allocations. The struct layout is packed, as with
+// encoding/binary, and blank fields are skipped.
+//
+// Usage:
+//
+//	//go:generate go run ../internal/sbgen -type SuperBlock -endian little
+package main
+
+import (
+	"bytes"
+	"flag"
+	"fmt"
+	"go/ast"
+	"go/constant"
+	"go/format"
+	"go/parser"
+	"go/token"
+	"log"
+	"os"
+	"path/filepath"
+	"strings"
+)
+
+func main() {
+	typeName := flag.String("type", "SuperBlock", "struct type to generate the decoder for")
+	endian := flag.String("endian", "big", "byte order of the multi-byte fields: big or little")
+	input := flag.String("input", os.Getenv("GOFILE"), "source file with the struct definition")
+	output := flag.String("output", "", "output file (defaults to <type>_decode.go)")
+
+	flag.Parse()
+
+	if *output == "" {
+		*output = strings.ToLower(*typeName) + "_decode.go"
+	}
+
+	var order string
+
+	switch *endian {
+	case "big":
+		order = "binary.BigEndian"
+	case "little":
+		order = "binary.LittleEndian"
+	default:
+		log.Fatalf("unknown byte order %q", *endian)
+	}
+
+	src, err := generate(*input, *typeName, order)
+	if err != nil {
+		log.Fatal(err)
+	}
+
+	if err = os.WriteFile(*output, src, 0o644); err != nil {
+		log.Fatal(err)
+	}
+}
+
+const header = `// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+`
+
+// field is a decoded struct field.
+type field struct {
+	name   string
+	offset int64
+	// size is the size of a single element
+	size  int64
+	count int64
+	array bool
+}
+
+func generate(input, typeName, order string) ([]byte, error) {
+	fset := token.NewFileSet()
+
+	f, err := parser.ParseFile(fset, input, nil, 0)
+	if err != nil {
+		return nil, err
+	}
+
+	st, err := findStruct(f, typeName)
+	if err != nil {
+		return nil, err
+	}
+
+	var (
+		fields []field
+		offset int64
+	)
+
+	for _, astField := range st.Fields.List {
+		fld, err := layout(astField.Type)
+		if err != nil {
+			return nil, fmt.Errorf("%s: %w", fset.Position(astField.Pos()), err)
+		}
+
+		names := astField.Names
+		if len(names) == 0 {
+			return nil, fmt.Errorf("%s: embedded fields are not supported", fset.Position(astField.Pos()))
+		}
+
+		for _, name := range names {
+			if name.Name != "_" {
+				fld.name = name.Name
+				fld.offset = offset
+
+				fields = append(fields, fld)
+			}
+
+			offset += fld.size * fld.count
+		}
+	}
+
+	multiByte := false
+
+	for _, fld := range fields {
+		if fld.size > 1 {
+			multiByte = true
+		}
+	}
+
+	var buf bytes.Buffer
+
+	buf.WriteString(header)
+
+	fmt.Fprintf(&buf, "// Code generated by sbgen from %s. DO NOT EDIT.\n\n", filepath.Base(input))
+	fmt.Fprintf(&buf, "package %s\n\n", f.Name.Name)
+
+	if multiByte {
+		buf.WriteString("import (\n\"encoding/binary\"\n\"io\"\n)\n\n")
+	} else {
+		buf.WriteString("import \"io\"\n\n")
+	}
+
+	fmt.Fprintf(&buf, "// %sSize is the size of the on-disk %s.\n", typeName, typeName)
+	fmt.Fprintf(&buf, "const %sSize = %#x\n\n", typeName, offset)
+
+	recv := strings.ToLower(typeName[:1])
+	if typeName == "SuperBlock" {
+		recv = "sb"
+	}
+
+	fmt.Fprintf(&buf, "// Decode decodes the %s from the first %sSize bytes of b.\n", typeName, typeName)
+	fmt.Fprintf(&buf, "func (%s *%s) Decode(b []byte) error {\n", recv, typeName)
+	fmt.Fprintf(&buf, "if len(b) < %sSize {\nreturn io.ErrUnexpectedEOF\n}\n\n", typeName)
+
+	for _, fld := range fields {
+		end := fld.offset + fld.size*fld.count
+
+		switch {
+		case fld.array && fld.size == 1:
+			fmt.Fprintf(&buf, "copy(%s.%s[:], b[%#x:%#x])\n", recv, fld.name, fld.offset, end)
+		case fld.array:
+			fmt.Fprintf(&buf, "for i := range %s.%s {\n", recv, fld.name)
+			fmt.Fprintf(&buf, "%s.%s[i] = %s.%s(b[%#x+i*%d:])\n", recv, fld.name, order, uintFunc(fld.size), fld.offset, fld.size)
+			buf.WriteString("}\n")
+		case fld.size == 1:
+			fmt.Fprintf(&buf, "%s.%s = b[%#x]\n", recv, fld.name, fld.offset)
+		default:
+			fmt.Fprintf(&buf, "%s.%s = %s.%s(b[%#x:%#x])\n", recv, fld.name, order, uintFunc(fld.size), fld.offset, end)
+		}
+	}
+
+	buf.WriteString("\nreturn nil\n}\n")
+
+	return format.Source(buf.Bytes())
+}
+
+func findStruct(f *ast.File, typeName string) (*ast.StructType, error) {
+	for _, decl := range f.Decls {
+		gen, ok := decl.(*ast.GenDecl)
+		if !ok || gen.Tok != token.TYPE {
+			continue
+		}
+
+		for _, spec := range gen.Specs {
+			ts := spec.(*ast.TypeSpec) //nolint:errcheck,forcetypeassert
+
+			if ts.Name.Name != typeName {
+				continue
+			}
+
+			st, ok := ts.Type.(*ast.StructType)
+			if !ok {
+				return nil, fmt.Errorf("%s is not a struct", typeName)
+			}
+
+			return st, nil
+		}
+	}
+
+	return nil, fmt.Errorf("type %s not found", typeName)
+}
+
+// layout returns the size of the field type.
+func layout(expr ast.Expr) (field, error) {
+	switch t := expr.(type) {
+	case *ast.Ident:
+		size, err := scalarSize(t.Name)
+		if err != nil {
+			return field{}, err
+		}
+
+		return field{size: size, count: 1}, nil
+	case *ast.ArrayType:
+		if t.Len == nil {
+			return field{}, fmt.Errorf("slices are not supported")
+		}
+
+		elem, ok := t.Elt.(*ast.Ident)
+		if !ok {
+			return field{}, fmt.Errorf("only arrays of unsigned integers are supported")
+		}
+
+		size, err := scalarSize(elem.Name)
+		if err != nil {
+			return field{}, err
+		}
+
+		count, err := evalInt(t.Len)
+		if err != nil {
+			return field{}, err
+		}
+
+		return field{size: size, count: count, array: true}, nil
+	default:
+		return field{}, fmt.Errorf("unsupported field type %T", expr)
+	}
+}
+
+func scalarSize(name string) (int64, error) {
+	switch name {
+	case "uint8", "byte":
+		return 1, nil
+	case "uint16":
+		return 2, nil
+	case "uint32":
+		return 4, nil
+	case "uint64":
+		return 8, nil
+	default:
+		return 0, fmt.Errorf("unsupported type %s", name)
+	}
+}
+
+func uintFunc(size int64) string {
+	return fmt.Sprintf("Uint%d", size*8)
+}
+
+// evalInt evaluates the constant integer expression of the array length.
+func evalInt(expr ast.Expr) (int64, error) {
+	v, err := eval(expr)
+	if err != nil {
+		return 0, err
+	}
+
+	n, ok := constant.Int64Val(v)
+	if !ok {
+		return 0, fmt.Errorf("array length is not an integer")
+	}
+
+	return n, nil
+}
+
+func eval(expr ast.Expr) (constant.Value, error) {
+	switch e := expr.(type) {
+	case *ast.BasicLit:
+		if e.Kind != token.INT {
+			return nil, fmt.Errorf("unsupported literal %s", e.Value)
+		}
+
+		return constant.MakeFromLiteral(e.Value, e.Kind, 0), nil
+	case *ast.ParenExpr:
+		return eval(e.X)
+	case *ast.BinaryExpr:
+		x, err := eval(e.X)
+		if err != nil {
+			return nil, err
+		}
+
+		y, err := eval(e.Y)
+		if err != nil {
+			return nil, err
+		}
+
+		if e.Op == token.QUO {
+			return constant.BinaryOp(x, token.QUO_ASSIGN, y), nil
+		}
+
+		return constant.BinaryOp(x, e.Op, y), nil
+	default:
+		return nil, fmt.Errorf("unsupported array length expression %T", expr)
+	}
+}
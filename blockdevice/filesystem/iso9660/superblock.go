@@ -11,6 +11,8 @@ const (
 	Magic = "CD001"
 )
 
+//go:generate go run ../internal/sbgen -type SuperBlock -endian little
+
 // SuperBlock represents the ISO 9660 super block.
 type SuperBlock struct {
 	FType           uint8
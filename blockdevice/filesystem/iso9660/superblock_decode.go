@@ -0,0 +1,32 @@
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+// Code generated by sbgen from superblock.go. DO NOT EDIT.
+
+package iso9660
+
+import "io"
+
+// SuperBlockSize is the size of the on-disk SuperBlock.
+const SuperBlockSize = 0x32d
+
+// Decode decodes the SuperBlock from the first SuperBlockSize bytes of b.
+func (sb *SuperBlock) Decode(b []byte) error {
+	if len(b) < SuperBlockSize {
+		return io.ErrUnexpectedEOF
+	}
+
+	sb.FType = b[0x0]
+	copy(sb.ID[:], b[0x1:0x6])
+	sb.Version = b[0x6]
+	sb.Flags = b[0x7]
+	copy(sb.SystemID[:], b[0x8:0x28])
+	copy(sb.VolumeID[:], b[0x28:0x48])
+	copy(sb.SpaceSize[:], b[0x50:0x58])
+	copy(sb.EscapeSequences[:], b[0x58:0x60])
+	copy(sb.PublisherID[:], b[0x13e:0x1be])
+	copy(sb.ApplicationID[:], b[0x23e:0x2be])
+
+	return nil
+}
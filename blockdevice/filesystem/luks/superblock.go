@@ -15,6 +15,8 @@ const (
 	Magic2 = "SKUL\xba\xbe"
 )
 
+//go:generate go run ../internal/sbgen -type SuperBlock -endian big
+
 // SuperBlock represents luks encoded partition header.
 type SuperBlock struct {
 	Magic            [6]byte
@@ -0,0 +1,36 @@
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+// Code generated by sbgen from superblock.go. DO NOT EDIT.
+
+package luks
+
+import (
+	"encoding/binary"
+	"io"
+)
+
+// SuperBlockSize is the size of the on-disk SuperBlock.
+const SuperBlockSize = 0x1000
+
+// Decode decodes the SuperBlock from the first SuperBlockSize bytes of b.
+func (sb *SuperBlock) Decode(b []byte) error {
+	if len(b) < SuperBlockSize {
+		return io.ErrUnexpectedEOF
+	}
+
+	copy(sb.Magic[:], b[0x0:0x6])
+	sb.Version = binary.BigEndian.Uint16(b[0x6:0x8])
+	sb.HeaderSize = binary.BigEndian.Uint64(b[0x8:0x10])
+	sb.SeqID = binary.BigEndian.Uint64(b[0x10:0x18])
+	copy(sb.Label[:], b[0x18:0x48])
+	copy(sb.CSumAlg[:], b[0x48:0x68])
+	copy(sb.Salt[:], b[0x68:0xa8])
+	copy(sb.UUID[:], b[0xa8:0xd0])
+	copy(sb.Subsystem[:], b[0xd0:0x100])
+	sb.SuperBlockOffset = binary.BigEndian.Uint64(b[0x100:0x108])
+	copy(sb.Checksum[:], b[0x1c0:0x200])
+
+	return nil
+}
@@ -15,11 +15,14 @@ const (
 	Magic16 = "FAT16"
 )
 
+//go:generate go run ../internal/sbgen -type SuperBlock -endian little
+
 // SuperBlock represents the vfat super block.
 //
 // See https://en.wikipedia.org/wiki/Design_of_the_FAT_file_system#Extended_BIOS_Parameter_Block for the reference.
 type SuperBlock struct {
-	_     [0x2b]uint8
+	_     [0x27]uint8
+	Serno [4]uint8
 	Label [11]uint8
 	Magic [8]uint8
 	_     [0x1cd]uint8
@@ -0,0 +1,25 @@
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+// Code generated by sbgen from superblock.go. DO NOT EDIT.
+
+package msdos
+
+import "io"
+
+// SuperBlockSize is the size of the on-disk SuperBlock.
+const SuperBlockSize = 0x20b
+
+// Decode decodes the SuperBlock from the first SuperBlockSize bytes of b.
+func (sb *SuperBlock) Decode(b []byte) error {
+	if len(b) < SuperBlockSize {
+		return io.ErrUnexpectedEOF
+	}
+
+	copy(sb.Serno[:], b[0x27:0x2b])
+	copy(sb.Label[:], b[0x2b:0x36])
+	copy(sb.Magic[:], b[0x36:0x3e])
+
+	return nil
+}
@@ -0,0 +1,100 @@
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+package vfat
+
+import (
+	"container/list"
+	"sync"
+)
+
+// dirCacheSize is the number of parsed directories kept by the FileSystem.
+const dirCacheSize = 64
+
+// dirListing is a parsed directory with the name index.
+type dirListing struct {
+	entries []directoryEntry
+	byName  map[string]int
+}
+
+func newDirListing(entries []directoryEntry) *dirListing {
+	listing := &dirListing{
+		entries: entries,
+		byName:  make(map[string]int, len(entries)),
+	}
+
+	for i, entry := range entries {
+		// first entry wins, as with the linear scan
+		if _, exists := listing.byName[entry.filename]; !exists {
+			listing.byName[entry.filename] = i
+		}
+	}
+
+	return listing
+}
+
+func (l *dirListing) lookup(name string) (directoryEntry, bool) {
+	i, ok := l.byName[name]
+	if !ok {
+		return directoryEntry{}, false
+	}
+
+	return l.entries[i], true
+}
+
+// dirCache is a LRU cache of parsed directories keyed by the first cluster.
+type dirCache struct {
+	mu    sync.Mutex
+	size  int
+	lru   *list.List
+	items map[uint32]*list.Element
+}
+
+type dirCacheItem struct {
+	listing      *dirListing
+	firstCluster uint32
+}
+
+func newDirCache(size int) *dirCache {
+	return &dirCache{
+		size:  size,
+		lru:   list.New(),
+		items: make(map[uint32]*list.Element, size),
+	}
+}
+
+func (c *dirCache) get(firstCluster uint32) *dirListing {
+	c.mu.Lock()
+	defer c.mu.Unlock()
+
+	el, ok := c.items[firstCluster]
+	if !ok {
+		return nil
+	}
+
+	c.lru.MoveToFront(el)
+
+	return el.Value.(*dirCacheItem).listing //nolint:forcetypeassert
+}
+
+func (c *dirCache) put(firstCluster uint32, listing *dirListing) {
+	c.mu.Lock()
+	defer c.mu.Unlock()
+
+	if el, ok := c.items[firstCluster]; ok {
+		el.Value.(*dirCacheItem).listing = listing //nolint:forcetypeassert
+		c.lru.MoveToFront(el)
+
+		return
+	}
+
+	c.items[firstCluster] = c.lru.PushFront(&dirCacheItem{listing: listing, firstCluster: firstCluster})
+
+	for c.lru.Len() > c.size {
+		oldest := c.lru.Back()
+
+		c.lru.Remove(oldest)
+		delete(c.items, oldest.Value.(*dirCacheItem).firstCluster) //nolint:forcetypeassert
+	}
+}
@@ -0,0 +1,134 @@
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+package vfat_test
+
+import (
+	"fmt"
+	"testing"
+
+	"github.com/stretchr/testify/assert"
+	"github.com/stretchr/testify/require"
+
+	"github.com/siderolabs/go-blockdevice/blockdevice/filesystem/vfat"
+)
+
+func TestDirCacheEviction(t *testing.T) {
+	c := vfat.NewDirCache(3)
+
+	for cluster := uint32(1); cluster <= 3; cluster++ {
+		c.Put(cluster, fmt.Sprintf("dir%d", cluster))
+	}
+
+	// 1 is used, so 2 is the least recently used one
+	_, ok := c.Get(1)
+	require.True(t, ok)
+
+	c.Put(4, "dir4")
+
+	_, ok = c.Get(2)
+	assert.False(t, ok)
+
+	// replacing the listing refreshes it, so 1 is evicted next
+	c.Put(3, "dir3-updated")
+	c.Put(5, "dir5")
+
+	_, ok = c.Get(1)
+	assert.False(t, ok)
+
+	for cluster, expected := range map[uint32]string{3: "dir3-updated", 4: "dir4", 5: "dir5"} {
+		name, ok := c.Get(cluster)
+		assert.True(t, ok, cluster)
+		assert.Equal(t, expected, name)
+	}
+
+	assert.Equal(t, 3, c.Len())
+}
+
+func TestDirCacheCapacity(t *testing.T) {
+	const size = 8
+
+	c := vfat.NewDirCache(size)
+
+	for cluster := uint32(0); cluster < 100; cluster++ {
+		c.Put(cluster, fmt.Sprintf("dir%d", cluster))
+
+		assert.LessOrEqual(t, c.Len(), size)
+	}
+
+	assert.Equal(t, size, c.Len())
+
+	// the most recent listings are kept
+	for cluster := uint32(0); cluster < 100; cluster++ {
+		_, ok := c.Get(cluster)
+		assert.Equal(t, cluster >= 100-size, ok, cluster)
+	}
+}
+
+func TestDirListingLookup(t *testing.T) {
+	names := []string{"boot", "EFI", "config.yaml", "boot", "Boot"}
+
+	for _, tc := range []struct {
+		name     string
+		expected int
+		found    bool
+	}{
+		{"boot", 0, true},
+		{"EFI", 1, true},
+		{"config.yaml", 2, true},
+		{"Boot", 4, true},
+		{"efi", 0, false},
+		{"", 0, false},
+	} {
+		i, found := vfat.LookupListing(names, tc.name)
+		assert.Equal(t, tc.found, found, tc.name)
+
+		if tc.found {
+			// the first entry wins for duplicate names
+			assert.Equal(t, tc.expected, i, tc.name)
+		}
+	}
+}
+
+func TestOpenDirCache(t *testing.T) {
+	for _, tc := range []struct {
+		name      string
+		cacheSize int
+		// reads is the number of reads of the second Open
+		reads int
+	}{
+		{"cached", 2, 0},
+		// the root directory is evicted by the subdirectory, and the other way around
+		{"evicted", 1, 2},
+	} {
+		tc := tc
+
+		t.Run(tc.name, func(t *testing.T) {
+			fs, r := newTestImage().open(t)
+			fs.SetDirCacheSize(tc.cacheSize)
+
+			_, err := fs.Open("sub/nested")
+			require.NoError(t, err)
+
+			// the root directory and the subdirectory are read
+			assert.Equal(t, 2, r.reads)
+
+			r.reads = 0
+
+			_, err = fs.Open("sub/nested")
+			require.NoError(t, err)
+			assert.Equal(t, tc.reads, r.reads)
+
+			r.reads = 0
+
+			// missing files are looked up in the cached listing as well
+			_, err = fs.Open("missing")
+			assert.Error(t, err)
+
+			if tc.cacheSize > 1 {
+				assert.Zero(t, r.reads)
+			}
+		})
+	}
+}
@@ -0,0 +1,72 @@
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+package vfat
+
+// Extent is a run of consecutive clusters.
+type Extent = extent
+
+// NewExtent creates the extent for the tests.
+func NewExtent(cluster, count uint32) Extent {
+	return Extent{cluster: cluster, count: count}
+}
+
+// FatChain exposes fatChain to the tests.
+func (fs *FileSystem) FatChain(firstCluster uint32) []Extent {
+	return fs.fatChain(firstCluster)
+}
+
+// ExtentCount returns the number of clusters in the extent.
+func ExtentCount(ext Extent) uint32 {
+	return ext.count
+}
+
+// SetDirCacheSize replaces the directory cache with an empty one of the given size.
+func (fs *FileSystem) SetDirCacheSize(size int) {
+	fs.dirs = newDirCache(size)
+}
+
+// DirCache exposes dirCache to the tests, listings are identified by the name of their only entry.
+type DirCache struct {
+	c *dirCache
+}
+
+// NewDirCache creates the cache of the given size.
+func NewDirCache(size int) DirCache {
+	return DirCache{c: newDirCache(size)}
+}
+
+// Put adds the listing to the cache.
+func (c DirCache) Put(firstCluster uint32, name string) {
+	c.c.put(firstCluster, newDirListing([]directoryEntry{{filename: name}}))
+}
+
+// Get returns the name of the listing in the cache.
+func (c DirCache) Get(firstCluster uint32) (string, bool) {
+	listing := c.c.get(firstCluster)
+	if listing == nil {
+		return "", false
+	}
+
+	return listing.entries[0].filename, true
+}
+
+// Len returns the number of listings in the cache.
+func (c DirCache) Len() int {
+	return c.c.lru.Len()
+}
+
+// LookupListing builds the listing of the entries with the given names, and looks up the name,
+// returning the position of the entry found.
+func LookupListing(names []string, name string) (int, bool) {
+	entries := make([]directoryEntry, len(names))
+
+	for i := range names {
+		entries[i] = directoryEntry{filename: names[i], firstCluster: uint32(i)}
+	}
+
+	entry, ok := newDirListing(entries).lookup(name)
+
+	return int(entry.firstCluster), ok
+}
@@ -0,0 +1,96 @@
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+package vfat_test
+
+import (
+	"testing"
+
+	"github.com/stretchr/testify/assert"
+
+	"github.com/siderolabs/go-blockdevice/blockdevice/filesystem/vfat"
+)
+
+func TestFatChain(t *testing.T) {
+	// the FAT spans multiple chunks, so that it is decoded in parts
+	const (
+		fatSectors = 320
+		clusters   = fatSectors * imageSectorSize / 4
+		// first cluster of the second 64 KiB chunk of the FAT
+		chunkBoundary = 64 * 1024 / 4
+	)
+
+	img := newImage(fatSectors, 64)
+
+	img.chain(imageRootCluster)
+	// contiguous
+	img.chain(3, 4, 5, 6)
+	// fragmented, including a backwards jump
+	img.chain(10, 11, 20, 21, 22, 12)
+	// loop
+	img.fat[30], img.fat[31], img.fat[32] = 31, 32, 30
+	// self loop
+	img.fat[33] = 33
+	// points past the end of the FAT
+	img.fat[40] = clusters + 10
+	// points to a free cluster
+	img.fat[41] = 0
+	img.fat[42] = 43
+	// ends with a bad cluster
+	img.fat[44] = 0x0FFFFFF7
+	// the reserved high bits are masked out
+	img.fat[45] = 0xF0000000 | 46
+	img.fat[46] = fatEndOfChain
+	// crosses the FAT chunk boundary
+	img.chain(chunkBoundary-2, chunkBoundary-1, chunkBoundary, chunkBoundary+1, clusters-1)
+
+	fs, _ := img.open(t)
+
+	for _, tc := range []struct { //nolint:govet
+		name     string
+		first    uint32
+		expected []vfat.Extent
+		loop     bool
+	}{
+		{name: "single", first: imageRootCluster, expected: []vfat.Extent{vfat.NewExtent(imageRootCluster, 1)}},
+		{name: "contiguous", first: 3, expected: []vfat.Extent{vfat.NewExtent(3, 4)}},
+		{name: "fragmented", first: 10, expected: []vfat.Extent{vfat.NewExtent(10, 2), vfat.NewExtent(20, 3), vfat.NewExtent(12, 1)}},
+		{name: "loop", first: 30, loop: true},
+		{name: "self loop", first: 33, loop: true},
+		{name: "out of range next", first: 40, expected: []vfat.Extent{vfat.NewExtent(40, 1)}},
+		{name: "out of range first", first: clusters},
+		{name: "reserved first", first: 1},
+		{name: "free cluster", first: 41, expected: []vfat.Extent{vfat.NewExtent(41, 1)}},
+		{name: "free next", first: 42, expected: []vfat.Extent{vfat.NewExtent(42, 2)}},
+		{name: "bad cluster", first: 44, expected: []vfat.Extent{vfat.NewExtent(44, 1)}},
+		{name: "masked", first: 45, expected: []vfat.Extent{vfat.NewExtent(45, 2)}},
+		{
+			name:     "chunk boundary",
+			first:    chunkBoundary - 2,
+			expected: []vfat.Extent{vfat.NewExtent(chunkBoundary-2, 4), vfat.NewExtent(clusters-1, 1)},
+		},
+	} {
+		tc := tc
+
+		t.Run(tc.name, func(t *testing.T) {
+			chain := fs.FatChain(tc.first)
+
+			if !tc.loop {
+				assert.Equal(t, tc.expected, chain)
+
+				return
+			}
+
+			// loops terminate, and the chain is never longer than the FAT
+			var n uint32
+
+			for _, ext := range chain {
+				n += vfat.ExtentCount(ext)
+			}
+
+			assert.NotEmpty(t, chain)
+			assert.LessOrEqual(t, n, uint32(clusters))
+		})
+	}
+}
@@ -6,6 +6,7 @@ package vfat
 
 import (
 	"encoding/binary"
+	"errors"
 	"fmt"
 	"io"
 	"os"
@@ -28,14 +29,27 @@ type FileSystem struct {
 	fatOffset   uint32
 	dataStart   uint64
 
-	fat map[uint32]uint32
+	// fat is the decoded FAT, indexed by cluster number
+	fat []uint32
+
+	dirs *dirCache
 }
 
+const (
+	// fatEntryMask masks out the reserved high bits of the FAT32 entry.
+	fatEntryMask = 0x0FFFFFFF
+	// fatBadCluster marks a bad cluster, values above it mark the end of the chain.
+	fatBadCluster = 0x0FFFFFF7
+	// fatReadChunkSize is the size of the chunks FAT is read and decoded in.
+	fatReadChunkSize = 64 * 1024
+)
+
 // NewFileSystem initializes Filesystem, reads FAT.
 func NewFileSystem(f io.ReaderAt, sb *SuperBlock) (*FileSystem, error) {
 	fs := &FileSystem{
-		sb: sb,
-		f:  f,
+		sb:   sb,
+		f:    f,
+		dirs: newDirCache(dirCacheSize),
 	}
 
 	fs.sectorSize = binary.LittleEndian.Uint16(sb.SectorSize[:])
@@ -44,19 +58,26 @@ func NewFileSystem(f io.ReaderAt, sb *SuperBlock) (*FileSystem, error) {
 	fs.fatOffset = uint32(binary.LittleEndian.Uint16(sb.Reserved[:])) * uint32(fs.sectorSize)
 	fs.dataStart = uint64(fs.fatOffset) + 2*fs.fatSize
 
-	rawFat := make([]byte, fs.fatSize)
+	fs.fat = make([]uint32, fs.fatSize/4)
 
-	if err := readAtFull(fs.f, int64(fs.fatOffset), rawFat); err != nil {
-		return nil, fmt.Errorf("error reading FAT: %w", err)
-	}
+	// decode the FAT in chunks to avoid holding both raw and decoded copies in memory
+	raw := make([]byte, fatReadChunkSize)
 
-	fs.fat = make(map[uint32]uint32)
+	for off := uint64(0); off < uint64(len(fs.fat))*4; off += uint64(len(raw)) {
+		chunk := raw
 
-	for i := uint32(2); i < uint32(fs.fatSize/4); i++ {
-		c := binary.LittleEndian.Uint32(rawFat[i*4 : i*4+4])
+		if remaining := uint64(len(fs.fat))*4 - off; remaining < uint64(len(chunk)) {
+			chunk = chunk[:remaining]
+		}
 
-		if c != 0 {
-			fs.fat[i] = c
+		if err := readAtFull(fs.f, int64(fs.fatOffset)+int64(off), chunk); err != nil {
+			return nil, fmt.Errorf("error reading FAT: %w", err)
+		}
+
+		entries := fs.fat[off/4:]
+
+		for i := 0; i < len(chunk)/4; i++ {
+			entries[i] = binary.LittleEndian.Uint32(chunk[i*4:]) & fatEntryMask
 		}
 	}
 
@@ -64,79 +85,121 @@ func NewFileSystem(f io.ReaderAt, sb *SuperBlock) (*FileSystem, error) {
 }
 
 // Open the file as read-only stream on the filesystem.
+//
+// Parsed directories are cached, so that repeated opens don't re-read
+// the directories along the path.
 func (fs *FileSystem) Open(path string) (*File, error) {
 	components := strings.Split(path, string(os.PathSeparator))
 
 	// start with rootDirectory
-	dir := &directory{
-		fs:           fs,
-		firstCluster: binary.LittleEndian.Uint32(fs.sb.RootCluster[:]),
-	}
+	dirCluster := binary.LittleEndian.Uint32(fs.sb.RootCluster[:])
 
 	for i, component := range components {
 		if component == "" {
 			continue
 		}
 
-		entries, err := dir.scan()
+		listing, err := fs.listDirectory(dirCluster)
 		if err != nil {
 			return nil, err
 		}
 
-		found := false
+		entry, found := listing.lookup(component)
+		if !found {
+			return nil, os.ErrNotExist
+		}
 
-		for _, entry := range entries {
-			if entry.filename == component {
-				found = true
+		if i == len(components)-1 {
+			// should be a file
+			if entry.isDirectory {
+				return nil, fmt.Errorf("expected file entry, but directory found")
+			}
 
-				if i == len(components)-1 {
-					// should be a file
-					if entry.isDirectory {
-						return nil, fmt.Errorf("expected file entry, but directory found")
-					}
+			return &File{
+				fs:    fs,
+				chain: fs.fatChain(entry.firstCluster),
+				size:  entry.size,
+			}, nil
+		}
 
-					return &File{
-						fs:    fs,
-						chain: fs.fatChain(entry.firstCluster),
-						size:  entry.size,
-					}, nil
-				}
+		if !entry.isDirectory {
+			return nil, fmt.Errorf("expected directory, but file found")
+		}
 
-				if !entry.isDirectory {
-					return nil, fmt.Errorf("expected directory, but file found")
-				}
+		dirCluster = entry.firstCluster
+	}
 
-				dir = &directory{
-					fs:           fs,
-					firstCluster: entry.firstCluster,
-				}
+	return nil, os.ErrNotExist
+}
 
-				break
-			}
-		}
+// listDirectory returns the parsed directory, either from the cache or by scanning it.
+func (fs *FileSystem) listDirectory(firstCluster uint32) (*dirListing, error) {
+	if listing := fs.dirs.get(firstCluster); listing != nil {
+		return listing, nil
+	}
 
-		if !found {
-			return nil, os.ErrNotExist
-		}
+	dir := &directory{
+		fs:           fs,
+		firstCluster: firstCluster,
 	}
 
-	return nil, os.ErrNotExist
+	entries, err := dir.scan()
+	if err != nil {
+		return nil, err
+	}
+
+	listing := newDirListing(entries)
+	fs.dirs.put(firstCluster, listing)
+
+	return listing, nil
+}
+
+// extent is a run of consecutive clusters.
+type extent struct {
+	cluster uint32
+	count   uint32
 }
 
-// fatChain results list of clusters for a file (or directory) based on first
+// fatChain returns the list of cluster runs for a file (or directory) based on first
 // cluster number and FAT.
-func (fs *FileSystem) fatChain(firstCluster uint32) []uint32 {
-	chain := []uint32{firstCluster}
+func (fs *FileSystem) fatChain(firstCluster uint32) []extent {
+	var chain []extent
+
+	cluster := firstCluster
+
+	// chain can't be longer than the number of clusters, which also stops on loops in a corrupted FAT
+	for n := 0; n < len(fs.fat) && cluster >= 2 && cluster < uint32(len(fs.fat)); n++ {
+		if last := len(chain) - 1; last >= 0 && chain[last].cluster+chain[last].count == cluster {
+			chain[last].count++
+		} else {
+			chain = append(chain, extent{cluster: cluster, count: 1})
+		}
 
-	for {
-		next := fs.fat[firstCluster]
-		if next == 0 || next&0xFFFFFF8 == 0xFFFFFF8 {
-			return chain
+		next := fs.fat[cluster]
+		if next == 0 || next >= fatBadCluster {
+			break
 		}
 
-		chain = append(chain, next)
-		firstCluster = next
+		cluster = next
+	}
+
+	return chain
+}
+
+// clusterOffset returns the offset of the cluster data.
+func (fs *FileSystem) clusterOffset(cluster uint32) int64 {
+	return int64(fs.dataStart) + int64(cluster-2)*int64(fs.clusterSize)
+}
+
+// chainLength returns the number of clusters in the chain.
+func chainLength(chain []extent) uint32 {
+	var n uint32
+
+	for _, ext := range chain {
+		n += ext.count
 	}
+
+	return n
 }
 
 type directory struct {
@@ -158,12 +221,19 @@ type directoryEntry struct {
 func (d *directory) scan() ([]directoryEntry, error) {
 	// read whole directory into memory
 	chain := d.fs.fatChain(d.firstCluster)
-	raw := make([]byte, uint32(len(chain))*d.fs.clusterSize)
+	raw := make([]byte, chainLength(chain)*d.fs.clusterSize)
+
+	// one read per run of consecutive clusters
+	buf := raw
+
+	for _, ext := range chain {
+		length := ext.count * d.fs.clusterSize
 
-	for i, cluster := range chain {
-		if err := readAtFull(d.fs.f, int64(d.fs.dataStart)+int64(cluster-2)*int64(d.fs.clusterSize), raw[uint32(i)*d.fs.clusterSize:uint32(i+1)*d.fs.clusterSize]); err != nil {
+		if err := readAtFull(d.fs.f, d.fs.clusterOffset(ext.cluster), buf[:length]); err != nil {
 			return nil, fmt.Errorf("error reading directory contents: %w", err)
 		}
+
+		buf = buf[length:]
 	}
 
 	var (
@@ -201,66 +271,144 @@ func (d *directory) scan() ([]directoryEntry, error) {
 			filename:     lfn,
 			isDirectory:  entry[11]&0x10 == 0x10,
 			size:         binary.LittleEndian.Uint32(entry[28:32]),
-			firstCluster: binary.LittleEndian.Uint32(append(entry[26:28], entry[20:22]...)),
+			firstCluster: uint32(binary.LittleEndian.Uint16(entry[26:28])) | uint32(binary.LittleEndian.Uint16(entry[20:22]))<<16,
 		})
+
+		// LFN entries belong to the next short entry only
+		lfn = ""
 	}
 
 	return entries, nil
 }
 
 // File represents a VFAT backed file.
+//
+// File implements io.ReaderAt and io.WriterTo, so that the data is read
+// with one ReadAt per run of consecutive clusters.
 type File struct {
 	fs     *FileSystem
-	chain  []uint32
+	chain  []extent
 	offset uint32
 	size   uint32
 }
 
+// writeToBufferSize is the maximum size of the buffer used by WriteTo.
+const writeToBufferSize = 1024 * 1024
+
+// Read implements io.Reader.
 func (f *File) Read(p []byte) (int, error) {
-	var (
-		n   int
-		err error
-	)
+	if len(p) == 0 {
+		return 0, nil
+	}
 
-	remaining := len(p)
-	if uint32(remaining) > f.size-f.offset {
-		remaining = int(f.size - f.offset)
-		if remaining == 0 {
-			err = io.EOF
+	n, err := f.readAt(p, int64(f.offset))
+	f.offset += uint32(n)
 
-			return n, err
+	if err == io.EOF && n > 0 {
+		err = nil
+	}
+
+	return n, err
+}
+
+// ReadAt implements io.ReaderAt.
+func (f *File) ReadAt(p []byte, off int64) (int, error) {
+	if off < 0 {
+		return 0, fmt.Errorf("negative offset: %d", off)
+	}
+
+	return f.readAt(p, off)
+}
+
+// WriteTo implements io.WriterTo.
+func (f *File) WriteTo(w io.Writer) (int64, error) {
+	if f.offset >= f.size {
+		return 0, nil
+	}
+
+	bufSize := f.size - f.offset
+	if bufSize > writeToBufferSize {
+		bufSize = writeToBufferSize
+	}
+
+	buf := make([]byte, bufSize)
+
+	var written int64
+
+	for f.offset < f.size {
+		n, err := f.readAt(buf, int64(f.offset))
+		if err != nil && err != io.EOF {
+			return written, err
+		}
+
+		m, werr := w.Write(buf[:n])
+		written += int64(m)
+		f.offset += uint32(m)
+
+		if werr != nil {
+			return written, werr
+		}
+
+		if m < n {
+			return written, io.ErrShortWrite
 		}
 	}
 
-	for remaining > 0 {
-		clusterIdx := f.offset / f.fs.clusterSize
-		clusterOffset := f.offset % f.fs.clusterSize
+	return written, nil
+}
 
-		if clusterIdx > uint32(len(f.chain)) {
-			err = fmt.Errorf("FAT chain overrun")
+// readAt reads the file data at the offset, issuing one read per extent.
+//
+// io.EOF is returned if less than len(p) bytes were read.
+func (f *File) readAt(p []byte, off int64) (int, error) {
+	if off >= int64(f.size) {
+		return 0, io.EOF
+	}
 
-			return n, err
+	var eof error
+
+	if remaining := int64(f.size) - off; int64(len(p)) > remaining {
+		p = p[:remaining]
+		eof = io.EOF
+	}
+
+	n := 0
+	extentStart := int64(0)
+
+	for _, ext := range f.chain {
+		if len(p) == 0 {
+			break
 		}
 
-		cluster := f.chain[clusterIdx]
-		readLen := f.fs.clusterSize - clusterOffset
+		extentEnd := extentStart + int64(ext.count)*int64(f.fs.clusterSize)
+
+		if off >= extentEnd {
+			extentStart = extentEnd
+
+			continue
+		}
 
-		if readLen > uint32(remaining) {
-			readLen = uint32(remaining)
+		readLen := extentEnd - off
+		if readLen > int64(len(p)) {
+			readLen = int64(len(p))
 		}
 
-		if err = readAtFull(f.fs.f, int64(f.fs.dataStart)+int64(cluster-2)*int64(f.fs.clusterSize)+int64(clusterOffset), p[:readLen]); err != nil {
+		if err := readAtFull(f.fs.f, f.fs.clusterOffset(ext.cluster)+(off-extentStart), p[:readLen]); err != nil {
 			return n, err
 		}
 
-		remaining -= int(readLen)
 		n += int(readLen)
-		f.offset += readLen
-
+		off += readLen
 		p = p[readLen:]
+
+		extentStart = extentEnd
 	}
 
-	return n, err
+	if len(p) > 0 {
+		return n, fmt.Errorf("FAT chain overrun")
+	}
+
+	return n, eof
 }
 
 // Seek sets the offset for the next Read or Write on file to offset, interpreted
@@ -287,7 +435,7 @@ func readAtFull(r io.ReaderAt, off int64, buf []byte) error {
 
 	for remaining > 0 {
 		n, err := r.ReadAt(buf, off)
-		if err != nil {
+		if err != nil && !(errors.Is(err, io.EOF) && n == remaining) {
 			return err
 		}
 
@@ -0,0 +1,311 @@
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+package vfat_test
+
+import (
+	"bytes"
+	"encoding/binary"
+	"io"
+	"os"
+	"os/exec"
+	"path/filepath"
+	"testing"
+
+	"github.com/stretchr/testify/assert"
+	"github.com/stretchr/testify/require"
+	"golang.org/x/sys/unix"
+
+	"github.com/siderolabs/go-blockdevice/blockdevice/filesystem/vfat"
+	"github.com/siderolabs/go-blockdevice/blockdevice/test"
+)
+
+const (
+	contiguousSize = 3*imageClusterSize - 100
+	fragmentedSize = 5 * imageClusterSize
+	shortSize      = 5 * imageClusterSize
+	nestedSize     = 10
+)
+
+// newTestImage creates the image with files of different layouts.
+func newTestImage() *image {
+	img := newImage(1, 64)
+
+	img.write(dir(
+		imageEntry{name: "contiguous", size: contiguousSize, firstCluster: 3},
+		imageEntry{name: "fragmented", size: fragmentedSize, firstCluster: 6},
+		// the chain is shorter than the file size
+		imageEntry{name: "short", size: shortSize, firstCluster: 20},
+		imageEntry{name: "empty"},
+		imageEntry{name: "sub", isDirectory: true, firstCluster: 24},
+	), imageRootCluster)
+
+	img.write(pattern(contiguousSize, 1), 3, 4, 5)
+	img.write(pattern(fragmentedSize, 2), 6, 7, 10, 11, 8)
+	img.write(pattern(2*imageClusterSize, 3), 20, 21)
+
+	img.write(dir(imageEntry{name: "nested", size: nestedSize, firstCluster: 25}), 24)
+	img.write(pattern(nestedSize, 4), 25)
+
+	return img
+}
+
+func TestFileReadAt(t *testing.T) {
+	fs, r := newTestImage().open(t)
+
+	contiguous := pattern(contiguousSize, 1)
+	fragmented := pattern(fragmentedSize, 2)
+
+	for _, tc := range []struct { //nolint:govet
+		name string
+		path string
+		off  int64
+		n    int
+
+		expected []byte
+		err      error
+		reads    int
+	}{
+		{name: "start", path: "contiguous", off: 0, n: 100, expected: contiguous[:100], reads: 1},
+		{name: "whole contiguous", path: "contiguous", off: 0, n: contiguousSize, expected: contiguous, reads: 1},
+		{name: "cluster boundary", path: "contiguous", off: 500, n: 24, expected: contiguous[500:524], reads: 1},
+		{name: "extent boundary", path: "fragmented", off: 1000, n: 100, expected: fragmented[1000:1100], reads: 2},
+		{name: "whole fragmented", path: "fragmented", off: 0, n: fragmentedSize, expected: fragmented, reads: 3},
+		{name: "last extent", path: "fragmented", off: 4 * imageClusterSize, n: 100, expected: fragmented[2048:2148], reads: 1},
+		{name: "across EOF", path: "contiguous", off: contiguousSize - 10, n: 100, expected: contiguous[contiguousSize-10:], err: io.EOF, reads: 1},
+		{name: "at EOF", path: "contiguous", off: contiguousSize, n: 100, expected: []byte{}, err: io.EOF},
+		{name: "past EOF", path: "contiguous", off: contiguousSize + 1000, n: 100, expected: []byte{}, err: io.EOF},
+		{name: "empty", path: "empty", off: 0, n: 100, expected: []byte{}, err: io.EOF},
+		{name: "nested", path: "sub/nested", off: 0, n: nestedSize, expected: pattern(nestedSize, 4), reads: 1},
+	} {
+		tc := tc
+
+		t.Run(tc.name, func(t *testing.T) {
+			f, err := fs.Open(tc.path)
+			require.NoError(t, err)
+
+			r.reads = 0
+
+			buf := make([]byte, tc.n)
+
+			n, err := f.ReadAt(buf, tc.off)
+			assert.Equal(t, tc.err, err)
+			assert.Equal(t, tc.expected, buf[:n])
+			assert.Equal(t, tc.reads, r.reads)
+		})
+	}
+
+	f, err := fs.Open("contiguous")
+	require.NoError(t, err)
+
+	_, err = f.ReadAt(make([]byte, 1), -1)
+	assert.Error(t, err)
+
+	// the FAT chain is shorter than the file size
+	f, err = fs.Open("short")
+	require.NoError(t, err)
+
+	n, err := f.ReadAt(make([]byte, shortSize), 0)
+	assert.Error(t, err)
+	assert.NotEqual(t, io.EOF, err)
+	assert.Equal(t, 2*imageClusterSize, n)
+}
+
+func TestFileRead(t *testing.T) {
+	fs, _ := newTestImage().open(t)
+
+	for _, bufSize := range []int{1, 100, imageClusterSize, 3 * imageClusterSize, 10 * imageClusterSize} {
+		f, err := fs.Open("fragmented")
+		require.NoError(t, err)
+
+		buf := make([]byte, bufSize)
+
+		var data []byte
+
+		for {
+			n, err := f.Read(buf)
+			data = append(data, buf[:n]...)
+
+			if err == io.EOF {
+				// EOF is reported once all the data is read, and never together with data
+				assert.Zero(t, n)
+
+				break
+			}
+
+			require.NoError(t, err)
+		}
+
+		assert.Equal(t, pattern(fragmentedSize, 2), data, bufSize)
+
+		// reads past the end keep returning EOF
+		n, err := f.Read(buf)
+		assert.Zero(t, n)
+		assert.Equal(t, io.EOF, err)
+	}
+
+	f, err := fs.Open("short")
+	require.NoError(t, err)
+
+	_, err = io.ReadAll(f)
+	assert.Error(t, err)
+}
+
+func TestFileWriteTo(t *testing.T) {
+	fs, _ := newTestImage().open(t)
+
+	for _, tc := range []struct {
+		path string
+		seek int64
+	}{
+		{"contiguous", 0},
+		{"fragmented", 0},
+		{"fragmented", 700},
+		{"fragmented", fragmentedSize},
+		{"empty", 0},
+		{"sub/nested", 3},
+	} {
+		// reference is read with io.Copy hiding the io.WriterTo implementation
+		f, err := fs.Open(tc.path)
+		require.NoError(t, err)
+
+		_, err = f.Seek(tc.seek, io.SeekStart)
+		require.NoError(t, err)
+
+		var expected bytes.Buffer
+
+		_, err = io.Copy(&expected, struct{ io.Reader }{f})
+		require.NoError(t, err)
+
+		f, err = fs.Open(tc.path)
+		require.NoError(t, err)
+
+		_, err = f.Seek(tc.seek, io.SeekStart)
+		require.NoError(t, err)
+
+		var actual bytes.Buffer
+
+		n, err := f.WriteTo(&actual)
+		require.NoError(t, err)
+		assert.EqualValues(t, expected.Len(), n)
+		assert.Equal(t, expected.String(), actual.String(), tc.path)
+
+		// everything is consumed
+		n, err = f.WriteTo(&actual)
+		require.NoError(t, err)
+		assert.Zero(t, n)
+	}
+
+	f, err := fs.Open("short")
+	require.NoError(t, err)
+
+	_, err = f.WriteTo(io.Discard)
+	assert.Error(t, err)
+}
+
+func TestOpen(t *testing.T) {
+	fs, _ := newTestImage().open(t)
+
+	_, err := fs.Open("missing")
+	assert.ErrorIs(t, err, os.ErrNotExist)
+
+	_, err = fs.Open("sub/missing")
+	assert.ErrorIs(t, err, os.ErrNotExist)
+
+	_, err = fs.Open("sub")
+	assert.Error(t, err)
+
+	_, err = fs.Open("contiguous/nested")
+	assert.Error(t, err)
+}
+
+func BenchmarkFileRead(b *testing.B) {
+	const size = 64 * 1024 * 1024
+
+	d := test.CreateBenchmarkBlockDevice(b, 256*1024*1024)
+
+	if _, err := exec.LookPath("mkfs.vfat"); err != nil {
+		b.Skip("mkfs.vfat is not available")
+	}
+
+	if err := exec.Command("mkfs.vfat", "-F", "32", d.LoopbackDevice.Name()).Run(); err != nil {
+		b.Fatal(err)
+	}
+
+	mountpoint := b.TempDir()
+
+	if err := unix.Mount(d.LoopbackDevice.Name(), mountpoint, "vfat", 0, ""); err != nil {
+		b.Skipf("failed to mount vfat: %s", err)
+	}
+
+	err := os.WriteFile(filepath.Join(mountpoint, "data"), bytes.Repeat([]byte{0xa5}, size), 0o644)
+
+	if unmountErr := unix.Unmount(mountpoint, 0); unmountErr != nil {
+		b.Fatal(unmountErr)
+	}
+
+	if err != nil {
+		b.Fatal(err)
+	}
+
+	sb := &vfat.SuperBlock{}
+
+	if err = binary.Read(io.NewSectionReader(d.Dev, 0, 512), binary.BigEndian, sb); err != nil {
+		b.Fatal(err)
+	}
+
+	fs, err := vfat.NewFileSystem(d.Dev, sb)
+	if err != nil {
+		b.Fatal(err)
+	}
+
+	b.Run("Read", func(b *testing.B) {
+		buf := make([]byte, 128*1024)
+
+		b.SetBytes(size)
+		b.ReportAllocs()
+
+		for i := 0; i < b.N; i++ {
+			f, err := fs.Open("data")
+			if err != nil {
+				b.Fatal(err)
+			}
+
+			var n int64
+
+			for {
+				m, err := f.Read(buf)
+				n += int64(m)
+
+				if err == io.EOF {
+					break
+				}
+
+				if err != nil {
+					b.Fatal(err)
+				}
+			}
+
+			if n != size {
+				b.Fatalf("unexpected size %d", n)
+			}
+		}
+	})
+
+	b.Run("WriteTo", func(b *testing.B) {
+		b.SetBytes(size)
+		b.ReportAllocs()
+
+		for i := 0; i < b.N; i++ {
+			f, err := fs.Open("data")
+			if err != nil {
+				b.Fatal(err)
+			}
+
+			if _, err = io.Copy(io.Discard, f); err != nil {
+				b.Fatal(err)
+			}
+		}
+	})
+}
@@ -0,0 +1,193 @@
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+package vfat_test
+
+import (
+	"bytes"
+	"encoding/binary"
+	"testing"
+	"unicode/utf16"
+
+	"github.com/stretchr/testify/require"
+
+	"github.com/siderolabs/go-blockdevice/blockdevice/filesystem/vfat"
+)
+
+const (
+	imageSectorSize      = 512
+	imageClusterSize     = imageSectorSize
+	imageReservedSectors = 4
+	imageRootCluster     = 2
+	fatEndOfChain        = 0x0FFFFFFF
+)
+
+// image is a synthetic in-memory FAT32 image with one sector per cluster.
+type image struct {
+	data       []byte
+	fat        []uint32
+	fatSectors int
+	dataStart  int
+}
+
+// newImage creates the image with the FAT of the given size, the data area
+// has room for the first dataClusters clusters.
+func newImage(fatSectors, dataClusters int) *image {
+	img := &image{
+		fat:        make([]uint32, fatSectors*imageSectorSize/4),
+		fatSectors: fatSectors,
+		dataStart:  (imageReservedSectors + 2*fatSectors) * imageSectorSize,
+	}
+
+	img.data = make([]byte, img.dataStart+dataClusters*imageClusterSize)
+
+	sb := img.data[:imageSectorSize]
+
+	binary.LittleEndian.PutUint16(sb[11:], imageSectorSize)
+	sb[13] = imageClusterSize / imageSectorSize
+	binary.LittleEndian.PutUint16(sb[14:], imageReservedSectors)
+	sb[16] = 2
+	binary.LittleEndian.PutUint32(sb[36:], uint32(fatSectors))
+	binary.LittleEndian.PutUint32(sb[44:], imageRootCluster)
+	copy(sb[82:], "FAT32   ")
+
+	img.fat[0], img.fat[1] = 0x0FFFFFF8, fatEndOfChain
+
+	return img
+}
+
+// chain links the clusters in the FAT, the last one is the end of the chain.
+func (img *image) chain(clusters ...uint32) {
+	for i, cluster := range clusters {
+		if i == len(clusters)-1 {
+			img.fat[cluster] = fatEndOfChain
+		} else {
+			img.fat[cluster] = clusters[i+1]
+		}
+	}
+}
+
+// write links the clusters and writes the data to them.
+func (img *image) write(data []byte, clusters ...uint32) {
+	img.chain(clusters...)
+
+	for _, cluster := range clusters {
+		if len(data) == 0 {
+			break
+		}
+
+		n := copy(img.data[img.dataStart+int(cluster-2)*imageClusterSize:][:imageClusterSize], data)
+		data = data[n:]
+	}
+}
+
+type imageEntry struct {
+	name         string
+	isDirectory  bool
+	size         uint32
+	firstCluster uint32
+}
+
+// dir builds the directory contents with a LFN entry per file.
+func dir(entries ...imageEntry) []byte {
+	var raw []byte
+
+	for _, entry := range entries {
+		name := utf16.Encode([]rune(entry.name))
+		if len(name) > 13 {
+			panic("name is too long")
+		}
+
+		name = append(name, 0)
+
+		for len(name) < 13 {
+			name = append(name, 0xffff)
+		}
+
+		lfn := make([]byte, 32)
+		lfn[0] = 0x41
+		lfn[11] = 0x0f
+
+		for i, c := range name {
+			var off int
+
+			switch {
+			case i < 5:
+				off = 1 + i*2
+			case i < 11:
+				off = 14 + (i-5)*2
+			default:
+				off = 28 + (i-11)*2
+			}
+
+			binary.LittleEndian.PutUint16(lfn[off:], c)
+		}
+
+		short := make([]byte, 32)
+		copy(short, "SHORT   BIN")
+
+		if entry.isDirectory {
+			short[11] = 0x10
+		} else {
+			short[11] = 0x20
+		}
+
+		binary.LittleEndian.PutUint16(short[20:], uint16(entry.firstCluster>>16))
+		binary.LittleEndian.PutUint16(short[26:], uint16(entry.firstCluster))
+		binary.LittleEndian.PutUint32(short[28:], entry.size)
+
+		raw = append(raw, lfn...)
+		raw = append(raw, short...)
+	}
+
+	return raw
+}
+
+// countingReader counts the reads of the image.
+type countingReader struct {
+	*bytes.Reader
+
+	reads int
+}
+
+func (r *countingReader) ReadAt(p []byte, off int64) (int, error) {
+	r.reads++
+
+	return r.Reader.ReadAt(p, off)
+}
+
+// open serializes the FAT and opens the filesystem.
+func (img *image) open(t *testing.T) (*vfat.FileSystem, *countingReader) {
+	t.Helper()
+
+	for i, next := range img.fat {
+		for copyIdx := 0; copyIdx < 2; copyIdx++ {
+			binary.LittleEndian.PutUint32(img.data[(imageReservedSectors+copyIdx*img.fatSectors)*imageSectorSize+i*4:], next)
+		}
+	}
+
+	sb := &vfat.SuperBlock{}
+	require.NoError(t, sb.Decode(img.data))
+	require.True(t, sb.Is())
+
+	r := &countingReader{Reader: bytes.NewReader(img.data)}
+
+	fs, err := vfat.NewFileSystem(r, sb)
+	require.NoError(t, err)
+
+	r.reads = 0
+
+	return fs, r
+}
+
+// pattern returns distinct contents for the test files.
+func pattern(size int, seed byte) []byte {
+	data := make([]byte, size)
+
+	for i := range data {
+		data[i] = byte(i*7) + seed
+	}
+
+	return data
+}
@@ -13,6 +13,8 @@ const (
 	Magic = "FAT32"
 )
 
+//go:generate go run ../internal/sbgen -type SuperBlock -endian little
+
 // SuperBlock represents the vfat super block.
 type SuperBlock struct {
 	Ignored      [3]uint8
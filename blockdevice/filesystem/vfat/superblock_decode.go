@@ -0,0 +1,54 @@
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+// Code generated by sbgen from superblock.go. DO NOT EDIT.
+
+package vfat
+
+import (
+	"encoding/binary"
+	"io"
+)
+
+// SuperBlockSize is the size of the on-disk SuperBlock.
+const SuperBlockSize = 0x200
+
+// Decode decodes the SuperBlock from the first SuperBlockSize bytes of b.
+func (sb *SuperBlock) Decode(b []byte) error {
+	if len(b) < SuperBlockSize {
+		return io.ErrUnexpectedEOF
+	}
+
+	copy(sb.Ignored[:], b[0x0:0x3])
+	copy(sb.Sysid[:], b[0x3:0xb])
+	copy(sb.SectorSize[:], b[0xb:0xd])
+	sb.ClusterSize = b[0xd]
+	copy(sb.Reserved[:], b[0xe:0x10])
+	sb.Fats = b[0x10]
+	copy(sb.DirEntries[:], b[0x11:0x13])
+	copy(sb.Sectors[:], b[0x13:0x15])
+	sb.Media = b[0x15]
+	sb.FatLength = binary.LittleEndian.Uint16(b[0x16:0x18])
+	sb.SecsTrack = binary.LittleEndian.Uint16(b[0x18:0x1a])
+	sb.Heads = binary.LittleEndian.Uint16(b[0x1a:0x1c])
+	sb.Hidden = binary.LittleEndian.Uint32(b[0x1c:0x20])
+	sb.TotalSect = binary.LittleEndian.Uint32(b[0x20:0x24])
+	copy(sb.Fat32Length[:], b[0x24:0x28])
+	sb.Flags = binary.LittleEndian.Uint16(b[0x28:0x2a])
+	copy(sb.Version[:], b[0x2a:0x2c])
+	copy(sb.RootCluster[:], b[0x2c:0x30])
+	sb.FsinfoSector = binary.LittleEndian.Uint16(b[0x30:0x32])
+	sb.BackupBoot = binary.LittleEndian.Uint16(b[0x32:0x34])
+	for i := range sb.Reserved2 {
+		sb.Reserved2[i] = binary.LittleEndian.Uint16(b[0x34+i*2:])
+	}
+	copy(sb.Unknown[:], b[0x40:0x43])
+	copy(sb.Serno[:], b[0x43:0x47])
+	copy(sb.Label[:], b[0x47:0x52])
+	copy(sb.Magic[:], b[0x52:0x5a])
+	copy(sb.Dummy2[:], b[0x5a:0x1fe])
+	copy(sb.Pmagic[:], b[0x1fe:0x200])
+
+	return nil
+}
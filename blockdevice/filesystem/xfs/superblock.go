@@ -9,6 +9,8 @@ const (
 	Magic = 0x58465342
 )
 
+//go:generate go run ../internal/sbgen -type SuperBlock -endian big
+
 // SuperBlock represents the xfs super block.
 type SuperBlock struct {
 	Magic      uint32
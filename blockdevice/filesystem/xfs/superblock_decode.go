@@ -0,0 +1,57 @@
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+// Code generated by sbgen from superblock.go. DO NOT EDIT.
+
+package xfs
+
+import (
+	"encoding/binary"
+	"io"
+)
+
+// SuperBlockSize is the size of the on-disk SuperBlock.
+const SuperBlockSize = 0xa0
+
+// Decode decodes the SuperBlock from the first SuperBlockSize bytes of b.
+func (sb *SuperBlock) Decode(b []byte) error {
+	if len(b) < SuperBlockSize {
+		return io.ErrUnexpectedEOF
+	}
+
+	sb.Magic = binary.BigEndian.Uint32(b[0x0:0x4])
+	sb.Blocksize = binary.BigEndian.Uint32(b[0x4:0x8])
+	sb.Dblocks = binary.BigEndian.Uint64(b[0x8:0x10])
+	sb.Rblocks = binary.BigEndian.Uint64(b[0x10:0x18])
+	sb.Rextents = binary.BigEndian.Uint64(b[0x18:0x20])
+	copy(sb.UUID[:], b[0x20:0x30])
+	sb.Logstart = binary.BigEndian.Uint64(b[0x30:0x38])
+	sb.Rootino = binary.BigEndian.Uint64(b[0x38:0x40])
+	sb.Rbmino = binary.BigEndian.Uint64(b[0x40:0x48])
+	sb.Rsumino = binary.BigEndian.Uint64(b[0x48:0x50])
+	sb.Rextsize = binary.BigEndian.Uint32(b[0x50:0x54])
+	sb.Agblocks = binary.BigEndian.Uint32(b[0x54:0x58])
+	sb.Agcount = binary.BigEndian.Uint32(b[0x58:0x5c])
+	sb.Rbmblocks = binary.BigEndian.Uint32(b[0x5c:0x60])
+	sb.Logblocks = binary.BigEndian.Uint32(b[0x60:0x64])
+	sb.Versionnum = binary.BigEndian.Uint16(b[0x64:0x66])
+	sb.Sectsize = binary.BigEndian.Uint16(b[0x66:0x68])
+	sb.Inodesize = binary.BigEndian.Uint16(b[0x68:0x6a])
+	sb.Inopblock = binary.BigEndian.Uint16(b[0x6a:0x6c])
+	copy(sb.Fname[:], b[0x6c:0x78])
+	sb.Blocklog = b[0x78]
+	sb.Sectlog = b[0x79]
+	sb.Inodelog = b[0x7a]
+	sb.Inopblog = b[0x7b]
+	sb.Agblklog = b[0x7c]
+	sb.Rextslog = b[0x7d]
+	sb.Inprogress = b[0x7e]
+	sb.ImaxPct = b[0x7f]
+	sb.Icount = binary.BigEndian.Uint64(b[0x80:0x88])
+	sb.Ifree = binary.BigEndian.Uint64(b[0x88:0x90])
+	sb.Fdblocks = binary.BigEndian.Uint64(b[0x90:0x98])
+	sb.Frextents = binary.BigEndian.Uint64(b[0x98:0xa0])
+
+	return nil
+}
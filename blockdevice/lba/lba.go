@@ -6,6 +6,10 @@ package lba
 
 import (
 	"os"
+	"sync"
+	"unsafe"
+
+	"github.com/siderolabs/go-blockdevice/blockdevice/observe"
 )
 
 // RecommendedAlignment is recommended alignment for LBA.
@@ -23,6 +27,12 @@ type LBA struct {
 	TotalSectors int64
 
 	f *os.File
+
+	// direct is f opened with O_DIRECT, if direct I/O is enabled
+	direct    *os.File
+	alignment int
+
+	observer observe.Observer
 }
 
 // AlignToPhysicalBlockSize aligns LBA value in LogicalBlockSize multiples to be aligned to PhysicalBlockSize.
@@ -51,3 +61,61 @@ func (l *LBA) AlignToPhysicalBlockSize(lba uint64, roundUp bool) uint64 {
 
 	return lba / ratio * ratio
 }
+
+// bufferPools keeps the I/O buffers by size and alignment, shared by all LBAs.
+var bufferPools sync.Map
+
+type bufferKey struct {
+	size      int
+	alignment int
+}
+
+// GetBuffer returns a buffer of size bytes from the pool.
+//
+// The buffer is aligned for I/O with the LBA (including O_DIRECT), and its contents are undefined.
+// The buffer should be returned with PutBuffer once it is no longer used.
+func (l *LBA) GetBuffer(size int) *[]byte {
+	key := bufferKey{size: size, alignment: l.bufferAlignment()}
+
+	if pool, ok := bufferPools.Load(key); ok {
+		if p, ok := pool.(*sync.Pool).Get().(*[]byte); ok {
+			return p
+		}
+	}
+
+	b := make([]byte, size+key.alignment)
+	shift := 0
+
+	if rem := int(uintptr(unsafe.Pointer(&b[0])) % uintptr(key.alignment)); rem != 0 {
+		shift = key.alignment - rem
+	}
+
+	b = b[shift : shift+size : shift+size]
+
+	return &b
+}
+
+// PutBuffer returns the buffer obtained with GetBuffer to the pool.
+func (l *LBA) PutBuffer(p *[]byte) {
+	*p = (*p)[:cap(*p)]
+
+	key := bufferKey{size: len(*p), alignment: l.bufferAlignment()}
+
+	pool, ok := bufferPools.Load(key)
+	if !ok {
+		pool, _ = bufferPools.LoadOrStore(key, &sync.Pool{})
+	}
+
+	pool.(*sync.Pool).Put(p)
+}
+
+func (l *LBA) bufferAlignment() int {
+	switch {
+	case l.alignment > 0:
+		return l.alignment
+	case l.LogicalBlockSize > 0:
+		return int(l.LogicalBlockSize)
+	default:
+		return 1
+	}
+}
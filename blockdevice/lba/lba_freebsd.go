@@ -10,7 +10,7 @@ import (
 )
 
 // NewLBA initializes and returns an `LBA`.
-func NewLBA(f *os.File) (lba *LBA, err error) {
+func NewLBA(f *os.File, setters ...Option) (lba *LBA, err error) {
 	return nil, fmt.Errorf("not implemented")
 }
 
@@ -19,7 +19,22 @@ func (l *LBA) ReadAt(lba, off, length int64) (b []byte, err error) {
 	return nil, fmt.Errorf("not implemented")
 }
 
+// ReadInto reads len(b) bytes into b in units of LBA.
+func (l *LBA) ReadInto(lba, off int64, b []byte) (err error) {
+	return fmt.Errorf("not implemented")
+}
+
 // WriteAt writes to a file in units of LBA.
 func (l *LBA) WriteAt(lba, off int64, b []byte) (err error) {
 	return fmt.Errorf("not implemented")
 }
+
+// WriteVectorAt writes the buffers to consecutive locations starting at LBA.
+func (l *LBA) WriteVectorAt(lba int64, bufs [][]byte) (err error) {
+	return fmt.Errorf("not implemented")
+}
+
+// Close releases the resources held by LBA.
+func (l *LBA) Close() (err error) {
+	return fmt.Errorf("not implemented")
+}
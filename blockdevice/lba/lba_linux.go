@@ -11,6 +11,8 @@ import (
 	"unsafe"
 
 	"golang.org/x/sys/unix"
+
+	"github.com/siderolabs/go-blockdevice/blockdevice/observe"
 )
 
 // These newer ioctl magic values are not available from unix yet.
@@ -20,7 +22,9 @@ const (
 )
 
 // NewLBA initializes and returns an `LBA`.
-func NewLBA(f *os.File) (*LBA, error) {
+func NewLBA(f *os.File, setters ...Option) (*LBA, error) {
+	opts := NewDefaultOptions(setters...)
+
 	st, err := f.Stat()
 	if err != nil {
 		return nil, fmt.Errorf("stat disk error: %w", err)
@@ -95,35 +99,119 @@ func NewLBA(f *os.File) (*LBA, error) {
 		OptimalIOSize:     optio,
 		TotalSectors:      tsize,
 		f:                 f,
+		alignment:         int(lsize),
+		observer:          opts.Observer,
+	}
+
+	if opts.DirectIO {
+		if err = lba.openDirect(); err != nil {
+			return nil, err
+		}
 	}
 
 	return lba, nil
 }
 
+func (l *LBA) openDirect() error {
+	flags, err := unix.FcntlInt(l.f.Fd(), unix.F_GETFL, 0)
+	if err != nil {
+		return fmt.Errorf("failed to get file flags: %w", err)
+	}
+
+	l.direct, err = os.OpenFile(l.f.Name(), flags&unix.O_ACCMODE|unix.O_DIRECT, 0)
+	if err != nil {
+		return fmt.Errorf("failed to open with O_DIRECT: %w", err)
+	}
+
+	// buffers are aligned to the largest of the block sizes, but not beyond the page size
+	l.alignment = int(l.LogicalBlockSize)
+
+	for _, size := range []int64{l.PhysicalBlockSize, l.MinimalIOSize} {
+		if size > int64(l.alignment) && size <= int64(os.Getpagesize()) {
+			l.alignment = int(size)
+		}
+	}
+
+	return nil
+}
+
+// Close releases the resources held by LBA.
+//
+// The file LBA was created with is not closed.
+func (l *LBA) Close() error {
+	if l.direct == nil {
+		return nil
+	}
+
+	err := l.direct.Close()
+	l.direct = nil
+
+	return err
+}
+
 // ReadAt reads from a file in units of LBA.
 func (l *LBA) ReadAt(lba, off, length int64) ([]byte, error) {
 	b := make([]byte, length)
 
+	if err := l.ReadInto(lba, off, b); err != nil {
+		return nil, err
+	}
+
+	return b, nil
+}
+
+// ReadInto reads len(b) bytes into b in units of LBA.
+//
+// Unlike ReadAt, ReadInto doesn't allocate.
+func (l *LBA) ReadInto(lba, off int64, b []byte) error {
+	s := observe.Start(l.observer, observe.KindIO, l.f.Name(), "read")
+
+	err := l.readInto(lba, off, b)
+
+	s.End(err)
+
+	return err
+}
+
+func (l *LBA) readInto(lba, off int64, b []byte) error {
 	off = lba*l.LogicalBlockSize + off
 
+	if l.direct != nil {
+		return l.readDirect(off, b)
+	}
+
 	// TODO: this should either use a loop or ReadFull, as Read() is not guaranteed
 	// to read full buffer
 	n, err := l.f.ReadAt(b, off)
 	if err != nil {
-		return nil, err
+		return err
 	}
 
 	if n != len(b) {
-		return nil, fmt.Errorf("expected to read %d bytes, read %d", len(b), n)
+		return fmt.Errorf("expected to read %d bytes, read %d", len(b), n)
 	}
 
-	return b, nil
+	return nil
 }
 
 // WriteAt writes to a file in units of LBA.
 func (l *LBA) WriteAt(lba, off int64, b []byte) error {
+	s := observe.Start(l.observer, observe.KindIO, l.f.Name(), "write")
+
+	err := l.writeAt(lba, off, b)
+
+	s.End(err)
+
+	return err
+}
+
+func (l *LBA) writeAt(lba, off int64, b []byte) error {
 	off = lba*l.LogicalBlockSize + off
 
+	if l.direct != nil {
+		return l.writeDirect(off, b)
+	}
+
 	n, err := l.f.WriteAt(b, off)
 	if err != nil {
 		return err
@@ -135,3 +223,177 @@ func (l *LBA) WriteAt(lba, off int64, b []byte) error {
 
 	return nil
 }
+
+// WriteVectorAt writes the buffers to consecutive locations starting at LBA with a single pwritev system call.
+func (l *LBA) WriteVectorAt(lba int64, bufs [][]byte) error {
+	s := observe.Start(l.observer, observe.KindIO, l.f.Name(), "writev")
+
+	err := l.writeVectorAt(lba, bufs)
+
+	s.End(err)
+
+	return err
+}
+
+func (l *LBA) writeVectorAt(lba int64, bufs [][]byte) error {
+	off := lba * l.LogicalBlockSize
+
+	if l.direct != nil {
+		// the buffers are gathered to satisfy O_DIRECT alignment
+		return l.writeVectorDirect(off, bufs)
+	}
+
+	var total int
+
+	for _, b := range bufs {
+		total += len(b)
+	}
+
+	written := 0
+
+	for written < total {
+		n, err := unix.Pwritev(int(l.f.Fd()), bufs, off)
+		if err != nil {
+			if errors.Is(err, unix.EINTR) {
+				continue
+			}
+
+			return err
+		}
+
+		if n == 0 {
+			return fmt.Errorf("expected to write %d bytes, wrote %d", total, written)
+		}
+
+		written += n
+		off += int64(n)
+
+		if written == total {
+			break
+		}
+
+		// skip the buffers which were written, keeping the caller's slice intact
+		bufs = append([][]byte(nil), bufs...)
+
+		for n > 0 {
+			if n < len(bufs[0]) {
+				bufs[0] = bufs[0][n:]
+
+				break
+			}
+
+			n -= len(bufs[0])
+			bufs = bufs[1:]
+		}
+	}
+
+	return nil
+}
+
+// blockRange returns the range of whole logical blocks covering length bytes at off.
+func (l *LBA) blockRange(off int64, length int) (start, end int64) {
+	start = off / l.LogicalBlockSize * l.LogicalBlockSize
+	end = (off + int64(length) + l.LogicalBlockSize - 1) / l.LogicalBlockSize * l.LogicalBlockSize
+
+	return start, end
+}
+
+func (l *LBA) aligned(off int64, b []byte) bool {
+	return off%l.LogicalBlockSize == 0 &&
+		int64(len(b))%l.LogicalBlockSize == 0 &&
+		(len(b) == 0 || uintptr(unsafe.Pointer(&b[0]))%uintptr(l.alignment) == 0)
+}
+
+func (l *LBA) preadFull(b []byte, off int64) error {
+	n, err := l.direct.ReadAt(b, off)
+	if err != nil {
+		return err
+	}
+
+	if n != len(b) {
+		return fmt.Errorf("expected to read %d bytes, read %d", len(b), n)
+	}
+
+	return nil
+}
+
+func (l *LBA) pwriteFull(b []byte, off int64) error {
+	n, err := l.direct.WriteAt(b, off)
+	if err != nil {
+		return err
+	}
+
+	if n != len(b) {
+		return fmt.Errorf("expected to write %d bytes, wrote %d", len(b), n)
+	}
+
+	return nil
+}
+
+func (l *LBA) readDirect(off int64, b []byte) error {
+	if l.aligned(off, b) {
+		return l.preadFull(b, off)
+	}
+
+	start, end := l.blockRange(off, len(b))
+
+	p := l.GetBuffer(int(end - start))
+	defer l.PutBuffer(p)
+
+	if err := l.preadFull(*p, start); err != nil {
+		return err
+	}
+
+	copy(b, (*p)[off-start:])
+
+	return nil
+}
+
+func (l *LBA) writeDirect(off int64, b []byte) error {
+	if l.aligned(off, b) {
+		return l.pwriteFull(b, off)
+	}
+
+	start, end := l.blockRange(off, len(b))
+
+	p := l.GetBuffer(int(end - start))
+	defer l.PutBuffer(p)
+
+	// partial blocks are read back first
+	if start != off || end != off+int64(len(b)) {
+		if err := l.preadFull(*p, start); err != nil {
+			return err
+		}
+	}
+
+	copy((*p)[off-start:], b)
+
+	return l.pwriteFull(*p, start)
+}
+
+func (l *LBA) writeVectorDirect(off int64, bufs [][]byte) error {
+	var total int
+
+	for _, b := range bufs {
+		total += len(b)
+	}
+
+	start, end := l.blockRange(off, total)
+
+	p := l.GetBuffer(int(end - start))
+	defer l.PutBuffer(p)
+
+	if start != off || end != off+int64(total) {
+		if err := l.preadFull(*p, start); err != nil {
+			return err
+		}
+	}
+
+	pos := int(off - start)
+
+	for _, b := range bufs {
+		pos += copy((*p)[pos:], b)
+	}
+
+	return l.pwriteFull(*p, start)
+}
@@ -5,9 +5,16 @@
 package lba_test
 
 import (
+	"bytes"
+	"errors"
+	"os"
+	"path/filepath"
 	"testing"
+	"unsafe"
 
 	"github.com/stretchr/testify/assert"
+	"github.com/stretchr/testify/require"
+	"golang.org/x/sys/unix"
 
 	"github.com/siderolabs/go-blockdevice/blockdevice/lba"
 )
@@ -61,3 +68,96 @@ func TestAlignToMinIOkSize(t *testing.T) {
 	assert.EqualValues(t, 16384, l.AlignToPhysicalBlockSize(8193, true))
 	assert.EqualValues(t, 8192, l.AlignToPhysicalBlockSize(8193, false))
 }
+
+func TestWriteVectorAt(t *testing.T) {
+	f, err := os.Create(filepath.Join(t.TempDir(), "disk"))
+	require.NoError(t, err)
+
+	t.Cleanup(func() { f.Close() }) //nolint:errcheck
+
+	require.NoError(t, f.Truncate(8*512))
+
+	l, err := lba.NewLBA(f)
+	require.NoError(t, err)
+
+	first := make([]byte, 512)
+	second := make([]byte, 1024)
+
+	for i := range first {
+		first[i] = 1
+	}
+
+	for i := range second {
+		second[i] = 2
+	}
+
+	bufs := [][]byte{first, second}
+
+	require.NoError(t, l.WriteVectorAt(2, bufs))
+	assert.Len(t, bufs[0], 512)
+
+	b, err := l.ReadAt(1, 0, 5*512)
+	require.NoError(t, err)
+
+	assert.Equal(t, make([]byte, 512), b[:512])
+	assert.Equal(t, first, b[512:1024])
+	assert.Equal(t, second, b[1024:2048])
+	assert.Equal(t, make([]byte, 512), b[2048:])
+}
+
+func TestDirectIO(t *testing.T) {
+	f, err := os.Create(filepath.Join(t.TempDir(), "disk"))
+	require.NoError(t, err)
+
+	t.Cleanup(func() { f.Close() }) //nolint:errcheck
+
+	require.NoError(t, f.Truncate(8*512))
+
+	l, err := lba.NewLBA(f, lba.WithDirectIO(true))
+	if errors.Is(err, unix.EINVAL) {
+		t.Skip("O_DIRECT is not supported by the filesystem")
+	}
+
+	require.NoError(t, err)
+
+	t.Cleanup(func() { assert.NoError(t, l.Close()) })
+
+	// unaligned write spanning two blocks
+	require.NoError(t, l.WriteAt(1, 500, []byte("direct")))
+
+	// whole blocks
+	require.NoError(t, l.WriteVectorAt(4, [][]byte{make([]byte, 256), bytes.Repeat([]byte{1}, 256)}))
+
+	b := make([]byte, 8)
+	require.NoError(t, l.ReadInto(1, 499, b))
+	assert.Equal(t, []byte("\x00direct\x00"), b)
+
+	b, err = l.ReadAt(4, 0, 512)
+	require.NoError(t, err)
+	assert.Equal(t, append(make([]byte, 256), bytes.Repeat([]byte{1}, 256)...), b)
+
+	// buffered reads see the same data
+	b = make([]byte, 6)
+	_, err = f.ReadAt(b, 512+500)
+	require.NoError(t, err)
+	assert.Equal(t, []byte("direct"), b)
+}
+
+func TestGetBuffer(t *testing.T) {
+	l := lba.LBA{ //nolint: exhaustivestruct
+		PhysicalBlockSize: 4096,
+		LogicalBlockSize:  4096,
+	}
+
+	p := l.GetBuffer(3 * 4096)
+	assert.Len(t, *p, 3*4096)
+	assert.EqualValues(t, 0, uintptr(unsafe.Pointer(&(*p)[0]))%4096)
+
+	*p = (*p)[:10]
+	l.PutBuffer(p)
+
+	p = l.GetBuffer(3 * 4096)
+	assert.Len(t, *p, 3*4096)
+
+	l.PutBuffer(p)
+}
@@ -0,0 +1,159 @@
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+package loopback
+
+import (
+	"errors"
+	"fmt"
+	"os"
+	"runtime"
+	"syscall"
+	"unsafe"
+
+	"golang.org/x/sys/unix"
+)
+
+// loopConfigure is LOOP_CONFIGURE ioctl (Linux 5.8+).
+const loopConfigure = 0x4C0A
+
+// loopConfig is struct loop_config.
+type loopConfig struct {
+	fd        uint32
+	blockSize uint32
+	info      unix.LoopInfo64
+	_         [8]uint64
+}
+
+// maxAttachAttempts limits the attempts to grab a free loop device raced by other allocators.
+const maxAttachAttempts = 16
+
+// Configure attaches the image to the loop device with a single LOOP_CONFIGURE ioctl.
+//
+// On kernels without LOOP_CONFIGURE, it falls back to LOOP_SET_FD followed by
+// LOOP_SET_STATUS64, LOOP_SET_BLOCK_SIZE and LOOP_SET_DIRECT_IO.
+// If the loop device is already bound, unix.EBUSY is returned.
+func Configure(loopbackDevice, image *os.File, setters ...Option) error {
+	opts := NewDefaultOptions(setters...)
+
+	blockSize := opts.BlockSize
+	if blockSize == 0 {
+		blockSize = imageBlockSize(image)
+	}
+
+	config := loopConfig{
+		fd:        uint32(image.Fd()),
+		blockSize: blockSize,
+	}
+
+	if opts.PartScan {
+		config.info.Flags |= unix.LO_FLAGS_PARTSCAN
+	}
+
+	if opts.ReadOnly {
+		config.info.Flags |= unix.LO_FLAGS_READ_ONLY
+	}
+
+	if opts.Autoclear {
+		config.info.Flags |= unix.LO_FLAGS_AUTOCLEAR
+	}
+
+	if opts.DirectIO {
+		config.info.Flags |= unix.LO_FLAGS_DIRECT_IO
+	}
+
+	_, _, err := syscall.Syscall(syscall.SYS_IOCTL, loopbackDevice.Fd(), loopConfigure, uintptr(unsafe.Pointer(&config)))
+	runtime.KeepAlive(image)
+
+	if e := errnoIsErr(err); !errors.Is(e, unix.ENOTTY) && !errors.Is(e, unix.EINVAL) {
+		return e
+	}
+
+	return configureLegacy(loopbackDevice, image, &config)
+}
+
+func configureLegacy(loopbackDevice, image *os.File, config *loopConfig) error {
+	_, _, err := syscall.Syscall(syscall.SYS_IOCTL, loopbackDevice.Fd(), unix.LOOP_SET_FD, image.Fd())
+	if e := errnoIsErr(err); e != nil {
+		return e
+	}
+
+	directIO := config.info.Flags&unix.LO_FLAGS_DIRECT_IO != 0
+	config.info.Flags &^= unix.LO_FLAGS_DIRECT_IO
+
+	_, _, err = syscall.Syscall(syscall.SYS_IOCTL, loopbackDevice.Fd(), unix.LOOP_SET_STATUS64, uintptr(unsafe.Pointer(&config.info)))
+	if e := errnoIsErr(err); e != nil {
+		Unloop(loopbackDevice) //nolint:errcheck
+
+		return e
+	}
+
+	if config.blockSize != 512 {
+		_, _, err = syscall.Syscall(syscall.SYS_IOCTL, loopbackDevice.Fd(), unix.LOOP_SET_BLOCK_SIZE, uintptr(config.blockSize))
+		if e := errnoIsErr(err); e != nil {
+			Unloop(loopbackDevice) //nolint:errcheck
+
+			return fmt.Errorf("failed to set loop block size: %w", e)
+		}
+	}
+
+	if directIO {
+		// direct I/O is an optimization, keep buffered I/O if it's not supported
+		syscall.Syscall(syscall.SYS_IOCTL, loopbackDevice.Fd(), unix.LOOP_SET_DIRECT_IO, 1) //nolint:errcheck
+	}
+
+	return nil
+}
+
+// imageBlockSize returns the logical block size for the image.
+func imageBlockSize(image *os.File) uint32 {
+	var size int32
+
+	if _, _, err := syscall.Syscall(syscall.SYS_IOCTL, image.Fd(), unix.BLKSSZGET, uintptr(unsafe.Pointer(&size))); err == 0 && size > 0 {
+		return uint32(size)
+	}
+
+	return 512
+}
+
+// Attach attaches the image to a free loop device and returns the opened loop device.
+//
+// If another allocator grabs the same loop device first, the next free one is tried.
+func Attach(image *os.File, setters ...Option) (*os.File, error) {
+	control, err := os.OpenFile("/dev/loop-control", os.O_RDONLY|unix.O_CLOEXEC, 0)
+	if err != nil {
+		return nil, err
+	}
+
+	defer control.Close() //nolint:errcheck
+
+	return attach(control, image, setters...)
+}
+
+func attach(control, image *os.File, setters ...Option) (*os.File, error) {
+	for attempt := 0; attempt < maxAttachAttempts; attempt++ {
+		index, _, errno := syscall.Syscall(syscall.SYS_IOCTL, control.Fd(), unix.LOOP_CTL_GET_FREE, 0)
+		if err := errnoIsErr(errno); err != nil {
+			return nil, err
+		}
+
+		dev, err := os.OpenFile(fmt.Sprintf("/dev/loop%d", index), os.O_RDWR|unix.O_CLOEXEC, 0)
+		if err != nil {
+			return nil, err
+		}
+
+		err = Configure(dev, image, setters...)
+		if err == nil {
+			return dev, nil
+		}
+
+		dev.Close() //nolint:errcheck
+
+		if !errors.Is(err, unix.EBUSY) {
+			return nil, err
+		}
+	}
+
+	return nil, fmt.Errorf("failed to find a free loop device after %d attempts", maxAttachAttempts)
+}
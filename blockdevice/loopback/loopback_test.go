@@ -0,0 +1,65 @@
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+package loopback_test
+
+import (
+	"os"
+	"path/filepath"
+	"strings"
+	"testing"
+
+	"github.com/stretchr/testify/assert"
+	"github.com/stretchr/testify/require"
+
+	"github.com/siderolabs/go-blockdevice/blockdevice/loopback"
+)
+
+func sysfsAttr(t *testing.T, dev *os.File, attr string) string {
+	t.Helper()
+
+	b, err := os.ReadFile(filepath.Join("/sys/block", filepath.Base(dev.Name()), attr))
+	require.NoError(t, err)
+
+	return strings.TrimSpace(string(b))
+}
+
+func TestPool(t *testing.T) {
+	if os.Getuid() != 0 {
+		t.Skip("can't run the test as non-root")
+	}
+
+	image, err := os.Create(filepath.Join(t.TempDir(), "image"))
+	require.NoError(t, err)
+
+	t.Cleanup(func() { image.Close() }) //nolint:errcheck
+
+	require.NoError(t, image.Truncate(64*1024*1024))
+
+	pool, err := loopback.NewPool(2)
+	require.NoError(t, err)
+
+	t.Cleanup(func() { assert.NoError(t, pool.Close()) })
+
+	dev, err := pool.Attach(image, loopback.WithBlockSize(4096), loopback.WithDirectIO(true))
+	require.NoError(t, err)
+
+	assert.Equal(t, "4096", sysfsAttr(t, dev, "queue/logical_block_size"))
+	assert.Equal(t, "131072", sysfsAttr(t, dev, "size"))
+	assert.Equal(t, "0", sysfsAttr(t, dev, "ro"))
+
+	name := dev.Name()
+
+	require.NoError(t, pool.Detach(dev))
+
+	// released device is reused
+	dev, err = pool.Attach(image, loopback.WithReadOnly(true))
+	require.NoError(t, err)
+
+	assert.Equal(t, name, dev.Name())
+	assert.Equal(t, "512", sysfsAttr(t, dev, "queue/logical_block_size"))
+	assert.Equal(t, "1", sysfsAttr(t, dev, "ro"))
+
+	require.NoError(t, pool.Detach(dev))
+}
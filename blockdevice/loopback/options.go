@@ -0,0 +1,70 @@
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+package loopback
+
+// Options is the functional options struct.
+type Options struct {
+	BlockSize uint32
+	DirectIO  bool
+	Autoclear bool
+	ReadOnly  bool
+	PartScan  bool
+}
+
+// Option is the functional option func.
+type Option func(*Options)
+
+// WithBlockSize sets the logical block size of the loop device.
+//
+// If not set, the block size is matched to the image: the logical block size
+// of a block device image, 512 bytes otherwise.
+func WithBlockSize(size uint32) Option {
+	return func(args *Options) {
+		args.BlockSize = size
+	}
+}
+
+// WithDirectIO enables direct I/O on the backing file, so that the data is not cached twice.
+//
+// The kernel falls back to buffered I/O if the block size is not aligned for direct I/O.
+func WithDirectIO(o bool) Option {
+	return func(args *Options) {
+		args.DirectIO = o
+	}
+}
+
+// WithAutoclear detaches the loop device once its last user closes it.
+func WithAutoclear(o bool) Option {
+	return func(args *Options) {
+		args.Autoclear = o
+	}
+}
+
+// WithReadOnly attaches the image read-only.
+func WithReadOnly(o bool) Option {
+	return func(args *Options) {
+		args.ReadOnly = o
+	}
+}
+
+// WithPartScan makes the kernel scan the partition table of the loop device.
+func WithPartScan(o bool) Option {
+	return func(args *Options) {
+		args.PartScan = o
+	}
+}
+
+// NewDefaultOptions initializes a Options struct with default values.
+func NewDefaultOptions(setters ...Option) *Options {
+	opts := &Options{
+		PartScan: true,
+	}
+
+	for _, setter := range setters {
+		setter(opts)
+	}
+
+	return opts
+}
@@ -0,0 +1,185 @@
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+package loopback
+
+import (
+	"errors"
+	"fmt"
+	"os"
+	"sync"
+	"syscall"
+	"unsafe"
+
+	"golang.org/x/sys/unix"
+)
+
+// Pool keeps a set of free loop devices for reuse.
+//
+// The pool holds /dev/loop-control open, pre-allocates the loop devices and
+// reuses the devices released back to it, so attaching an image costs an open
+// and a single LOOP_CONFIGURE ioctl in the common case.
+//
+// The devices are kept by index: the kernel defers the detach until the loop
+// device is closed, so released devices can't be kept open.
+type Pool struct {
+	control *os.File
+	idle    []int
+	size    int
+	mu      sync.Mutex
+}
+
+// NewPool creates a pool which keeps up to size idle loop devices, and pre-allocates them.
+func NewPool(size int) (*Pool, error) {
+	control, err := os.OpenFile("/dev/loop-control", os.O_RDONLY|unix.O_CLOEXEC, 0)
+	if err != nil {
+		return nil, err
+	}
+
+	p := &Pool{
+		control: control,
+		size:    size,
+	}
+
+	if err = p.preallocate(); err != nil {
+		p.Close() //nolint:errcheck
+
+		return nil, err
+	}
+
+	return p, nil
+}
+
+// preallocate finds free loop devices starting from the first free index, creating them as needed.
+func (p *Pool) preallocate() error {
+	first, _, errno := syscall.Syscall(syscall.SYS_IOCTL, p.control.Fd(), unix.LOOP_CTL_GET_FREE, 0)
+	if err := errnoIsErr(errno); err != nil {
+		return err
+	}
+
+	for index := int(first); len(p.idle) < p.size; index++ {
+		dev, err := openLoop(index)
+		if errors.Is(err, os.ErrNotExist) {
+			_, _, errno = syscall.Syscall(syscall.SYS_IOCTL, p.control.Fd(), unix.LOOP_CTL_ADD, uintptr(index))
+			if err = errnoIsErr(errno); err != nil && !errors.Is(err, unix.EEXIST) {
+				return fmt.Errorf("failed to add loop device %d: %w", index, err)
+			}
+
+			dev, err = openLoop(index)
+		}
+
+		if err != nil {
+			return err
+		}
+
+		if isFree(dev) {
+			p.idle = append(p.idle, index)
+		}
+
+		if err = dev.Close(); err != nil {
+			return err
+		}
+	}
+
+	return nil
+}
+
+func openLoop(index int) (*os.File, error) {
+	return os.OpenFile(fmt.Sprintf("/dev/loop%d", index), os.O_RDWR|unix.O_CLOEXEC, 0)
+}
+
+// isFree checks that the loop device is not bound to a file.
+func isFree(dev *os.File) bool {
+	var status unix.LoopInfo64
+
+	_, _, err := syscall.Syscall(syscall.SYS_IOCTL, dev.Fd(), unix.LOOP_GET_STATUS64, uintptr(unsafe.Pointer(&status)))
+
+	return errors.Is(err, unix.ENXIO)
+}
+
+// Attach attaches the image to a loop device from the pool.
+//
+// Idle devices grabbed meanwhile by other allocators are skipped. If the pool is
+// empty, a free loop device is allocated via loop-control.
+func (p *Pool) Attach(image *os.File, setters ...Option) (*os.File, error) {
+	for {
+		p.mu.Lock()
+
+		if p.control == nil {
+			p.mu.Unlock()
+
+			return nil, os.ErrClosed
+		}
+
+		if len(p.idle) == 0 {
+			p.mu.Unlock()
+
+			return attach(p.control, image, setters...)
+		}
+
+		index := p.idle[len(p.idle)-1]
+		p.idle = p.idle[:len(p.idle)-1]
+
+		p.mu.Unlock()
+
+		dev, err := openLoop(index)
+		if err != nil {
+			return nil, err
+		}
+
+		err = Configure(dev, image, setters...)
+		if err == nil {
+			return dev, nil
+		}
+
+		dev.Close() //nolint:errcheck
+
+		if !errors.Is(err, unix.EBUSY) {
+			return nil, err
+		}
+	}
+}
+
+// Detach detaches the image from the loop device, closes it and returns the device to the pool.
+func (p *Pool) Detach(dev *os.File) error {
+	var index int
+
+	_, scanErr := fmt.Sscanf(dev.Name(), "/dev/loop%d", &index)
+
+	if err := Unloop(dev); err != nil {
+		dev.Close() //nolint:errcheck
+
+		return err
+	}
+
+	if err := dev.Close(); err != nil {
+		return err
+	}
+
+	p.mu.Lock()
+	defer p.mu.Unlock()
+
+	if scanErr == nil && len(p.idle) < p.size && p.control != nil {
+		p.idle = append(p.idle, index)
+	}
+
+	return nil
+}
+
+// Close releases the pool.
+func (p *Pool) Close() error {
+	p.mu.Lock()
+	defer p.mu.Unlock()
+
+	p.idle = nil
+
+	if p.control == nil {
+		return nil
+	}
+
+	err := p.control.Close()
+	p.control = nil
+
+	return err
+}
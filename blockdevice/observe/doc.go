@@ -0,0 +1,11 @@
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+// Package observe provides optional instrumentation hooks for the I/O, ioctls,
+// retry loops and subprocesses run by the library.
+//
+// An Observer is either registered for the whole process with Register, or set
+// for a single block device with blockdevice.WithObserver. Without an observer
+// the hooks boil down to an atomic load.
+package observe
@@ -0,0 +1,177 @@
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+package observe
+
+import (
+	"sync/atomic"
+	"syscall"
+	"time"
+)
+
+// Kind is the kind of the observed operation.
+type Kind int
+
+const (
+	// KindIO is a read or write, including sysfs reads.
+	KindIO Kind = iota
+	// KindIoctl is an ioctl call.
+	KindIoctl
+	// KindRetry is a single iteration of a retry loop.
+	KindRetry
+	// KindExec is a subprocess run.
+	KindExec
+)
+
+func (k Kind) String() string {
+	switch k {
+	case KindIO:
+		return "io"
+	case KindIoctl:
+		return "ioctl"
+	case KindRetry:
+		return "retry"
+	case KindExec:
+		return "exec"
+	default:
+		return "unknown"
+	}
+}
+
+// Event describes a completed operation.
+//
+//nolint:govet
+type Event struct {
+	Kind Kind
+	// Device is the device (or sysfs device name) the operation was run against, if any.
+	Device string
+	// Op is the operation, e.g. the ioctl or the command name.
+	Op string
+	// Attempt is the iteration of the retry loop starting with 1, it's set only for KindRetry.
+	Attempt int
+
+	Start    time.Time
+	Duration time.Duration
+	Err      error
+}
+
+// Observer receives the events.
+//
+// Observe is called synchronously from the goroutine which ran the operation,
+// so it should be cheap, e.g. update a histogram or end a tracing span.
+type Observer interface {
+	Observe(ev Event)
+}
+
+// Func adapts a function to the Observer interface.
+type Func func(ev Event)
+
+// Observe implements Observer.
+func (f Func) Observe(ev Event) {
+	f(ev)
+}
+
+type registered struct {
+	o Observer
+}
+
+var global atomic.Pointer[registered]
+
+// Register sets the process-wide observer, nil removes it.
+func Register(o Observer) {
+	if o == nil {
+		global.Store(nil)
+
+		return
+	}
+
+	global.Store(&registered{o: o})
+}
+
+// Registered returns the process-wide observer, or nil.
+func Registered() Observer { //nolint:ireturn
+	if r := global.Load(); r != nil {
+		return r.o
+	}
+
+	return nil
+}
+
+// Span times a single operation.
+//
+// The zero value (returned when there is no observer) is a no-op.
+type Span struct {
+	o  Observer
+	ev Event
+}
+
+// Start starts timing the operation.
+//
+// The event is sent to o, or to the process-wide observer if o is nil.
+func Start(o Observer, kind Kind, device, op string) Span {
+	if o == nil {
+		if o = Registered(); o == nil {
+			return Span{}
+		}
+	}
+
+	return Span{
+		o: o,
+		ev: Event{
+			Kind:   kind,
+			Device: device,
+			Op:     op,
+			Start:  time.Now(),
+		},
+	}
+}
+
+// End finishes the operation and sends the event.
+func (s *Span) End(err error) {
+	if s.o == nil {
+		return
+	}
+
+	s.ev.Duration = time.Since(s.ev.Start)
+	s.ev.Err = err
+
+	s.o.Observe(s.ev)
+}
+
+// EndErrno finishes the operation with the errno returned by a raw system call, zero is a success.
+func (s *Span) EndErrno(errno syscall.Errno) {
+	if errno != 0 {
+		s.End(errno)
+
+		return
+	}
+
+	s.End(nil)
+}
+
+// Retry wraps the body of a retry loop, so that each iteration is observed with its attempt number.
+//
+// If there is no observer, f is returned as is.
+func Retry(o Observer, device, op string, f func() error) func() error {
+	if o == nil {
+		if o = Registered(); o == nil {
+			return f
+		}
+	}
+
+	attempt := 0
+
+	return func() error {
+		attempt++
+
+		s := Start(o, KindRetry, device, op)
+		s.ev.Attempt = attempt
+
+		err := f()
+
+		s.End(err)
+
+		return err
+	}
+}
@@ -0,0 +1,114 @@
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+package observe_test
+
+import (
+	"errors"
+	"syscall"
+	"testing"
+
+	"github.com/stretchr/testify/assert"
+	"github.com/stretchr/testify/require"
+
+	"github.com/siderolabs/go-blockdevice/blockdevice/observe"
+)
+
+func TestObserve(t *testing.T) {
+	var events []observe.Event
+
+	collect := observe.Func(func(ev observe.Event) {
+		events = append(events, ev)
+	})
+
+	// no observer
+	s := observe.Start(nil, observe.KindIoctl, "/dev/loop0", "BLKRRPART")
+	s.End(nil)
+
+	observe.Register(collect)
+	t.Cleanup(func() { observe.Register(nil) })
+
+	errBusy := errors.New("busy")
+
+	s = observe.Start(nil, observe.KindIoctl, "/dev/loop0", "BLKRRPART")
+	s.End(errBusy)
+
+	attempts := 0
+
+	f := observe.Retry(nil, "/dev/loop0", "reread", func() error {
+		attempts++
+
+		if attempts < 3 {
+			return errBusy
+		}
+
+		return nil
+	})
+
+	for f() != nil {
+	}
+
+	// explicit observer takes precedence
+	var explicit []observe.Event
+
+	s = observe.Start(observe.Func(func(ev observe.Event) { explicit = append(explicit, ev) }), observe.KindExec, "", "cryptsetup")
+	s.End(nil)
+
+	require.Len(t, events, 4)
+
+	assert.Equal(t, observe.KindIoctl, events[0].Kind)
+	assert.Equal(t, "/dev/loop0", events[0].Device)
+	assert.Equal(t, "BLKRRPART", events[0].Op)
+	assert.Equal(t, errBusy, events[0].Err)
+
+	for i, ev := range events[1:] {
+		assert.Equal(t, observe.KindRetry, ev.Kind)
+		assert.Equal(t, i+1, ev.Attempt)
+	}
+
+	assert.NoError(t, events[3].Err)
+
+	require.Len(t, explicit, 1)
+	assert.Equal(t, "exec", explicit[0].Kind.String())
+}
+
+func TestEndErrno(t *testing.T) {
+	var events []observe.Event
+
+	o := observe.Func(func(ev observe.Event) {
+		events = append(events, ev)
+	})
+
+	s := observe.Start(o, observe.KindIoctl, "/dev/loop0", "BLKRRPART")
+	s.EndErrno(0)
+
+	s = observe.Start(o, observe.KindIoctl, "/dev/loop0", "BLKRRPART")
+	s.EndErrno(syscall.EBUSY)
+
+	require.Len(t, events, 2)
+	assert.NoError(t, events[0].Err)
+	assert.ErrorIs(t, events[1].Err, syscall.EBUSY)
+}
+
+func TestObserveDisabled(t *testing.T) {
+	f := func() error { return nil }
+
+	allocs := testing.AllocsPerRun(100, func() {
+		s := observe.Start(nil, observe.KindIoctl, "/dev/loop0", "BLKRRPART")
+		s.End(nil)
+
+		observe.Retry(nil, "/dev/loop0", "reread", f)() //nolint:errcheck
+	})
+
+	assert.Zero(t, allocs)
+}
+
+func BenchmarkStartDisabled(b *testing.B) {
+	b.ReportAllocs()
+
+	for i := 0; i < b.N; i++ {
+		s := observe.Start(nil, observe.KindIoctl, "/dev/loop0", "BLKRRPART")
+		s.End(nil)
+	}
+}
@@ -4,11 +4,19 @@
 
 package blockdevice
 
+import (
+	"github.com/siderolabs/go-blockdevice/blockdevice/aio"
+	"github.com/siderolabs/go-blockdevice/blockdevice/observe"
+)
+
 // Options is the functional options struct.
 type Options struct {
-	CreateGPT     bool
-	ExclusiveLock bool
-	Mode          int
+	CreateGPT           bool
+	ExclusiveLock       bool
+	CachePartitionTable bool
+	DirectIO            bool
+	Mode                int
+	Observer            observe.Observer
 }
 
 // Option is the functional option func.
@@ -28,6 +36,22 @@ func WithExclusiveLock(o bool) Option {
 	}
 }
 
+// WithPartitionTableCache keeps the partition table in memory between PartitionTable calls.
+//
+// The partition table is re-read only if it was invalidated, or if the on-disk header has changed.
+func WithPartitionTableCache(o bool) Option {
+	return func(args *Options) {
+		args.CachePartitionTable = o
+	}
+}
+
+// WithDirectIO reads and writes the partition table with O_DIRECT, bypassing the page cache.
+func WithDirectIO(o bool) Option {
+	return func(args *Options) {
+		args.DirectIO = o
+	}
+}
+
 // WithMode opens blockdevice in a specific mode.
 func WithMode(value int) Option {
 	return func(args *Options) {
@@ -35,6 +59,15 @@ func WithMode(value int) Option {
 	}
 }
 
+// WithObserver sets the observer for the ioctls, writes and retries of the block device.
+//
+// If not set, the process-wide observer (see observe.Register) is used.
+func WithObserver(o observe.Observer) Option {
+	return func(args *Options) {
+		args.Observer = o
+	}
+}
+
 // NewDefaultOptions initializes a Options struct with default values.
 func NewDefaultOptions(setters ...Option) *Options {
 	opts := &Options{
@@ -48,3 +81,69 @@ func NewDefaultOptions(setters ...Option) *Options {
 
 	return opts
 }
+
+// DefaultWipeChunkSize is the default size of a chunk wiped with a single request.
+const DefaultWipeChunkSize = 64 * 1024 * 1024
+
+// WipeOptions is the functional options struct for WipeRangeContext.
+type WipeOptions struct {
+	Concurrency int
+	ChunkSize   uint64
+	Progress    func(done, total uint64)
+	Engine      aio.Engine
+}
+
+// WipeOption is the functional option func for WipeRangeContext.
+type WipeOption func(*WipeOptions)
+
+// WithWipeConcurrency sets the number of chunks wiped in parallel.
+func WithWipeConcurrency(value int) WipeOption {
+	return func(args *WipeOptions) {
+		args.Concurrency = value
+	}
+}
+
+// WithWipeChunkSize sets the size of a chunk wiped with a single request.
+//
+// The chunk size is rounded up to the optimal I/O size of the device.
+func WithWipeChunkSize(value uint64) WipeOption {
+	return func(args *WipeOptions) {
+		args.ChunkSize = value
+	}
+}
+
+// WithWipeProgress sets the callback invoked after each wiped chunk with the number of bytes wiped so far.
+//
+// Calls are serialized, but they might come from different goroutines.
+func WithWipeProgress(progress func(done, total uint64)) WipeOption {
+	return func(args *WipeOptions) {
+		args.Progress = progress
+	}
+}
+
+// WithWipeEngine sets the I/O engine used to write zeroes when the device doesn't support discard or zeroout.
+//
+// The writes for each chunk are submitted as a single batch. The engine is not closed by the wipe.
+func WithWipeEngine(e aio.Engine) WipeOption {
+	return func(args *WipeOptions) {
+		args.Engine = e
+	}
+}
+
+// NewDefaultWipeOptions initializes a WipeOptions struct with default values.
+func NewDefaultWipeOptions(setters ...WipeOption) *WipeOptions {
+	opts := &WipeOptions{
+		Concurrency: 1,
+		ChunkSize:   DefaultWipeChunkSize,
+	}
+
+	for _, setter := range setters {
+		setter(opts)
+	}
+
+	if opts.Concurrency < 1 {
+		opts.Concurrency = 1
+	}
+
+	return opts
+}
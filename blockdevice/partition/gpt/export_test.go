@@ -0,0 +1,15 @@
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+package gpt
+
+// SyncKernelPartitions exposes syncKernelPartitions to the benchmarks.
+func (g *GPT) SyncKernelPartitions() error {
+	return g.syncKernelPartitions()
+}
+
+// HasIndex reports whether the partition index is built.
+func (p *Partitions) HasIndex() bool {
+	return p.index != nil
+}
@@ -5,16 +5,19 @@
 package gpt
 
 import (
+	"bytes"
 	"encoding/binary"
 	"errors"
 	"fmt"
 	"math"
 	"os"
+	"sort"
 
 	"github.com/google/uuid"
 
 	"github.com/siderolabs/go-blockdevice/blockdevice/blkpg"
 	"github.com/siderolabs/go-blockdevice/blockdevice/lba"
+	"github.com/siderolabs/go-blockdevice/blockdevice/observe"
 )
 
 const (
@@ -46,48 +49,93 @@ type GPT struct {
 	h               *Header
 	e               *Partitions
 	markMBRBootable bool
+	observer        observe.Observer
+
+	written written
+}
+
+// written keeps the partition table blocks as last read from or written to disk,
+// so that Write only has to write the blocks which have changed.
+type written struct {
+	pmbr           diskImage
+	primaryHeader  diskImage
+	primaryEntries diskImage
+	backupEntries  diskImage
+	backupHeader   diskImage
+}
+
+// reset marks all blocks as unknown.
+func (w *written) reset() {
+	for _, image := range []*diskImage{&w.pmbr, &w.primaryHeader, &w.primaryEntries, &w.backupEntries, &w.backupHeader} {
+		image.data = image.data[:0]
+	}
+}
+
+// diskImage is a copy of the data stored on disk at the LBA.
+//
+// Empty data means that the contents on disk are unknown.
+type diskImage struct {
+	data []byte
+	lba  int64
+}
+
+// store records data as stored on disk at the LBA, reusing the image buffer.
+func (image *diskImage) store(lba int64, data []byte) {
+	image.lba = lba
+	image.data = append(image.data[:0], data...)
 }
 
 // Open attempts to open a partition table on f.
-func Open(f *os.File) (*GPT, error) {
-	buf := make([]byte, 16)
+func Open(f *os.File, setters ...Option) (*GPT, error) {
+	opts, err := NewDefaultOptions(setters...)
+	if err != nil {
+		return nil, err
+	}
 
-	// PMBR protective entry starts at 446. The partition type is at offset
-	// 4 from the start of the PMBR protective entry.
-	n, err := f.ReadAt(buf, 446)
+	l, err := lba.NewLBA(f, lba.WithDirectIO(opts.DirectIO), lba.WithObserver(opts.Observer))
 	if err != nil {
 		return nil, err
 	}
 
-	if n != len(buf) {
-		return nil, fmt.Errorf("incomplete read: %d != %d", n, len(buf))
+	g, err := open(f, l, opts.Observer)
+	if err != nil {
+		l.Close() //nolint:errcheck
+
+		return nil, err
 	}
 
-	// For GPT, the partition type should be 0xEE (EFI GPT).
-	if buf[4] == 0xEE {
-		l, err := lba.NewLBA(f)
-		if err != nil {
-			return nil, err
-		}
+	return g, nil
+}
 
-		h := &Header{LBA: l}
+func open(f *os.File, l *lba.LBA, o observe.Observer) (*GPT, error) {
+	// PMBR protective entry starts at 446. The partition type is at offset
+	// 4 from the start of the PMBR protective entry.
+	buf, err := l.ReadAt(0, 446, 16)
+	if err != nil {
+		return nil, err
+	}
 
-		if err = h.verifySignature(); err != nil {
-			return nil, ErrPartitionTableDoesNotExist
-		}
+	// For GPT, the partition type should be 0xEE (EFI GPT).
+	if buf[4] != 0xEE {
+		return nil, ErrPartitionTableDoesNotExist
+	}
 
-		g := &GPT{
-			f:               f,
-			l:               l,
-			h:               h,
-			e:               &Partitions{h: h, devname: f.Name()},
-			markMBRBootable: buf[0] == 0x80,
-		}
+	h := &Header{LBA: l}
+
+	if err = h.verifySignature(); err != nil {
+		return nil, ErrPartitionTableDoesNotExist
+	}
 
-		return g, nil
+	g := &GPT{
+		f:               f,
+		l:               l,
+		h:               h,
+		e:               &Partitions{h: h, devname: f.Name()},
+		markMBRBootable: buf[0] == 0x80,
+		observer:        o,
 	}
 
-	return nil, ErrPartitionTableDoesNotExist
+	return g, nil
 }
 
 // New creates an in-memory partition table.
@@ -97,7 +145,7 @@ func New(f *os.File, setters ...Option) (*GPT, error) {
 		return nil, err
 	}
 
-	l, err := lba.NewLBA(f)
+	l, err := lba.NewLBA(f, lba.WithDirectIO(opts.DirectIO), lba.WithObserver(opts.Observer))
 	if err != nil {
 		return nil, err
 	}
@@ -117,6 +165,8 @@ func New(f *os.File, setters ...Option) (*GPT, error) {
 
 	guuid, err := uuid.NewRandom()
 	if err != nil {
+		l.Close() //nolint:errcheck
+
 		return nil, fmt.Errorf("failed to generate UUID for new partition table: %w", err)
 	}
 
@@ -128,11 +178,19 @@ func New(f *os.File, setters ...Option) (*GPT, error) {
 		h:               h,
 		e:               &Partitions{h: h, devname: f.Name()},
 		markMBRBootable: opts.MarkMBRBootable,
+		observer:        opts.Observer,
 	}
 
 	return g, nil
 }
 
+// Close releases the resources held by the partition table.
+//
+// The file the partition table was opened on is not closed.
+func (g *GPT) Close() error {
+	return g.l.Close()
+}
+
 // Read reads the partition table on disk and updates the in-memory representation.
 func (g *GPT) Read() error {
 	err := g.h.read()
@@ -140,56 +198,208 @@ func (g *GPT) Read() error {
 		return err
 	}
 
-	err = g.e.read()
+	size, err := g.e.size()
 	if err != nil {
 		return err
 	}
 
+	// read the whole partition entries array at once, rounding up to the logical block size
+	blocks := (size + int(g.l.LogicalBlockSize) - 1) / int(g.l.LogicalBlockSize)
+
+	p := g.l.GetBuffer(blocks * int(g.l.LogicalBlockSize))
+	defer g.l.PutBuffer(p)
+
+	if err = g.l.ReadInto(int64(g.h.EntriesLBA), 0, *p); err != nil {
+		return fmt.Errorf("partition read: %w", err)
+	}
+
+	data := (*p)[:size]
+
+	if err = g.e.read(data); err != nil {
+		return err
+	}
+
 	g.renumberPartitions()
 
+	// primary header and entries were verified via the checksums, backup copies are unknown
+	g.written.reset()
+
+	header := g.l.GetBuffer(int(g.l.LogicalBlockSize))
+	defer g.l.PutBuffer(header)
+
+	g.h.primaryInto(*header)
+
+	g.written.primaryHeader.store(1, *header)
+	g.written.primaryEntries.store(int64(g.h.EntriesLBA), data)
+
 	return nil
 }
 
+// Changed checks whether the partition table on disk differs from the one last read or written.
+//
+// Only the primary header is read: it is protected by a checksum which covers
+// the partition entries checksum, so any change to the partition table changes it.
+func (g *GPT) Changed() (bool, error) {
+	return g.h.changed()
+}
+
+// Write writes the in-memory partition table to disk and informs the kernel of the changes.
+//
+// Only the blocks which differ from the partition table as last read or written are written.
 func (g *GPT) Write() error {
-	pmbr, err := g.newPMBR(g.h)
-	if err != nil {
-		return err
+	// if the partition table was changed by someone else, blocks can't be skipped
+	if changed, err := g.h.changed(); err != nil || changed {
+		g.written.reset()
 	}
 
-	err = g.l.WriteAt(0, 0x00, pmbr)
-	if err != nil {
+	blockSize := int(g.l.LogicalBlockSize)
+
+	pmbr := g.l.GetBuffer(512)
+	defer g.l.PutBuffer(pmbr)
+
+	if err := g.newPMBR(g.h, *pmbr); err != nil {
 		return err
 	}
 
-	// NB: Write the partitions first so that the header CRC calculations are
+	// NB: Build the partitions first so that the header CRC calculations are
 	// correct.
 
-	data, err := g.e.write()
+	size, err := g.e.size()
 	if err != nil {
 		return err
 	}
 
-	err = g.l.WriteAt(int64(g.h.EntriesLBA), 0x00, data)
-	if err != nil {
+	data := g.l.GetBuffer(size)
+	defer g.l.PutBuffer(data)
+
+	if err = g.e.writeInto(*data); err != nil {
 		return err
 	}
 
-	err = g.l.WriteAt(int64(g.h.LastUsableLBA+1), 0x00, data)
-	if err != nil {
+	primary := g.l.GetBuffer(blockSize)
+	defer g.l.PutBuffer(primary)
+
+	g.h.primaryInto(*primary)
+	g.h.Checksum = binary.LittleEndian.Uint32((*primary)[16:20])
+
+	backup := g.l.GetBuffer(blockSize)
+	defer g.l.PutBuffer(backup)
+
+	copy(*backup, *primary)
+	g.h.secondaryFromPrimary(*backup)
+
+	// in the usual layout the PMBR, primary header and entries are contiguous,
+	// as are the backup entries and header, so they are written with two system calls
+	if err = g.writeChunks([]chunk{
+		{&g.written.pmbr, 0, *pmbr},
+		{&g.written.primaryHeader, 1, *primary},
+		{&g.written.primaryEntries, int64(g.h.EntriesLBA), *data},
+		{&g.written.backupEntries, int64(g.h.LastUsableLBA + 1), *data},
+		{&g.written.backupHeader, g.l.TotalSectors - 1, *backup},
+	}); err != nil {
 		return err
 	}
 
-	err = g.h.write()
+	s := observe.Start(g.observer, observe.KindIO, g.f.Name(), "sync")
+
+	err = g.f.Sync()
+
+	s.End(err)
+
 	if err != nil {
 		return err
 	}
 
-	if err = g.f.Sync(); err != nil {
+	if err = g.syncKernelPartitions(); err != nil {
+		return fmt.Errorf("failed to sync kernel partitions: %w", err)
+	}
+
+	return nil
+}
+
+// chunk is a partition table structure to be written to disk at the LBA.
+type chunk struct {
+	image *diskImage
+	lba   int64
+	data  []byte
+}
+
+// writeChunks writes chunks to disk, skipping the blocks which are already on disk.
+//
+// Runs of changed blocks which are contiguous on disk are written with a single
+// vectored write, even if they span several chunks.
+func (g *GPT) writeChunks(chunks []chunk) error {
+	sort.SliceStable(chunks, func(i, j int) bool { return chunks[i].lba < chunks[j].lba })
+
+	blockSize := int(g.l.LogicalBlockSize)
+
+	var (
+		iovs     [][]byte
+		runLBA   int64
+		runStart int // start of the last iov in the current chunk
+		nextOff  = int64(-1)
+	)
+
+	flush := func() error {
+		if len(iovs) == 0 {
+			return nil
+		}
+
+		err := g.l.WriteVectorAt(runLBA, iovs)
+		iovs = iovs[:0]
+
 		return err
 	}
 
-	if err = g.syncKernelPartitions(); err != nil {
-		return fmt.Errorf("failed to sync kernel partitions: %w", err)
+	for _, c := range chunks {
+		full := len(c.image.data) == 0 || c.image.lba != c.lba || len(c.image.data) != len(c.data)
+		extend := false
+
+		for off := 0; off < len(c.data); off += blockSize {
+			end := off + blockSize
+			if end > len(c.data) {
+				end = len(c.data)
+			}
+
+			if !full && bytes.Equal(c.data[off:end], c.image.data[off:end]) {
+				if err := flush(); err != nil {
+					return err
+				}
+
+				extend = false
+
+				continue
+			}
+
+			diskOff := c.lba*int64(blockSize) + int64(off)
+
+			switch {
+			case extend:
+				iovs[len(iovs)-1] = c.data[runStart:end]
+			case diskOff == nextOff && len(iovs) > 0:
+				iovs = append(iovs, c.data[off:end])
+				runStart = off
+			default:
+				if err := flush(); err != nil {
+					return err
+				}
+
+				iovs = append(iovs, c.data[off:end])
+				runLBA = c.lba + int64(off/blockSize)
+				runStart = off
+			}
+
+			extend = true
+			nextOff = diskOff + int64(end-off)
+		}
+	}
+
+	if err := flush(); err != nil {
+		return err
+	}
+
+	for _, c := range chunks {
+		c.image.store(c.lba, c.data)
 	}
 
 	return nil
@@ -302,20 +512,7 @@ func (g *GPT) InsertAt(idx int, size uint64, setters ...PartitionOption) (*Parti
 
 // Delete deletes a partition.
 func (g *GPT) Delete(p *Partition) error {
-	index := -1
-
-	for i, part := range g.e.p {
-		if part == nil {
-			continue
-		}
-
-		if part.ID == p.ID {
-			index = i
-
-			break
-		}
-	}
-
+	index := g.e.positionByID(p.ID)
 	if index == -1 {
 		return fmt.Errorf("partition not found")
 	}
@@ -351,6 +548,7 @@ func (g *GPT) Resize(part *Partition) (bool, error) {
 	part.LastLBA = maxLBA
 
 	g.e.p[idx] = part
+	g.e.invalidateIndex()
 
 	return true, nil
 }
@@ -368,10 +566,12 @@ func (g *GPT) Repair() error {
 //   - https://www.syslinux.org/wiki/index.php?title=Doc/gpt
 //   - https://en.wikipedia.org/wiki/Master_boot_record
 //   - http://www.rodsbooks.com/gdisk/bios.html
-func (g *GPT) newPMBR(h *Header) ([]byte, error) {
-	p, err := g.l.ReadAt(0, 0, 512)
-	if err != nil {
-		return nil, err
+func (g *GPT) newPMBR(h *Header, p []byte) error {
+	if len(g.written.pmbr.data) == len(p) {
+		// PMBR as last written, no need to read it again
+		copy(p, g.written.pmbr.data)
+	} else if err := g.l.ReadInto(0, 0, p); err != nil {
+		return err
 	}
 
 	// Boot signature.
@@ -408,10 +608,13 @@ func (g *GPT) newPMBR(h *Header) ([]byte, error) {
 		binary.LittleEndian.PutUint32(b[12:16], uint32(h.BackupLBA))
 	}
 
-	return p, nil
+	return nil
 }
 
 func (g *GPT) renumberPartitions() {
+	// renumbering follows every change of the partitions array
+	g.e.invalidateIndex()
+
 	// In gpt, partition numbers aren't stored, so numbers are just in-memory representation.
 	idx := int32(1)
 
@@ -425,62 +628,72 @@ func (g *GPT) renumberPartitions() {
 	}
 }
 
+// syncKernelPartitions informs the kernel about partitions which differ from the kernel partition table.
+//
+// Partitions are matched by number: partitions which were removed or moved are deleted,
+// partitions which kept the start are resized (shrinking before growing so that kernel
+// partitions never overlap), and missing partitions are added.
 func (g *GPT) syncKernelPartitions() error {
 	kernelPartitions, err := blkpg.GetKernelPartitions(g.f)
 	if err != nil {
 		return err
 	}
 
-	// filter out nil partitions
-	newPartitions := make([]*Partition, 0, len(g.e.p))
+	newPartitions := make(map[int32]*Partition, len(g.e.p))
 
 	for _, part := range g.e.p {
-		if part == nil {
+		// kernel doesn't support zero-length partitions
+		if part == nil || part.LastLBA < part.FirstLBA {
 			continue
 		}
 
-		newPartitions = append(newPartitions, part)
+		newPartitions[part.Number] = part
 	}
 
-	var i int
+	// kernel partitions are in units of 512-byte sectors
+	sectorsPerBlock := uint64(g.l.LogicalBlockSize / 512)
 
-	// find partitions matching exactly or partitions which can be simply resized
-	for i = 0; i < len(kernelPartitions) && i < len(newPartitions); i++ {
-		kernelPart := kernelPartitions[i]
-		newPart := newPartitions[i]
+	var shrunk, grown []*Partition
 
-		// non-contiguous kernel partition table, stop
-		if kernelPart.No != i+1 {
-			break
-		}
+	for _, kernelPart := range kernelPartitions {
+		newPart, ok := newPartitions[int32(kernelPart.No)]
 
-		// skip partitions without any changes
-		if uint64(kernelPart.Start) == newPart.FirstLBA && uint64(kernelPart.Length) == newPart.Length() {
-			continue
-		}
-
-		// resizing a partition which is the last one in the kernel list (no overlaps)
-		if uint64(kernelPart.Start) == newPart.FirstLBA && i == len(kernelPartitions)-1 {
-			if err := blkpg.InformKernelOfResize(g.f, newPart.FirstLBA, newPart.Length(), newPart.Number); err != nil {
+		switch {
+		case !ok || uint64(kernelPart.Start) != newPart.FirstLBA*sectorsPerBlock:
+			if err := blkpg.InformKernelOfDelete(g.f, 0, 0, int32(kernelPart.No), blkpg.WithObserver(g.observer)); err != nil {
 				return err
 			}
+		case uint64(kernelPart.Length) > newPart.Length()*sectorsPerBlock:
+			shrunk = append(shrunk, newPart)
 
-			continue
-		}
+			delete(newPartitions, newPart.Number)
+		case uint64(kernelPart.Length) < newPart.Length()*sectorsPerBlock:
+			grown = append(grown, newPart)
 
-		// partitions don't match, stop
-		break
+			delete(newPartitions, newPart.Number)
+		default:
+			// partition is unchanged
+			delete(newPartitions, newPart.Number)
+		}
 	}
 
-	// process remaining partitions: delete all the kernel partitions left, add new partitions from in-memory set
-	for j := i; j < len(kernelPartitions); j++ {
-		if err := blkpg.InformKernelOfDelete(g.f, 0, 0, int32(kernelPartitions[j].No)); err != nil {
+	for _, part := range append(shrunk, grown...) {
+		if err := blkpg.InformKernelOfResize(g.f, part.FirstLBA, part.Length(), part.Number, blkpg.WithObserver(g.observer)); err != nil {
 			return err
 		}
 	}
 
-	for j := i; j < len(newPartitions); j++ {
-		if err := blkpg.InformKernelOfAdd(g.f, newPartitions[j].FirstLBA, newPartitions[j].Length(), newPartitions[j].Number); err != nil {
+	// add remaining partitions in order
+	for _, part := range g.e.p {
+		if part == nil {
+			continue
+		}
+
+		if _, ok := newPartitions[part.Number]; !ok {
+			continue
+		}
+
+		if err := blkpg.InformKernelOfAdd(g.f, part.FirstLBA, part.Length(), part.Number, blkpg.WithObserver(g.observer)); err != nil {
 			return err
 		}
 	}
@@ -6,13 +6,18 @@ package gpt_test
 
 import (
 	"encoding/binary"
+	"fmt"
 	"os"
 	"os/exec"
 	"testing"
 
+	"github.com/google/uuid"
+	"github.com/stretchr/testify/assert"
+	"github.com/stretchr/testify/require"
 	"github.com/stretchr/testify/suite"
 
 	"github.com/siderolabs/go-blockdevice/blockdevice"
+	"github.com/siderolabs/go-blockdevice/blockdevice/blkpg"
 	"github.com/siderolabs/go-blockdevice/blockdevice/lba"
 	"github.com/siderolabs/go-blockdevice/blockdevice/loopback"
 	"github.com/siderolabs/go-blockdevice/blockdevice/partition/gpt"
@@ -41,6 +46,27 @@ func (suite *GPTSuite) TestEmpty() {
 	suite.Require().EqualError(err, gpt.ErrPartitionTableDoesNotExist.Error())
 }
 
+func (suite *GPTSuite) TestDirectIO() {
+	g, err := gpt.New(suite.Dev, gpt.WithDirectIO(true))
+	suite.Require().NoError(err)
+
+	_, err = g.Add(1048576, gpt.WithPartitionName("boot"))
+	suite.Require().NoError(err)
+
+	suite.Require().NoError(g.Write())
+	suite.Require().NoError(g.Close())
+
+	g, err = gpt.Open(suite.Dev, gpt.WithDirectIO(true))
+	suite.Require().NoError(err)
+
+	defer g.Close() //nolint:errcheck
+
+	suite.Require().NoError(g.Read())
+
+	suite.Require().Len(g.Partitions().Items(), 1)
+	suite.Assert().Equal("boot", g.Partitions().Items()[0].Name)
+}
+
 func (suite *GPTSuite) TestReset() {
 	g, err := gpt.New(suite.Dev)
 	suite.Require().NoError(err)
@@ -498,6 +524,246 @@ func (suite *GPTSuite) TestPartitionInsertOffsetAndResize() {
 	suite.validatePartitions()
 }
 
+func (suite *GPTSuite) TestPartitionLookup() {
+	const efiType = "C12A7328-F81F-11D2-BA4B-00A0C93EC93B"
+
+	g, err := gpt.New(suite.Dev)
+	suite.Require().NoError(err)
+
+	efi, err := g.Add(1048576, gpt.WithPartitionName("efi"), gpt.WithPartitionType(efiType))
+	suite.Require().NoError(err)
+
+	boot, err := g.Add(1048576, gpt.WithPartitionName("boot"), gpt.WithPartitionType(efiType))
+	suite.Require().NoError(err)
+
+	system, err := g.Add(0, gpt.WithPartitionName("system"), gpt.WithMaximumSize(true))
+	suite.Require().NoError(err)
+
+	suite.Assert().Same(boot, g.Partitions().FindByName("boot"))
+	suite.Assert().Same(system, g.Partitions().FindByID(system.ID))
+	suite.Assert().Equal([]*gpt.Partition{efi, boot}, g.Partitions().FindByType(efi.Type))
+	suite.Assert().Nil(g.Partitions().FindByName("config"))
+
+	suite.Require().NoError(g.Delete(boot))
+
+	suite.Assert().Nil(g.Partitions().FindByName("boot"))
+	suite.Assert().Nil(g.Partitions().FindByID(boot.ID))
+	suite.Assert().Equal([]*gpt.Partition{efi}, g.Partitions().FindByType(efi.Type))
+
+	config, err := g.InsertAt(1, 1048576, gpt.WithPartitionName("config"))
+	suite.Require().NoError(err)
+
+	suite.Assert().Same(config, g.Partitions().FindByName("config"))
+	suite.Assert().Same(config, g.Partitions().FindByID(config.ID))
+	suite.Assert().Same(system, g.Partitions().FindByName("system"))
+
+	suite.Require().NoError(g.Write())
+
+	g, err = gpt.Open(suite.Dev)
+	suite.Require().NoError(err)
+
+	suite.Require().NoError(g.Read())
+
+	suite.Assert().EqualValues(3, g.Partitions().FindByName("system").Number)
+	suite.Assert().EqualValues(2, g.Partitions().FindByID(config.ID).Number)
+	suite.Assert().Len(g.Partitions().FindByType(efi.Type), 1)
+}
+
+func (suite *GPTSuite) TestPartitionLookupModifiedInPlace() {
+	const efiType = "C12A7328-F81F-11D2-BA4B-00A0C93EC93B"
+
+	g, err := gpt.New(suite.Dev)
+	suite.Require().NoError(err)
+
+	efi, err := g.Add(1048576, gpt.WithPartitionName("efi"), gpt.WithPartitionType(efiType))
+	suite.Require().NoError(err)
+
+	system, err := g.Add(0, gpt.WithPartitionName("system"), gpt.WithMaximumSize(true))
+	suite.Require().NoError(err)
+
+	// build the index
+	suite.Require().Same(system, g.Partitions().FindByName("system"))
+	suite.Require().Same(system, g.Partitions().FindByID(system.ID))
+	suite.Require().Equal([]*gpt.Partition{efi}, g.Partitions().FindByType(efi.Type))
+
+	// negative lookups don't drop the index
+	for i := 0; i < 3; i++ {
+		suite.Assert().Nil(g.Partitions().FindByName("missing"))
+		suite.Assert().Nil(g.Partitions().FindByID(uuid.New()))
+		suite.Assert().Nil(g.Partitions().FindByType(uuid.New()))
+	}
+
+	suite.Assert().True(g.Partitions().HasIndex())
+
+	efiTypeID := efi.Type
+
+	system.Name = "STATE"
+	system.ID = uuid.New()
+	efi.Type = system.Type
+
+	suite.Assert().Nil(g.Partitions().FindByName("system"))
+	suite.Assert().Same(system, g.Partitions().FindByName("STATE"))
+	suite.Assert().Same(system, g.Partitions().FindByID(system.ID))
+
+	// the stale type index entry is detected, and the index is rebuilt
+	suite.Assert().Nil(g.Partitions().FindByType(efiTypeID))
+	suite.Assert().Equal([]*gpt.Partition{efi, system}, g.Partitions().FindByType(system.Type))
+
+	// swap the names, the index points to the wrong partitions for both
+	efi.Name, system.Name = system.Name, efi.Name
+
+	suite.Assert().Same(efi, g.Partitions().FindByName("STATE"))
+	suite.Assert().Same(system, g.Partitions().FindByName("efi"))
+}
+
+func (suite *GPTSuite) TestTransaction() {
+	g, err := gpt.New(suite.Dev)
+	suite.Require().NoError(err)
+
+	boot, err := g.Add(1048576, gpt.WithPartitionName("boot"))
+	suite.Require().NoError(err)
+
+	system, err := g.Add(0, gpt.WithPartitionName("system"), gpt.WithMaximumSize(true))
+	suite.Require().NoError(err)
+
+	suite.Require().NoError(g.Write())
+
+	// rolled back changes are not visible
+	tx := g.Begin()
+
+	suite.Require().NoError(tx.Delete(boot))
+
+	_, err = tx.InsertAt(0, 1048576, gpt.WithPartitionName("grub"))
+	suite.Require().NoError(err)
+
+	suite.Require().NoError(tx.Rollback())
+	suite.Require().ErrorIs(tx.Commit(), gpt.ErrTransactionDone)
+
+	suite.Assert().Equal([]*gpt.Partition{boot, system}, g.Partitions().Items())
+	suite.Assert().EqualValues(1, boot.Number)
+	suite.Assert().Same(system, g.Partitions().FindByName("system"))
+	suite.Assert().Nil(g.Partitions().FindByName("grub"))
+
+	// committed changes are applied in one write
+	tx = g.Begin()
+
+	suite.Require().NoError(tx.Delete(system))
+
+	_, err = tx.Add(512*1048576, gpt.WithPartitionName("efi"))
+	suite.Require().NoError(err)
+
+	_, err = tx.Add(1048576, gpt.WithPartitionName("config"))
+	suite.Require().NoError(err)
+
+	_, err = tx.Add(0, gpt.WithPartitionName("system"), gpt.WithMaximumSize(true))
+	suite.Require().NoError(err)
+
+	suite.Require().NoError(tx.Commit())
+	suite.Require().ErrorIs(tx.Rollback(), gpt.ErrTransactionDone)
+
+	// re-read the partition table
+	g, err = gpt.Open(suite.Dev)
+	suite.Require().NoError(err)
+
+	suite.Require().NoError(g.Read())
+
+	partitions := g.Partitions().Items()
+	suite.Require().Len(partitions, 4)
+
+	kernelPartitions, err := blkpg.GetKernelPartitions(suite.Dev)
+	suite.Require().NoError(err)
+	suite.Require().Len(kernelPartitions, len(partitions))
+
+	for i, part := range partitions {
+		suite.Assert().EqualValues(i+1, part.Number)
+		suite.Assert().EqualValues(part.Number, kernelPartitions[i].No)
+		suite.Assert().EqualValues(part.FirstLBA, kernelPartitions[i].Start)
+		suite.Assert().EqualValues(part.Length(), kernelPartitions[i].Length)
+	}
+
+	suite.Assert().Equal("efi", partitions[1].Name)
+	suite.Assert().EqualValues((size-1048576-512*1048576-1048576)/blockSize-headReserved-tailReserved, partitions[3].Length())
+
+	suite.validatePartitions()
+}
+
+func (suite *GPTSuite) TestApplyLayout() {
+	g, err := gpt.New(suite.Dev)
+	suite.Require().NoError(err)
+
+	for _, p := range []struct {
+		name string
+		size uint64
+	}{
+		{"boot", 1048576},
+		{"efi", 100 * 1048576},
+		{"old", 10 * 1048576},
+	} {
+		_, err = g.Add(p.size, gpt.WithPartitionName(p.name))
+		suite.Require().NoError(err)
+	}
+
+	suite.Require().NoError(g.Write())
+
+	specs := []gpt.PartitionSpec{
+		{Name: "boot", Size: 1048576},
+		{Name: "efi", Size: 200 * 1048576},
+		{Name: "STATE", Percent: 10},
+		{Name: "EPHEMERAL", Rest: true},
+	}
+
+	changes, err := g.ApplyLayout(specs)
+	suite.Require().NoError(err)
+
+	actions := map[string]gpt.LayoutAction{}
+
+	for _, change := range changes {
+		name := change.Planned.Spec.Name
+		if change.Action == gpt.LayoutDelete {
+			name = change.Partition.Name
+		}
+
+		actions[name] = change.Action
+	}
+
+	suite.Assert().Equal(map[string]gpt.LayoutAction{
+		"boot":      gpt.LayoutKeep,
+		"efi":       gpt.LayoutResize,
+		"STATE":     gpt.LayoutCreate,
+		"EPHEMERAL": gpt.LayoutCreate,
+		"old":       gpt.LayoutDelete,
+	}, actions)
+
+	g, err = gpt.Open(suite.Dev)
+	suite.Require().NoError(err)
+	suite.Require().NoError(g.Read())
+
+	partitions := g.Partitions().Items()
+	suite.Require().Len(partitions, 4)
+
+	kernelPartitions, err := blkpg.GetKernelPartitions(suite.Dev)
+	suite.Require().NoError(err)
+	suite.Require().Len(kernelPartitions, len(partitions))
+
+	for i, part := range partitions {
+		suite.Assert().Equal(specs[i].Name, part.Name)
+		suite.Assert().Zero(part.FirstLBA % alignment)
+		suite.Assert().EqualValues(part.FirstLBA, kernelPartitions[i].Start)
+		suite.Assert().EqualValues(part.Length(), kernelPartitions[i].Length)
+	}
+
+	suite.Assert().EqualValues(200*1048576/blockSize, partitions[1].Length())
+	suite.Assert().EqualValues((size/blockSize-tailReserved)/alignment*alignment-1, partitions[3].LastLBA)
+
+	// re-applying the same layout keeps everything
+	changes, err = g.ApplyLayout(specs)
+	suite.Require().NoError(err)
+
+	for _, change := range changes {
+		suite.Assert().Equal(gpt.LayoutKeep, change.Action, change.Planned.Spec.Name)
+	}
+}
+
 func (suite *GPTSuite) TestPartitionGUUID() {
 	g, err := gpt.New(suite.Dev)
 	suite.Require().NoError(err)
@@ -575,6 +841,55 @@ func (suite *GPTSuite) validatePartitions() {
 	}
 }
 
+func TestPlanLayout(t *testing.T) {
+	l := &lba.LBA{
+		LogicalBlockSize:  512,
+		PhysicalBlockSize: 4096,
+		MinimalIOSize:     4096,
+		// RAID stripe of 3 x 512 KiB, combined with the 1 MiB alignment gives 3 MiB
+		OptimalIOSize: 3 * 512 * 1024,
+	}
+
+	const mib = 1024 * 1024 / 512
+
+	planned, err := gpt.PlanLayout(l, 34, 1024*mib-34, []gpt.PartitionSpec{
+		{Name: "fixed", Size: 1024 * 1024},
+		{Name: "half", Percent: 50},
+		{Name: "rest", Rest: true},
+	})
+	require.NoError(t, err)
+	require.Len(t, planned, 3)
+
+	assert.EqualValues(t, 3*mib, planned[0].FirstLBA)
+	assert.EqualValues(t, 4*mib-1, planned[0].LastLBA)
+
+	for _, p := range planned {
+		assert.Zero(t, p.FirstLBA%(3*mib), p.Spec.Name)
+	}
+
+	assert.EqualValues(t, 1023*mib-1, planned[2].LastLBA)
+
+	// sizes which aren't block multiples are rounded up
+	planned, err = gpt.PlanLayout(l, 34, 1024*mib-34, []gpt.PartitionSpec{
+		{Name: "odd", Size: 1024*1024 + 1},
+	})
+	require.NoError(t, err)
+	require.Len(t, planned, 1)
+
+	assert.EqualValues(t, mib+1, planned[0].LastLBA-planned[0].FirstLBA+1)
+
+	for _, specs := range [][]gpt.PartitionSpec{
+		{{Name: "a", Rest: true}, {Name: "b", Rest: true}},
+		{{Name: "a", Percent: 60}, {Name: "b", Percent: 50}},
+		{{Name: "a", Size: 2048 * 1024 * 1024}},
+		{{Name: "a", Size: 1024 * 1024, Percent: 10}},
+		{{Name: "a", Rest: true, MinSize: 2048 * 1024 * 1024}},
+	} {
+		_, err = gpt.PlanLayout(l, 34, 1024*mib-34, specs)
+		assert.Error(t, err)
+	}
+}
+
 func TestGPTSuite(t *testing.T) {
 	if os.Getuid() != 0 {
 		t.Skip("can't run the test as non-root")
@@ -582,3 +897,185 @@ func TestGPTSuite(t *testing.T) {
 
 	suite.Run(t, new(GPTSuite))
 }
+
+// benchmarkGPT creates a partition table with n partitions of 1 MiB in memory.
+func benchmarkGPT(b *testing.B, dev *os.File, n int) *gpt.GPT {
+	b.Helper()
+
+	g, err := gpt.New(dev)
+	if err != nil {
+		b.Fatal(err)
+	}
+
+	for i := 0; i < n; i++ {
+		if _, err = g.Add(1024*1024, gpt.WithPartitionName(fmt.Sprintf("part%d", i))); err != nil {
+			b.Fatal(err)
+		}
+	}
+
+	return g
+}
+
+func BenchmarkOpenRead(b *testing.B) {
+	for _, n := range []int{1, 16, 128} {
+		n := n
+
+		b.Run(fmt.Sprintf("partitions=%d", n), func(b *testing.B) {
+			d := test.CreateBenchmarkBlockDevice(b, 1024*1024*1024)
+
+			if err := benchmarkGPT(b, d.Dev, n).Write(); err != nil {
+				b.Fatal(err)
+			}
+
+			b.ReportAllocs()
+			b.ResetTimer()
+
+			for i := 0; i < b.N; i++ {
+				g, err := gpt.Open(d.Dev)
+				if err != nil {
+					b.Fatal(err)
+				}
+
+				if err = g.Read(); err != nil {
+					b.Fatal(err)
+				}
+			}
+		})
+	}
+}
+
+func BenchmarkWrite(b *testing.B) {
+	for _, n := range []int{1, 16, 128} {
+		n := n
+
+		b.Run(fmt.Sprintf("partitions=%d", n), func(b *testing.B) {
+			d := test.CreateBenchmarkBlockDevice(b, 1024*1024*1024)
+
+			b.ReportAllocs()
+			b.ResetTimer()
+
+			for i := 0; i < b.N; i++ {
+				// a new partition table writes all the blocks
+				if err := benchmarkGPT(b, d.Dev, n).Write(); err != nil {
+					b.Fatal(err)
+				}
+			}
+		})
+	}
+}
+
+func BenchmarkSyncKernelPartitions(b *testing.B) {
+	for _, n := range []int{1, 16, 128} {
+		n := n
+
+		b.Run(fmt.Sprintf("partitions=%d", n), func(b *testing.B) {
+			d := test.CreateBenchmarkBlockDevice(b, 1024*1024*1024)
+
+			empty := benchmarkGPT(b, d.Dev, 0)
+			full := benchmarkGPT(b, d.Dev, n)
+
+			if err := full.Write(); err != nil {
+				b.Fatal(err)
+			}
+
+			b.Run("unchanged", func(b *testing.B) {
+				b.ReportAllocs()
+
+				for i := 0; i < b.N; i++ {
+					if err := full.SyncKernelPartitions(); err != nil {
+						b.Fatal(err)
+					}
+				}
+			})
+
+			b.Run("changed", func(b *testing.B) {
+				b.ReportAllocs()
+
+				// every iteration removes or adds all the partitions
+				for i := 0; i < b.N; i++ {
+					g := empty
+					if i%2 == 1 {
+						g = full
+					}
+
+					if err := g.SyncKernelPartitions(); err != nil {
+						b.Fatal(err)
+					}
+				}
+
+				if err := full.SyncKernelPartitions(); err != nil {
+					b.Fatal(err)
+				}
+			})
+		})
+	}
+}
+
+func TestTransactionCommitFailure(t *testing.T) {
+	t.Parallel()
+
+	f, err := os.Create(t.TempDir() + "/disk")
+	require.NoError(t, err)
+
+	t.Cleanup(func() { f.Close() }) //nolint:errcheck
+
+	require.NoError(t, f.Truncate(64*1024*1024))
+
+	g, err := gpt.New(f)
+	require.NoError(t, err)
+
+	boot, err := g.Add(1048576, gpt.WithPartitionName("boot"))
+	require.NoError(t, err)
+
+	tx := g.Begin()
+
+	require.NoError(t, tx.Delete(boot))
+
+	_, err = tx.Add(2*1048576, gpt.WithPartitionName("efi"))
+	require.NoError(t, err)
+
+	// the kernel partitions can't be synced for a regular file
+	require.Error(t, tx.Commit())
+
+	require.NoError(t, tx.Rollback())
+
+	assert.Equal(t, []*gpt.Partition{boot}, g.Partitions().Items())
+	assert.Equal(t, "boot", boot.Name)
+	assert.Nil(t, g.Partitions().FindByName("efi"))
+}
+
+func TestApplyLayoutWriteFailure(t *testing.T) {
+	t.Parallel()
+
+	f, err := os.Create(t.TempDir() + "/disk")
+	require.NoError(t, err)
+
+	t.Cleanup(func() { f.Close() }) //nolint:errcheck
+
+	require.NoError(t, f.Truncate(64*1024*1024))
+
+	g, err := gpt.New(f)
+	require.NoError(t, err)
+
+	boot, err := g.Add(1048576, gpt.WithPartitionName("boot"))
+	require.NoError(t, err)
+
+	efi, err := g.Add(1048576, gpt.WithPartitionName("efi"))
+	require.NoError(t, err)
+
+	bootLastLBA := boot.LastLBA
+
+	// the kernel partitions can't be synced for a regular file
+	_, err = g.ApplyLayout([]gpt.PartitionSpec{
+		{Name: "boot", Size: 2 * 1048576, Attributes: 1},
+		{Name: "system", Rest: true},
+	})
+	require.Error(t, err)
+	assert.Contains(t, err.Error(), "failed to sync kernel partitions")
+
+	assert.Equal(t, []*gpt.Partition{boot, efi}, g.Partitions().Items())
+	assert.Equal(t, bootLastLBA, boot.LastLBA)
+	assert.Zero(t, boot.Attributes)
+	assert.EqualValues(t, 2, efi.Number)
+	assert.Nil(t, g.Partitions().FindByName("system"))
+}
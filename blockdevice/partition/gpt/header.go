@@ -5,7 +5,6 @@
 package gpt
 
 import (
-	"bytes"
 	"encoding/binary"
 	"fmt"
 	"hash/crc32"
@@ -38,8 +37,12 @@ type Header struct {
 }
 
 func (h *Header) verifySignature() error {
-	b, err := h.LBA.ReadAt(1, 0, 8)
-	if err != nil {
+	p := h.LBA.GetBuffer(8)
+	defer h.LBA.PutBuffer(p)
+
+	b := *p
+
+	if err := h.LBA.ReadInto(1, 0, b); err != nil {
 		return err
 	}
 
@@ -53,8 +56,12 @@ func (h *Header) verifySignature() error {
 }
 
 func (h *Header) read() error {
-	b, err := h.LBA.ReadAt(1, 0, HeaderSize)
-	if err != nil {
+	p := h.LBA.GetBuffer(int(h.LBA.LogicalBlockSize))
+	defer h.LBA.PutBuffer(p)
+
+	b := (*p)[:HeaderSize]
+
+	if err := h.LBA.ReadInto(1, 0, b); err != nil {
 		return err
 	}
 
@@ -77,8 +84,9 @@ func (h *Header) read() error {
 
 	if h.Size > HeaderSize {
 		// re-read the header to include all data
-		b, err = h.LBA.ReadAt(1, 0, HeaderSize)
-		if err != nil {
+		b = (*p)[:h.Size]
+
+		if err := h.LBA.ReadInto(1, 0, b); err != nil {
 			return err
 		}
 	}
@@ -99,10 +107,7 @@ func (h *Header) read() error {
 	h.FirstUsableLBA = binary.LittleEndian.Uint64(b[40:48])
 	h.LastUsableLBA = binary.LittleEndian.Uint64(b[48:56])
 
-	h.GUUID, err = uuid.FromBytes(endianness.FromMiddleEndian(b[56:72]))
-	if err != nil {
-		return fmt.Errorf("invalid GUUID: %w", err)
-	}
+	endianness.PutFromMiddleEndian(h.GUUID[:], b[56:72])
 
 	h.EntriesLBA = binary.LittleEndian.Uint64(b[72:80])
 	h.NumberOfPartitionEntries = binary.LittleEndian.Uint32(b[80:84])
@@ -113,30 +118,29 @@ func (h *Header) read() error {
 	return nil
 }
 
-func (h *Header) write() error {
-	p, err := h.primary()
-	if err != nil {
-		return err
-	}
+// changed checks whether the primary header on disk differs from the in-memory one.
+func (h *Header) changed() (bool, error) {
+	p := h.LBA.GetBuffer(HeaderSize)
+	defer h.LBA.PutBuffer(p)
 
-	err = h.WriteAt(1, 0x00, p)
-	if err != nil {
-		return err
-	}
+	b := *p
 
-	h.secondaryFromPrimary(p)
+	if err := h.LBA.ReadInto(1, 0, b); err != nil {
+		return false, err
+	}
 
-	err = h.WriteAt(h.TotalSectors-1, 0x00, p)
-	if err != nil {
-		return err
+	if string(b[:8]) != MagicEFIPart {
+		return true, nil
 	}
 
-	return nil
+	return binary.LittleEndian.Uint32(b[16:20]) != h.Checksum, nil
 }
 
-// primary returns the serialized primary header.
-func (h *Header) primary() ([]byte, error) {
-	b := make([]byte, h.LBA.LogicalBlockSize)
+// primaryInto serializes the primary header into b, which should be a logical block long.
+func (h *Header) primaryInto(b []byte) {
+	for i := range b {
+		b[i] = 0
+	}
 
 	copy(b[:8], MagicEFIPart)
 
@@ -152,20 +156,13 @@ func (h *Header) primary() ([]byte, error) {
 	binary.LittleEndian.PutUint64(b[40:48], h.FirstUsableLBA)
 	binary.LittleEndian.PutUint64(b[48:56], h.LastUsableLBA)
 
-	uuid, err := h.GUUID.MarshalBinary()
-	if err != nil {
-		return nil, err
-	}
-
-	copy(b[56:72], endianness.ToMiddleEndian(uuid))
+	endianness.PutMiddleEndian(b[56:72], h.GUUID[:])
 
 	binary.LittleEndian.PutUint64(b[72:80], h.EntriesLBA)
 	binary.LittleEndian.PutUint32(b[80:84], h.NumberOfPartitionEntries)
 	binary.LittleEndian.PutUint32(b[84:88], h.PartitionEntrySize)
 	binary.LittleEndian.PutUint32(b[88:92], h.PartitionEntriesChecksum)
 	binary.LittleEndian.PutUint32(b[16:20], crc32.ChecksumIEEE(b[0:h.Size]))
-
-	return b, nil
 }
 
 // secondaryFromPrimary modifies in-place primary header to be secondary header.
@@ -175,7 +172,7 @@ func (h *Header) secondaryFromPrimary(b []byte) {
 	binary.LittleEndian.PutUint64(b[32:40], h.CurrentLBA)
 
 	// CRC32 of header (offset +0 up to header size) in little endian, with this field zeroed during calculation.
-	copy(b[16:20], bytes.Repeat([]byte{0x00}, 4))
+	copy(b[16:20], []byte{0x00, 0x00, 0x00, 0x00})
 
 	binary.LittleEndian.PutUint32(b[16:20], crc32.ChecksumIEEE(b[0:h.Size]))
 }
@@ -0,0 +1,384 @@
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+package gpt
+
+import (
+	"fmt"
+
+	"github.com/google/uuid"
+
+	"github.com/siderolabs/go-blockdevice/blockdevice/lba"
+)
+
+// maxLayoutAlignment caps the partition alignment, optimal I/O sizes which
+// would require a larger alignment are ignored as bogus.
+const maxLayoutAlignment = 16 * 1024 * 1024
+
+// PartitionSpec describes a partition of the target layout.
+//
+// Exactly one of Size, Percent and Rest should be set.
+//
+//nolint:govet
+type PartitionSpec struct {
+	Name string
+	// Type is the partition type, Linux filesystem data if not set.
+	Type       uuid.UUID
+	Attributes uint64
+
+	// Size is the size in bytes, rounded up to whole logical blocks.
+	Size uint64
+	// Percent is the share of the space left after the fixed size partitions.
+	Percent uint
+	// Rest takes the space left after all other partitions, only one partition can have it.
+	Rest bool
+	// MinSize is the minimum size in bytes for the Percent and Rest partitions.
+	MinSize uint64
+}
+
+// PlannedPartition is a partition of the computed layout.
+type PlannedPartition struct {
+	Spec     PartitionSpec
+	FirstLBA uint64
+	LastLBA  uint64
+}
+
+// LayoutAction is the change to the partition table required by the layout.
+type LayoutAction int
+
+const (
+	// LayoutKeep keeps the partition as is.
+	LayoutKeep LayoutAction = iota
+	// LayoutResize moves the end of the partition, the start is kept.
+	LayoutResize
+	// LayoutCreate creates a new partition.
+	LayoutCreate
+	// LayoutDelete deletes the partition.
+	LayoutDelete
+)
+
+func (a LayoutAction) String() string {
+	switch a {
+	case LayoutKeep:
+		return "keep"
+	case LayoutResize:
+		return "resize"
+	case LayoutCreate:
+		return "create"
+	case LayoutDelete:
+		return "delete"
+	default:
+		return "unknown"
+	}
+}
+
+// LayoutChange is a single change of the layout diff.
+type LayoutChange struct {
+	Action LayoutAction
+	// Partition is the existing partition, nil for LayoutCreate.
+	Partition *Partition
+	// Planned is the target partition, zero for LayoutDelete.
+	Planned PlannedPartition
+}
+
+// PlanLayout computes the partition boundaries for the specs in a single pass.
+//
+// Partitions are placed in the order of the specs within [firstUsableLBA, lastUsableLBA].
+// Each partition starts at the alignment which satisfies the physical block size,
+// the minimal and optimal I/O sizes and the recommended 1 MiB alignment at once.
+func PlanLayout(l *lba.LBA, firstUsableLBA, lastUsableLBA uint64, specs []PartitionSpec) ([]PlannedPartition, error) { //nolint:gocyclo,cyclop
+	blockSize := uint64(l.LogicalBlockSize)
+	if blockSize == 0 {
+		return nil, fmt.Errorf("unknown logical block size")
+	}
+
+	align := layoutAlignment(l)
+
+	blocksOf := func(v uint64) uint64 { return (v + blockSize - 1) / blockSize }
+	alignUp := func(v uint64) uint64 { return (v + align - 1) / align * align }
+	alignDown := func(v uint64) uint64 { return v / align * align }
+
+	start := alignUp(firstUsableLBA)
+	end := alignDown(lastUsableLBA + 1)
+
+	if end <= start {
+		return nil, outOfSpaceError{fmt.Errorf("no aligned space available for partitions")}
+	}
+
+	available := end - start
+
+	var (
+		fixed    uint64
+		percents uint
+		rest     = -1
+	)
+
+	for i, spec := range specs {
+		set := 0
+
+		if spec.Size > 0 {
+			set++
+
+			// each partition occupies at most its size rounded up to the alignment
+			fixed += alignUp(blocksOf(spec.Size))
+		}
+
+		if spec.Percent > 0 {
+			set++
+
+			percents += spec.Percent
+		}
+
+		if spec.Rest {
+			set++
+
+			if rest != -1 {
+				return nil, fmt.Errorf("partitions %d and %d both take the rest of the disk", rest, i)
+			}
+
+			rest = i
+		}
+
+		if set != 1 {
+			return nil, fmt.Errorf("partition %d (%q) should have exactly one of size, percent or rest", i, spec.Name)
+		}
+	}
+
+	if percents > 100 {
+		return nil, fmt.Errorf("partition shares add up to %d%%", percents)
+	}
+
+	if fixed > available {
+		return nil, outOfSpaceError{fmt.Errorf("fixed size partitions require %d bytes, available is %d", fixed*blockSize, available*blockSize)}
+	}
+
+	flexible := available - fixed
+
+	sizes := make([]uint64, len(specs))
+
+	var shared uint64
+
+	for i, spec := range specs {
+		switch {
+		case spec.Size > 0:
+			sizes[i] = blocksOf(spec.Size)
+		case spec.Percent > 0:
+			sizes[i] = alignDown(flexible * uint64(spec.Percent) / 100)
+			shared += sizes[i]
+		}
+	}
+
+	if rest != -1 {
+		sizes[rest] = alignDown(flexible - shared)
+	}
+
+	planned := make([]PlannedPartition, len(specs))
+	next := start
+
+	for i, spec := range specs {
+		first := alignUp(next)
+
+		size := sizes[i]
+		if spec.Rest && i == len(specs)-1 {
+			// the last partition takes everything up to the end, including the alignment slack
+			size = end - first
+		}
+
+		if spec.MinSize > 0 && size*blockSize < spec.MinSize {
+			return nil, outOfSpaceError{fmt.Errorf("partition %d (%q) gets %d bytes, minimum is %d", i, spec.Name, size*blockSize, spec.MinSize)}
+		}
+
+		if size == 0 || first+size > end {
+			return nil, outOfSpaceError{fmt.Errorf("no space left for partition %d (%q)", i, spec.Name)}
+		}
+
+		planned[i] = PlannedPartition{
+			Spec:     spec,
+			FirstLBA: first,
+			LastLBA:  first + size - 1,
+		}
+
+		next = first + size
+	}
+
+	return planned, nil
+}
+
+// layoutAlignment returns the partition alignment in logical blocks.
+func layoutAlignment(l *lba.LBA) uint64 {
+	blockSize := uint64(l.LogicalBlockSize)
+	align := uint64(1)
+
+	for _, size := range []int64{l.PhysicalBlockSize, l.MinimalIOSize, lba.RecommendedAlignment, l.OptimalIOSize} {
+		if size <= 0 || uint64(size)%blockSize != 0 {
+			continue
+		}
+
+		candidate := lcm(align, uint64(size)/blockSize)
+		if candidate*blockSize > maxLayoutAlignment {
+			continue
+		}
+
+		align = candidate
+	}
+
+	return align
+}
+
+func lcm(a, b uint64) uint64 {
+	x, y := a, b
+
+	for y != 0 {
+		x, y = y, x%y
+	}
+
+	return a / x * b
+}
+
+// DiffLayout plans the layout for the partition table and returns the changes required to apply it.
+//
+// Existing partitions are matched to the specs by name: a partition is kept if its boundaries
+// are unchanged, resized if only the end moves, and recreated otherwise. Partitions
+// which don't match any spec are deleted.
+func (g *GPT) DiffLayout(specs []PartitionSpec) ([]LayoutChange, error) {
+	planned, err := PlanLayout(g.l, g.h.FirstUsableLBA, g.h.LastUsableLBA, specs)
+	if err != nil {
+		return nil, err
+	}
+
+	existing := make(map[string]*Partition, len(g.e.p))
+
+	for _, part := range g.e.p {
+		if part != nil && part.Name != "" {
+			existing[part.Name] = part
+		}
+	}
+
+	seen := make(map[string]struct{}, len(specs))
+	matched := make(map[*Partition]struct{}, len(specs))
+
+	var changes []LayoutChange
+
+	for _, p := range planned {
+		if p.Spec.Name != "" {
+			if _, ok := seen[p.Spec.Name]; ok {
+				return nil, fmt.Errorf("duplicate partition name %q", p.Spec.Name)
+			}
+
+			seen[p.Spec.Name] = struct{}{}
+		}
+
+		part := existing[p.Spec.Name]
+
+		switch {
+		case part == nil || part.FirstLBA != p.FirstLBA:
+			changes = append(changes, LayoutChange{Action: LayoutCreate, Planned: p})
+
+			continue
+		case part.LastLBA == p.LastLBA:
+			changes = append(changes, LayoutChange{Action: LayoutKeep, Partition: part, Planned: p})
+		default:
+			changes = append(changes, LayoutChange{Action: LayoutResize, Partition: part, Planned: p})
+		}
+
+		matched[part] = struct{}{}
+	}
+
+	for _, part := range g.e.p {
+		if part == nil {
+			continue
+		}
+
+		if _, ok := matched[part]; !ok {
+			changes = append(changes, LayoutChange{Action: LayoutDelete, Partition: part})
+		}
+	}
+
+	return changes, nil
+}
+
+// ApplyLayout replaces the partitions with the planned layout, and writes the partition table
+// with a single Write, which also syncs the kernel partition table.
+//
+// The changes are made in a transaction, so if the write fails, the in-memory partition
+// table is restored. The changes applied are returned.
+func (g *GPT) ApplyLayout(specs []PartitionSpec) ([]LayoutChange, error) {
+	changes, err := g.DiffLayout(specs)
+	if err != nil {
+		return nil, err
+	}
+
+	partitions, err := g.layoutPartitions(changes)
+	if err != nil {
+		return nil, err
+	}
+
+	t := g.Begin()
+
+	g.e.p = partitions
+
+	for _, change := range changes {
+		if change.Action != LayoutKeep && change.Action != LayoutResize {
+			continue
+		}
+
+		// the type of the existing partition is kept unless the spec sets it
+		change.Partition.LastLBA = change.Planned.LastLBA
+		change.Partition.Attributes = change.Planned.Spec.Attributes
+
+		if change.Planned.Spec.Type != uuid.Nil {
+			change.Partition.Type = change.Planned.Spec.Type
+		}
+	}
+
+	g.renumberPartitions()
+
+	if err = t.Commit(); err != nil {
+		t.Rollback() //nolint:errcheck
+
+		return nil, err
+	}
+
+	return changes, nil
+}
+
+// layoutPartitions builds the partitions array for the changes, existing partitions are reused as is.
+func (g *GPT) layoutPartitions(changes []LayoutChange) ([]*Partition, error) {
+	defaultType := NewDefaultPartitionOptions().Type
+
+	partitions := make([]*Partition, 0, len(changes))
+
+	for _, change := range changes {
+		p := change.Planned
+
+		switch change.Action {
+		case LayoutDelete:
+			continue
+		case LayoutKeep, LayoutResize:
+			partitions = append(partitions, change.Partition)
+		case LayoutCreate:
+			id, err := uuid.NewRandom()
+			if err != nil {
+				return nil, err
+			}
+
+			typ := p.Spec.Type
+			if typ == uuid.Nil {
+				typ = defaultType
+			}
+
+			partitions = append(partitions, &Partition{
+				Type:       typ,
+				ID:         id,
+				FirstLBA:   p.FirstLBA,
+				LastLBA:    p.LastLBA,
+				Attributes: p.Spec.Attributes,
+				Name:       p.Spec.Name,
+				devname:    g.e.devname,
+			})
+		}
+	}
+
+	return partitions, nil
+}
@@ -4,12 +4,18 @@
 
 package gpt
 
-import "fmt"
+import (
+	"fmt"
+
+	"github.com/siderolabs/go-blockdevice/blockdevice/observe"
+)
 
 // Options is the functional options struct.
 type Options struct {
 	PartitionEntriesStartLBA uint64
 	MarkMBRBootable          bool
+	DirectIO                 bool
+	Observer                 observe.Observer
 }
 
 // Option is the functional option func.
@@ -37,6 +43,28 @@ func WithMarkMBRBootable(value bool) Option {
 	}
 }
 
+// WithDirectIO reads and writes the partition table with O_DIRECT, bypassing the page cache.
+//
+// The device is opened once more with O_DIRECT, so the partition table should be closed with Close.
+func WithDirectIO(value bool) Option {
+	return func(args *Options) error {
+		args.DirectIO = value
+
+		return nil
+	}
+}
+
+// WithObserver sets the observer for the partition table I/O and the BLKPG ioctls.
+//
+// If not set, the process-wide observer (see observe.Register) is used.
+func WithObserver(o observe.Observer) Option {
+	return func(args *Options) error {
+		args.Observer = o
+
+		return nil
+	}
+}
+
 // NewDefaultOptions initializes an `Options` struct with default values.
 func NewDefaultOptions(setters ...Option) (*Options, error) {
 	opts := &Options{
@@ -9,6 +9,7 @@ import (
 	"encoding/binary"
 	"fmt"
 	"hash/crc32"
+	"io"
 
 	"github.com/google/uuid"
 	"golang.org/x/text/encoding/unicode"
@@ -25,6 +26,19 @@ type Partitions struct {
 	h       *Header
 	p       []*Partition
 	devname string
+
+	index *partitionIndex
+}
+
+// partitionIndex maps partition attributes to positions in the partitions array.
+//
+// The index is built on first lookup and dropped whenever the partitions array changes.
+// Name, ID and Type are exported and might be modified in place, so the partitions found are
+// verified, and the index is rebuilt if a partition found doesn't match anymore.
+type partitionIndex struct {
+	byName map[string]int
+	byID   map[uuid.UUID]int
+	byType map[uuid.UUID][]int
 }
 
 // Partition represents a GPT partition.
@@ -50,13 +64,131 @@ func (p *Partitions) Items() []*Partition {
 
 // FindByName finds partition by label.
 func (p *Partitions) FindByName(name string) *Partition {
-	for _, part := range p.Items() {
-		if part.Name == name {
-			return part
+	i := p.position(func(idx *partitionIndex) (int, bool) {
+		i, ok := idx.byName[name]
+
+		return i, ok
+	}, func(part *Partition) bool { return part.Name == name })
+	if i < 0 {
+		return nil
+	}
+
+	return p.p[i]
+}
+
+// FindByID finds partition by its unique GUID.
+func (p *Partitions) FindByID(id uuid.UUID) *Partition {
+	i := p.positionByID(id)
+	if i < 0 {
+		return nil
+	}
+
+	return p.p[i]
+}
+
+// FindByType finds all partitions with the specified partition type GUID.
+//
+// The partitions are looked up in the index, which is rebuilt only when the partitions array
+// changes, or when a partition found has a different type. So a partition which type was
+// changed in place to typ might not be found, callers changing the types in place should
+// look for the partitions with Items.
+func (p *Partitions) FindByType(typ uuid.UUID) []*Partition {
+	for rebuilt := false; ; rebuilt = true {
+		positions := p.getIndex().byType[typ]
+		result := make([]*Partition, 0, len(positions))
+
+		for _, i := range positions {
+			if i >= len(p.p) || p.p[i] == nil || p.p[i].Type != typ {
+				break
+			}
+
+			result = append(result, p.p[i])
+		}
+
+		if len(result) == len(positions) || rebuilt {
+			if len(result) == 0 {
+				return nil
+			}
+
+			return result
 		}
+
+		// the type of some partition was modified in place
+		p.invalidateIndex()
 	}
+}
 
-	return nil
+func (p *Partitions) positionByID(id uuid.UUID) int {
+	return p.position(func(idx *partitionIndex) (int, bool) {
+		i, ok := idx.byID[id]
+
+		return i, ok
+	}, func(part *Partition) bool { return part.ID == id })
+}
+
+// position looks up a partition position in the partitions array via the index.
+//
+// If the partition found doesn't match (it was modified in place), the index is dropped,
+// and it is rebuilt on the next lookup. If the index has no partition for the key, the
+// partitions are scanned, as well, as the partition might have been modified in place
+// to match, but the index is kept unless the scan finds it.
+func (p *Partitions) position(lookup func(*partitionIndex) (int, bool), match func(*Partition) bool) int {
+	i, ok := lookup(p.getIndex())
+	if ok && i < len(p.p) && p.p[i] != nil && match(p.p[i]) {
+		return i
+	}
+
+	for j, part := range p.p {
+		if part != nil && match(part) {
+			p.invalidateIndex()
+
+			return j
+		}
+	}
+
+	if ok {
+		p.invalidateIndex()
+	}
+
+	return -1
+}
+
+func (p *Partitions) getIndex() *partitionIndex {
+	if p.index != nil {
+		return p.index
+	}
+
+	idx := &partitionIndex{
+		byName: make(map[string]int, len(p.p)),
+		byID:   make(map[uuid.UUID]int, len(p.p)),
+		byType: map[uuid.UUID][]int{},
+	}
+
+	for i, part := range p.p {
+		if part == nil {
+			continue
+		}
+
+		// keep the first partition for duplicate keys, as a linear scan would find it first
+		if _, ok := idx.byName[part.Name]; !ok {
+			idx.byName[part.Name] = i
+		}
+
+		if _, ok := idx.byID[part.ID]; !ok {
+			idx.byID[part.ID] = i
+		}
+
+		idx.byType[part.Type] = append(idx.byType[part.Type], i)
+	}
+
+	p.index = idx
+
+	return idx
+}
+
+// invalidateIndex should be called whenever the partitions array changes.
+func (p *Partitions) invalidateIndex() {
+	p.index = nil
 }
 
 // Length returns the partition's length in LBA.
@@ -65,25 +197,56 @@ func (p *Partition) Length() uint64 {
 	return p.LastLBA - p.FirstLBA + 1
 }
 
-func (p *Partitions) read() error {
-	partitions := make([]*Partition, 0, p.h.NumberOfPartitionEntries)
+// EntryOffset returns the offset in bytes of the partition entry in the primary
+// partition entries array on the disk.
+func (p *Partitions) EntryOffset(part *Partition) int64 {
+	return int64(p.h.EntriesLBA)*p.h.LogicalBlockSize + int64(part.Number-1)*int64(p.h.PartitionEntrySize)
+}
 
-	checksummer := crc32.NewIEEE()
+// ReadPartitionEntry reads a single partition entry at off from r, e.g. to check
+// the partition at the offset returned by EntryOffset is still the same.
+//
+// The returned partition has no number, and the checksum of the partition
+// entries array is not verified.
+func ReadPartitionEntry(r io.ReaderAt, off int64) (*Partition, error) {
+	b := make([]byte, 128)
 
-	for i := uint32(0); i < p.h.NumberOfPartitionEntries; i++ {
-		offset := i * p.h.PartitionEntrySize
+	if _, err := r.ReadAt(b, off); err != nil {
+		return nil, err
+	}
 
-		data, err := p.h.ReadAt(int64(p.h.EntriesLBA), int64(offset), int64(p.h.PartitionEntrySize))
-		if err != nil {
-			return fmt.Errorf("partition read: %w", err)
-		}
+	part := &Partition{}
+
+	if err := part.deserialize(b); err != nil {
+		return nil, err
+	}
+
+	return part, nil
+}
+
+// size returns the size of the partition entries array in bytes.
+func (p *Partitions) size() (int, error) {
+	if p.h.PartitionEntrySize < 128 {
+		return 0, fmt.Errorf("partition entry size too small: %d", p.h.PartitionEntrySize)
+	}
+
+	return int(p.h.NumberOfPartitionEntries) * int(p.h.PartitionEntrySize), nil
+}
+
+// read parses the partition entries array data.
+func (p *Partitions) read(data []byte) error {
+	if checksum := crc32.ChecksumIEEE(data); checksum != p.h.PartitionEntriesChecksum {
+		return fmt.Errorf("expected partition checksum of %v, got %v", p.h.PartitionEntriesChecksum, checksum)
+	}
 
-		checksummer.Write(data)
+	partitions := make([]*Partition, 0, p.h.NumberOfPartitionEntries)
+
+	for i := uint32(0); i < p.h.NumberOfPartitionEntries; i++ {
+		offset := i * p.h.PartitionEntrySize
 
 		part := &Partition{Number: int32(i + 1), devname: p.devname}
 
-		err = part.deserialize(data)
-		if err != nil {
+		if err := part.deserialize(data[offset : offset+p.h.PartitionEntrySize]); err != nil {
 			return err
 		}
 
@@ -94,17 +257,17 @@ func (p *Partitions) read() error {
 		}
 	}
 
-	if checksummer.Sum32() != p.h.PartitionEntriesChecksum {
-		return fmt.Errorf("expected partition checksum of %v, got %v", p.h.PartitionEntriesChecksum, checksummer.Sum32())
-	}
-
 	p.p = partitions
+	p.invalidateIndex()
 
 	return nil
 }
 
-func (p *Partitions) write() ([]byte, error) {
-	data := make([]byte, p.h.NumberOfPartitionEntries*p.h.PartitionEntrySize)
+// writeInto serializes the partition entries array into data and updates the checksum in the header.
+func (p *Partitions) writeInto(data []byte) error {
+	for i := range data {
+		data[i] = 0
+	}
 
 	for i, part := range p.p {
 		if part == nil {
@@ -112,32 +275,24 @@ func (p *Partitions) write() ([]byte, error) {
 		}
 
 		if err := part.serialize(data[i*int(p.h.PartitionEntrySize):]); err != nil {
-			return nil, err
+			return err
 		}
 	}
 
 	p.h.PartitionEntriesChecksum = crc32.ChecksumIEEE(data)
 
-	return data, nil
+	return nil
 }
 
 var utf16 = unicode.UTF16(unicode.LittleEndian, unicode.IgnoreBOM)
 
 func (p *Partition) deserialize(b []byte) error {
-	var err error
-
-	p.Type, err = uuid.FromBytes(endianness.FromMiddleEndian(b[:16]))
-	if err != nil {
-		return fmt.Errorf("invalid GUUID: %w", err)
-	}
+	endianness.PutFromMiddleEndian(p.Type[:], b[:16])
 
 	// TODO: Provide a method for getting the human readable name of the type.
 	// See https://en.wikipedia.org/wiki/GUID_Partition_Table.
 
-	p.ID, err = uuid.FromBytes(endianness.FromMiddleEndian(b[16:32]))
-	if err != nil {
-		return fmt.Errorf("invalid GUUID: %w", err)
-	}
+	endianness.PutFromMiddleEndian(p.ID[:], b[16:32])
 
 	p.FirstLBA = binary.LittleEndian.Uint64(b[32:40])
 	p.LastLBA = binary.LittleEndian.Uint64(b[40:48])
@@ -154,19 +309,8 @@ func (p *Partition) deserialize(b []byte) error {
 }
 
 func (p *Partition) serialize(b []byte) error {
-	uuid, err := p.Type.MarshalBinary()
-	if err != nil {
-		return err
-	}
-
-	copy(b[:16], endianness.ToMiddleEndian(uuid))
-
-	uuid, err = p.ID.MarshalBinary()
-	if err != nil {
-		return err
-	}
-
-	copy(b[16:32], endianness.ToMiddleEndian(uuid))
+	endianness.PutMiddleEndian(b[:16], p.Type[:])
+	endianness.PutMiddleEndian(b[16:32], p.ID[:])
 
 	binary.LittleEndian.PutUint64(b[32:40], p.FirstLBA)
 	binary.LittleEndian.PutUint64(b[40:48], p.LastLBA)
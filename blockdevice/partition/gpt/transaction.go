@@ -0,0 +1,120 @@
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+package gpt
+
+import (
+	"errors"
+)
+
+// ErrTransactionDone indicates that the transaction was already committed or rolled back.
+var ErrTransactionDone = errors.New("partition table transaction is already done")
+
+// Transaction batches partition table changes which are written to disk with a single Commit.
+//
+// Changes are applied to the in-memory partition table as they are made,
+// Rollback restores the partition table to the state at the start of the transaction.
+type Transaction struct {
+	g *GPT
+
+	header     Header
+	partitions []*Partition
+	values     []Partition
+
+	done bool
+}
+
+// Begin starts a transaction on the partition table.
+func (g *GPT) Begin() *Transaction {
+	t := &Transaction{
+		g:          g,
+		header:     *g.h,
+		partitions: append([]*Partition(nil), g.e.p...),
+		values:     make([]Partition, len(g.e.p)),
+	}
+
+	for i, part := range g.e.p {
+		if part != nil {
+			t.values[i] = *part
+		}
+	}
+
+	return t
+}
+
+// Add adds a partition to the end of the list.
+func (t *Transaction) Add(size uint64, setters ...PartitionOption) (*Partition, error) {
+	if t.done {
+		return nil, ErrTransactionDone
+	}
+
+	return t.g.Add(size, setters...)
+}
+
+// InsertAt inserts partition before the partition at the position idx.
+func (t *Transaction) InsertAt(idx int, size uint64, setters ...PartitionOption) (*Partition, error) {
+	if t.done {
+		return nil, ErrTransactionDone
+	}
+
+	return t.g.InsertAt(idx, size, setters...)
+}
+
+// Delete deletes a partition.
+func (t *Transaction) Delete(p *Partition) error {
+	if t.done {
+		return ErrTransactionDone
+	}
+
+	return t.g.Delete(p)
+}
+
+// Resize resizes a partition to next one if exists.
+func (t *Transaction) Resize(part *Partition) (bool, error) {
+	if t.done {
+		return false, ErrTransactionDone
+	}
+
+	return t.g.Resize(part)
+}
+
+// Commit writes the partition table to disk with GPT.Write.
+//
+// If the write fails, the transaction stays open: Commit can be retried, or the
+// changes can be discarded with Rollback.
+func (t *Transaction) Commit() error {
+	if t.done {
+		return ErrTransactionDone
+	}
+
+	if err := t.g.Write(); err != nil {
+		return err
+	}
+
+	t.done = true
+
+	return nil
+}
+
+// Rollback discards the changes made in the transaction.
+func (t *Transaction) Rollback() error {
+	if t.done {
+		return ErrTransactionDone
+	}
+
+	t.done = true
+
+	*t.g.h = t.header
+
+	for i, part := range t.partitions {
+		if part != nil {
+			*part = t.values[i]
+		}
+	}
+
+	t.g.e.p = t.partitions
+	t.g.e.invalidateIndex()
+
+	return nil
+}
@@ -0,0 +1,387 @@
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+package probe
+
+import (
+	"encoding/json"
+	"errors"
+	"fmt"
+	"io"
+	"os"
+	"path/filepath"
+	"sort"
+	"sync"
+	"syscall"
+	"time"
+
+	"github.com/siderolabs/go-blockdevice/blockdevice"
+	"github.com/siderolabs/go-blockdevice/blockdevice/filesystem"
+	"github.com/siderolabs/go-blockdevice/blockdevice/partition/gpt"
+	"github.com/siderolabs/go-blockdevice/blockdevice/util"
+)
+
+// DefaultCachePath is the default location of the persistent cache.
+const DefaultCachePath = "/run/blockdevice/probe.cache"
+
+// Tag is the kind of identifier indexed by the Cache.
+type Tag string
+
+const (
+	// TagLabel is the filesystem label.
+	TagLabel Tag = "LABEL"
+	// TagUUID is the filesystem UUID.
+	TagUUID Tag = "UUID"
+	// TagPartLabel is the GPT partition name.
+	TagPartLabel Tag = "PARTLABEL"
+	// TagPartUUID is the GPT partition unique GUID.
+	TagPartUUID Tag = "PARTUUID"
+)
+
+// CacheEntry maps the value of a tag to the device path.
+//
+//nolint:govet
+type CacheEntry struct {
+	Tag   Tag    `json:"tag"`
+	Value string `json:"value"`
+
+	// Path is the device path, and Dev is the device number of the node.
+	Path string `json:"path"`
+	Dev  uint64 `json:"dev"`
+
+	// Source is the device the tag is read from to verify the entry: the device itself
+	// for filesystem tags, and the whole disk for partition tags.
+	Source string `json:"source"`
+	// Type is the filesystem type of the filesystem tags.
+	Type string `json:"type,omitempty"`
+	// Offset is the offset of the GPT partition entry on Source for partition tags.
+	Offset int64 `json:"offset,omitempty"`
+
+	// Time is the time of the scan the entry comes from, in seconds since the epoch.
+	Time int64 `json:"time"`
+}
+
+type cacheKey struct {
+	tag   Tag
+	value string
+}
+
+// Cache is a blkid-style persistent index of the filesystem and partition identifiers
+// of all block devices.
+//
+// Lookups are served from the index and each entry found is verified with a single
+// read: the device number of the node is checked, and the superblock or the partition
+// entry is read back to check the tag still matches. All devices are scanned only if
+// the entry is missing or stale.
+type Cache struct {
+	mu sync.Mutex
+
+	path    string
+	entries []CacheEntry
+	index   map[cacheKey]int
+	// ambiguous holds the tags found on more than one device
+	ambiguous map[cacheKey]struct{}
+	dirty     bool
+}
+
+// cacheFile is the on-disk format of the cache.
+type cacheFile struct {
+	Entries []CacheEntry `json:"entries"`
+}
+
+// NewCache creates an empty cache persisted at path.
+func NewCache(path string) *Cache {
+	c := &Cache{path: path}
+	c.reindex()
+
+	return c
+}
+
+// LoadCache loads the cache persisted at path.
+//
+// A missing or corrupted cache file results in an empty cache, which is
+// populated on the first lookup.
+func LoadCache(path string) (*Cache, error) {
+	c := NewCache(path)
+
+	data, err := os.ReadFile(path)
+	if err != nil {
+		if errors.Is(err, os.ErrNotExist) {
+			return c, nil
+		}
+
+		return nil, err
+	}
+
+	var f cacheFile
+
+	if err = json.Unmarshal(data, &f); err != nil {
+		return c, nil //nolint:nilerr
+	}
+
+	c.entries = f.Entries
+	c.reindex()
+
+	return c, nil
+}
+
+// Save persists the cache if it has changed since it was loaded.
+//
+// The cache file is replaced atomically.
+func (c *Cache) Save() error {
+	c.mu.Lock()
+	defer c.mu.Unlock()
+
+	if !c.dirty {
+		return nil
+	}
+
+	data, err := json.Marshal(cacheFile{Entries: c.entries})
+	if err != nil {
+		return err
+	}
+
+	if err = os.MkdirAll(filepath.Dir(c.path), 0o755); err != nil {
+		return err
+	}
+
+	tmp := c.path + ".tmp"
+
+	if err = os.WriteFile(tmp, data, 0o644); err != nil {
+		return err
+	}
+
+	if err = os.Rename(tmp, c.path); err != nil {
+		os.Remove(tmp) //nolint:errcheck
+
+		return err
+	}
+
+	c.dirty = false
+
+	return nil
+}
+
+// Entries returns a copy of the cache entries.
+func (c *Cache) Entries() []CacheEntry {
+	c.mu.Lock()
+	defer c.mu.Unlock()
+
+	return append([]CacheEntry(nil), c.entries...)
+}
+
+// Lookup returns the path of the device with the tag value.
+//
+// If the entry is missing or stale, all block devices are scanned and the lookup is retried.
+// os.ErrNotExist is returned if no device has the tag value.
+func (c *Cache) Lookup(tag Tag, value string) (string, error) {
+	c.mu.Lock()
+	defer c.mu.Unlock()
+
+	key := cacheKey{tag: tag, value: value}
+
+	for rescanned := false; ; rescanned = true {
+		i, found := c.index[key]
+
+		if _, ambiguous := c.ambiguous[key]; ambiguous && rescanned {
+			return "", fmt.Errorf("more than one block device has %s=%q", tag, value)
+		}
+
+		if found {
+			if _, ambiguous := c.ambiguous[key]; !ambiguous && verifyEntry(&c.entries[i]) {
+				return c.entries[i].Path, nil
+			}
+		}
+
+		if rescanned {
+			return "", os.ErrNotExist
+		}
+
+		if err := c.scan(); err != nil {
+			return "", err
+		}
+	}
+}
+
+// Scan rebuilds the cache from all block devices.
+func (c *Cache) Scan() error {
+	c.mu.Lock()
+	defer c.mu.Unlock()
+
+	return c.scan()
+}
+
+func (c *Cache) scan() error {
+	infos, err := os.ReadDir("/sys/block")
+	if err != nil {
+		return err
+	}
+
+	now := time.Now().Unix()
+
+	var entries []CacheEntry
+
+	for _, info := range infos {
+		entries = append(entries, scanDevice("/dev/"+info.Name(), now)...)
+	}
+
+	sort.SliceStable(entries, func(i, j int) bool {
+		if entries[i].Tag != entries[j].Tag {
+			return entries[i].Tag < entries[j].Tag
+		}
+
+		return entries[i].Value < entries[j].Value
+	})
+
+	c.entries = entries
+	c.dirty = true
+	c.reindex()
+
+	return nil
+}
+
+func (c *Cache) reindex() {
+	c.index = make(map[cacheKey]int, len(c.entries))
+	c.ambiguous = map[cacheKey]struct{}{}
+
+	for i, e := range c.entries {
+		key := cacheKey{tag: e.Tag, value: e.Value}
+
+		if j, ok := c.index[key]; ok {
+			if c.entries[j].Path != e.Path {
+				c.ambiguous[key] = struct{}{}
+			}
+
+			continue
+		}
+
+		c.index[key] = i
+	}
+}
+
+// scanDevice returns the entries for the block device and its partitions.
+//
+// Partition tags are recorded for all GPT partitions, filesystem tags for all
+// the partitions (or the whole device) with the recognized filesystem.
+func scanDevice(devpath string, now int64) []CacheEntry {
+	bd, err := blockdevice.Open(devpath, blockdevice.WithMode(blockdevice.ReadonlyMode))
+	if err != nil {
+		return nil
+	}
+
+	defer bd.Close() //nolint:errcheck
+
+	var entries []CacheEntry
+
+	addFilesystem := func(path string, dev uint64, r io.ReaderAt) {
+		//nolint: errcheck
+		sb, _ := filesystem.ProbeReader(r)
+		if sb == nil {
+			return
+		}
+
+		fsEntry := CacheEntry{Path: path, Dev: dev, Source: path, Type: sb.Type(), Time: now}
+
+		if label := filesystem.Label(sb); label != "" {
+			fsEntry.Tag, fsEntry.Value = TagLabel, label
+			entries = append(entries, fsEntry)
+		}
+
+		if id := filesystem.UUID(sb); id != "" {
+			fsEntry.Tag, fsEntry.Value = TagUUID, id
+			entries = append(entries, fsEntry)
+		}
+	}
+
+	pt, err := bd.PartitionTable()
+	if err != nil {
+		if dev, err := deviceNumber(devpath); err == nil {
+			addFilesystem(devpath, dev, bd.Device())
+		}
+
+		return entries
+	}
+
+	name := filepath.Base(devpath)
+
+	for _, part := range pt.Partitions().Items() {
+		if part == nil {
+			continue
+		}
+
+		partpath, err := util.PartPath(name, int(part.Number))
+		if err != nil {
+			return entries
+		}
+
+		dev, err := deviceNumber(partpath)
+		if err != nil {
+			continue
+		}
+
+		partEntry := CacheEntry{Path: partpath, Dev: dev, Source: devpath, Offset: pt.Partitions().EntryOffset(part), Time: now}
+
+		if part.Name != "" {
+			partEntry.Tag, partEntry.Value = TagPartLabel, part.Name
+			entries = append(entries, partEntry)
+		}
+
+		partEntry.Tag, partEntry.Value = TagPartUUID, part.ID.String()
+		entries = append(entries, partEntry)
+
+		// the partition is probed via its own node, as the page cache of the whole disk
+		// doesn't see the writes made via the partition node (e.g. by mkfs)
+		f, err := os.OpenFile(partpath, os.O_RDONLY|syscall.O_CLOEXEC, os.ModeDevice)
+		if err != nil {
+			continue
+		}
+
+		addFilesystem(partpath, dev, f)
+
+		f.Close() //nolint:errcheck
+	}
+
+	return entries
+}
+
+// verifyEntry checks the entry is up to date with a single read of the superblock or the partition entry.
+func verifyEntry(e *CacheEntry) bool {
+	if dev, err := deviceNumber(e.Path); err != nil || dev != e.Dev {
+		return false
+	}
+
+	f, err := os.OpenFile(e.Source, os.O_RDONLY|syscall.O_CLOEXEC, os.ModeDevice)
+	if err != nil {
+		return false
+	}
+
+	defer f.Close() //nolint:errcheck
+
+	switch e.Tag {
+	case TagLabel, TagUUID:
+		sb, err := filesystem.ProbeType(f, e.Type)
+		if err != nil || sb == nil {
+			return false
+		}
+
+		if e.Tag == TagLabel {
+			return filesystem.Label(sb) == e.Value
+		}
+
+		return filesystem.UUID(sb) == e.Value
+	case TagPartLabel, TagPartUUID:
+		part, err := gpt.ReadPartitionEntry(f, e.Offset)
+		if err != nil {
+			return false
+		}
+
+		if e.Tag == TagPartLabel {
+			return part.Name == e.Value
+		}
+
+		return part.ID.String() == e.Value
+	default:
+		return false
+	}
+}
@@ -0,0 +1,11 @@
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+package probe
+
+import "fmt"
+
+func deviceNumber(path string) (uint64, error) {
+	return 0, fmt.Errorf("not implemented")
+}
@@ -0,0 +1,18 @@
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+package probe
+
+import "golang.org/x/sys/unix"
+
+// deviceNumber returns the device number (dev_t) of the device node.
+func deviceNumber(path string) (uint64, error) {
+	var st unix.Stat_t
+
+	if err := unix.Stat(path, &st); err != nil {
+		return 0, err
+	}
+
+	return uint64(st.Rdev), nil
+}
@@ -5,18 +5,16 @@
 package probe
 
 import (
-	"bytes"
+	"context"
 	"fmt"
+	"io"
 	"os"
 	"path/filepath"
+	"sync"
+	"sync/atomic"
 
 	"github.com/siderolabs/go-blockdevice/blockdevice"
 	"github.com/siderolabs/go-blockdevice/blockdevice/filesystem"
-	"github.com/siderolabs/go-blockdevice/blockdevice/filesystem/ext4"
-	"github.com/siderolabs/go-blockdevice/blockdevice/filesystem/iso9660"
-	"github.com/siderolabs/go-blockdevice/blockdevice/filesystem/msdos"
-	"github.com/siderolabs/go-blockdevice/blockdevice/filesystem/vfat"
-	"github.com/siderolabs/go-blockdevice/blockdevice/filesystem/xfs"
 	"github.com/siderolabs/go-blockdevice/blockdevice/partition/gpt"
 	"github.com/siderolabs/go-blockdevice/blockdevice/util"
 )
@@ -27,6 +25,45 @@ type ProbedBlockDevice struct {
 
 	SuperBlock filesystem.SuperBlocker
 	Path       string
+
+	s      *session
+	closed bool
+}
+
+// Close closes the probed device.
+//
+// Devices probed from the same block device share the open file, which is closed
+// once all of them are closed.
+func (device *ProbedBlockDevice) Close() error {
+	if device.s == nil {
+		return device.BlockDevice.Close()
+	}
+
+	if device.closed {
+		return os.ErrClosed
+	}
+
+	device.closed = true
+
+	return device.s.release()
+}
+
+// partitionTable returns the partition table read during the probe.
+func (device *ProbedBlockDevice) partitionTable() (*gpt.GPT, error) {
+	if device.s != nil && device.s.pt != nil {
+		return device.s.pt, nil
+	}
+
+	return device.PartitionTable()
+}
+
+// superBlock returns the superblock found during the probe, probing it if needed.
+func (device *ProbedBlockDevice) superBlock() (filesystem.SuperBlocker, error) { //nolint:ireturn
+	if device.SuperBlock != nil {
+		return device.SuperBlock, nil
+	}
+
+	return filesystem.Probe(device.Path)
 }
 
 // SelectOption is a callback matcher for All block devices probes.
@@ -35,7 +72,7 @@ type SelectOption func(device *ProbedBlockDevice) (bool, error)
 // WithPartitionLabel search for a block device which has partitions with some specific label.
 func WithPartitionLabel(label string) SelectOption {
 	return func(device *ProbedBlockDevice) (bool, error) {
-		pt, err := device.PartitionTable()
+		pt, err := device.partitionTable()
 		if err != nil {
 			return false, err
 		}
@@ -47,42 +84,24 @@ func WithPartitionLabel(label string) SelectOption {
 // WithFileSystemLabel searches for a block device which has filesystem labeled with the provided label.
 func WithFileSystemLabel(label string) SelectOption {
 	return func(device *ProbedBlockDevice) (bool, error) {
-		superblock, err := filesystem.Probe(device.Path)
+		superblock, err := device.superBlock()
 		if err != nil {
 			return false, err
 		}
 
-		if superblock != nil {
-			switch sb := superblock.(type) {
-			case *iso9660.SuperBlock:
-				trimmed := bytes.Trim(sb.VolumeID[:], " \x00")
-				if bytes.Equal(trimmed, []byte(label)) {
-					return true, nil
-				}
-			case *vfat.SuperBlock:
-				trimmed := bytes.Trim(sb.Label[:], " \x00")
-				if bytes.Equal(trimmed, []byte(label)) {
-					return true, nil
-				}
-			case *msdos.SuperBlock:
-				trimmed := bytes.Trim(sb.Label[:], " \x00")
-				if bytes.Equal(trimmed, []byte(label)) {
-					return true, nil
-				}
-			case *xfs.SuperBlock:
-				trimmed := bytes.Trim(sb.Fname[:], " \x00")
-				if bytes.Equal(trimmed, []byte(label)) {
-					return true, nil
-				}
-			case *ext4.SuperBlock:
-				trimmed := bytes.Trim(sb.Label[:], " \x00")
-				if bytes.Equal(trimmed, []byte(label)) {
-					return true, nil
-				}
-			}
+		return superblock != nil && filesystem.Label(superblock) == label, nil
+	}
+}
+
+// WithFileSystemUUID searches for a block device which has filesystem with the provided UUID.
+func WithFileSystemUUID(uuid string) SelectOption {
+	return func(device *ProbedBlockDevice) (bool, error) {
+		superblock, err := device.superBlock()
+		if err != nil {
+			return false, err
 		}
 
-		return false, nil
+		return superblock != nil && filesystem.UUID(superblock) == uuid, nil
 	}
 }
 
@@ -113,101 +132,140 @@ func All(options ...SelectOption) ([]*ProbedBlockDevice, error) {
 	for _, info := range infos {
 		devpath := "/dev/" + info.Name()
 
-		probed := probePartitions(devpath)
+		selected, err := selectDevices(probePartitions(devpath), options)
+		if err != nil {
+			return nil, err
+		}
 
-		for _, dev := range probed {
-			add := false
-			for _, matches := range options {
-				add, err = matches(dev)
-				if err != nil {
-					if e := dev.Close(); e != nil {
-						return nil, e
-					}
+		all = append(all, selected...)
+	}
 
-					break
-				}
+	return all, nil
+}
 
-				if !add {
-					err = dev.Close()
-					if err != nil {
-						return nil, err
-					}
+// AllParallel is like All, but probes block devices concurrently using up to concurrency workers.
+//
+// Select options are applied once all devices are probed, in the same order as All applies them,
+// so the result is deterministic and stateful options (e.g. WithSingleResult) keep their semantics.
+func AllParallel(ctx context.Context, concurrency int, options ...SelectOption) ([]*ProbedBlockDevice, error) {
+	infos, err := os.ReadDir("/sys/block")
+	if err != nil {
+		return nil, err
+	}
 
-					break
-				}
-			}
+	if concurrency < 1 {
+		concurrency = 1
+	}
+
+	probed := make([][]*ProbedBlockDevice, len(infos))
+	indices := make(chan int)
+
+	var wg sync.WaitGroup
 
-			if add {
-				all = append(all, dev)
+	for w := 0; w < concurrency && w < len(infos); w++ {
+		wg.Add(1)
+
+		go func() {
+			defer wg.Done()
+
+			for i := range indices {
+				probed[i] = probePartitions("/dev/" + infos[i].Name())
 			}
+		}()
+	}
+
+feed:
+	for i := range infos {
+		select {
+		case indices <- i:
+		case <-ctx.Done():
+			break feed
 		}
 	}
 
-	return all, nil
-}
+	close(indices)
+	wg.Wait()
+
+	if err = ctx.Err(); err != nil {
+		for _, devs := range probed {
+			closeDevices(devs)
+		}
 
-// DevForPartitionLabel finds and opens partition as a blockdevice.
-func DevForPartitionLabel(devname, label string) (*blockdevice.BlockDevice, error) {
-	bd, err := blockdevice.Open(devname)
-	if err != nil {
 		return nil, err
 	}
 
-	return bd.OpenPartition(label)
-}
+	var all []*ProbedBlockDevice
 
-func probe(devpath string) []string {
-	devpaths := []string{}
+	for i, devs := range probed {
+		selected, err := selectDevices(devs, options)
+		if err != nil {
+			for _, rest := range probed[i+1:] {
+				closeDevices(rest)
+			}
 
-	// Start by opening the block device.
-	// If a partition table was not found, it is still possible that a
-	// file system exists without a partition table.
-	bd, err := blockdevice.Open(devpath, blockdevice.WithMode(blockdevice.ReadonlyMode))
-	if err != nil {
-		// Now blockdevice.Open returns error if it cannot read devpath
-		// I believe filesystem.Probe always return sb = nil
-		// but i keep it here. May be it will fix in future.
-		//nolint: errcheck
-		if sb, _ := filesystem.Probe(devpath); sb != nil {
-			devpaths = append(devpaths, devpath)
+			closeDevices(all)
+
+			return nil, err
 		}
 
-		return devpaths
+		all = append(all, selected...)
 	}
-	//nolint: errcheck
-	defer bd.Close()
 
-	// A partition table was not found, and we have already checked for
-	// a file system on the block device. Let's check if the block device
-	// has partitions.
-	pt, err := bd.PartitionTable()
-	if err != nil {
-		// If a partition table was not found, it is still possible that a
-		// file system exists without a partition table.
-		//nolint: errcheck
-		if sb, _ := filesystem.Probe(devpath); sb != nil {
-			devpaths = append(devpaths, devpath)
-		}
+	return all, nil
+}
 
-		return devpaths
-	}
+// selectDevices applies select options to the probed devices, closing devices which are not selected.
+func selectDevices(probed []*ProbedBlockDevice, options []SelectOption) ([]*ProbedBlockDevice, error) {
+	var (
+		selected []*ProbedBlockDevice
+		err      error
+	)
+
+	for _, dev := range probed {
+		add := false
+
+		for _, matches := range options {
+			add, err = matches(dev)
+			if err != nil {
+				if e := dev.Close(); e != nil {
+					return nil, e
+				}
 
-	// A partition table was found, now probe each partition's file system.
-	name := filepath.Base(devpath)
+				break
+			}
 
-	for _, part := range pt.Partitions().Items() {
-		partpath, err := util.PartPath(name, int(part.Number))
-		if err != nil {
-			return devpaths
+			if !add {
+				err = dev.Close()
+				if err != nil {
+					return nil, err
+				}
+
+				break
+			}
 		}
 
-		//nolint: errcheck
-		if sb, _ := filesystem.Probe(partpath); sb != nil {
-			devpaths = append(devpaths, partpath)
+		if add {
+			selected = append(selected, dev)
 		}
 	}
 
-	return devpaths
+	return selected, nil
+}
+
+func closeDevices(devs []*ProbedBlockDevice) {
+	for _, dev := range devs {
+		dev.Close() //nolint:errcheck
+	}
+}
+
+// DevForPartitionLabel finds and opens partition as a blockdevice.
+func DevForPartitionLabel(devname, label string) (*blockdevice.BlockDevice, error) {
+	bd, err := blockdevice.Open(devname)
+	if err != nil {
+		return nil, err
+	}
+
+	return bd.OpenPartition(label)
 }
 
 // GetDevWithPartitionName probes all known block device's partition
@@ -251,24 +309,87 @@ func GetPartitionWithName(name string) (*gpt.Partition, error) {
 	return device.GetPartition(name)
 }
 
-// Returns array with partitions or root readable device.
+// probePartitions returns the probed block device (if it has no partition table) or its partitions
+// which contain a recognized filesystem.
+//
+// The block device is opened and its partition table is read only once: filesystems are probed
+// via the block device file descriptor, and all returned devices share it.
 func probePartitions(devpath string) []*ProbedBlockDevice {
-	var probed []*ProbedBlockDevice //nolint:prealloc
+	bd, err := blockdevice.Open(devpath, blockdevice.WithMode(blockdevice.ReadonlyMode))
+	if err != nil {
+		return nil
+	}
 
-	for _, path := range probe(devpath) {
-		var (
-			bd  *blockdevice.BlockDevice
-			sb  filesystem.SuperBlocker
-			err error
-		)
+	s := &session{bd: bd}
 
-		bd, err = blockdevice.Open(devpath, blockdevice.WithMode(blockdevice.ReadonlyMode))
-		if err != nil {
+	probed := s.probe(devpath)
+	if len(probed) == 0 {
+		bd.Close() //nolint:errcheck
+	}
+
+	return probed
+}
+
+// session holds the state of a block device shared by all devices probed from it.
+type session struct {
+	bd *blockdevice.BlockDevice
+	pt *gpt.GPT
+
+	refs atomic.Int32
+}
+
+func (s *session) probe(devpath string) []*ProbedBlockDevice {
+	var probed []*ProbedBlockDevice
+
+	add := func(path string, sb filesystem.SuperBlocker) {
+		s.refs.Add(1)
+
+		probed = append(probed, &ProbedBlockDevice{BlockDevice: s.bd, SuperBlock: sb, Path: path, s: s})
+	}
+
+	pt, err := s.bd.PartitionTable()
+	if err != nil {
+		// If a partition table was not found, it is still possible that a
+		// file system exists without a partition table.
+		//nolint: errcheck
+		if sb, _ := filesystem.ProbeReader(s.bd.Device()); sb != nil {
+			add(devpath, sb)
+		}
+
+		return probed
+	}
+
+	s.pt = pt
+
+	// A partition table was found, now probe each partition's file system.
+	name := filepath.Base(devpath)
+	blockSize := pt.Header().LogicalBlockSize
+
+	for _, part := range pt.Partitions().Items() {
+		if part == nil {
 			continue
 		}
 
-		probed = append(probed, &ProbedBlockDevice{BlockDevice: bd, SuperBlock: sb, Path: path})
+		partpath, err := util.PartPath(name, int(part.Number))
+		if err != nil {
+			return probed
+		}
+
+		r := io.NewSectionReader(s.bd.Device(), int64(part.FirstLBA)*blockSize, int64(part.Length())*blockSize)
+
+		//nolint: errcheck
+		if sb, _ := filesystem.ProbeReader(r); sb != nil {
+			add(partpath, sb)
+		}
 	}
 
 	return probed
 }
+
+func (s *session) release() error {
+	if s.refs.Add(-1) == 0 {
+		return s.bd.Close()
+	}
+
+	return nil
+}
@@ -5,16 +5,19 @@
 package probe_test
 
 import (
+	"context"
 	"errors"
 	"fmt"
 	"os"
 	"os/exec"
+	"path/filepath"
 	"strconv"
 	"testing"
 
 	"github.com/stretchr/testify/suite"
 
 	"github.com/siderolabs/go-blockdevice/blockdevice"
+	"github.com/siderolabs/go-blockdevice/blockdevice/filesystem"
 	"github.com/siderolabs/go-blockdevice/blockdevice/partition/gpt"
 	"github.com/siderolabs/go-blockdevice/blockdevice/probe"
 	"github.com/siderolabs/go-blockdevice/blockdevice/test"
@@ -169,6 +172,54 @@ func (suite *ProbeSuite) TestProbeByFilesystemLabelBlockdeviceEXT4() {
 	suite.Require().Equal(suite.LoopbackDevice.Name(), probed[0].Path)
 }
 
+func (suite *ProbeSuite) TestProbeSuperBlock() {
+	g, err := gpt.New(suite.Dev)
+	suite.Require().NoError(err)
+
+	_, err = g.Add(1024*1024*64, gpt.WithPartitionName("empty"))
+	suite.Require().NoError(err)
+
+	partition, err := g.Add(1024*1024*64, gpt.WithPartitionName("ext4part"))
+	suite.Require().NoError(err)
+
+	suite.Require().NoError(g.Write())
+
+	partPath, err := partition.Path()
+	suite.Require().NoError(err)
+
+	cmd := exec.Command("mkfs.ext4", "-L", "EXTPART", partPath)
+	suite.Require().NoError(cmd.Run())
+
+	probed, err := probe.All(probe.WithFileSystemLabel("EXTPART"), probe.WithPartitionLabel("ext4part"))
+	suite.Require().NoError(err)
+	suite.Require().Equal(1, len(probed))
+
+	suite.Require().Equal(suite.LoopbackDevice.Name(), probed[0].Device().Name())
+	suite.Require().Equal(partPath, probed[0].Path)
+	suite.Require().NotNil(probed[0].SuperBlock)
+	suite.Require().Equal("ext4", probed[0].SuperBlock.Type())
+
+	suite.Require().NoError(probed[0].Close())
+	suite.Require().Error(probed[0].Close())
+}
+
+func (suite *ProbeSuite) TestProbeParallel() {
+	suite.setSystemLabelEXT4("EXTPARALLEL")
+
+	probed, err := probe.AllParallel(context.Background(), 4, probe.WithFileSystemLabel("EXTPARALLEL"), probe.WithSingleResult())
+	suite.Require().NoError(err)
+	suite.Require().Equal(1, len(probed))
+
+	suite.Require().Equal(suite.LoopbackDevice.Name(), probed[0].Device().Name())
+	suite.Require().Equal(suite.LoopbackDevice.Name(), probed[0].Path)
+
+	ctx, cancel := context.WithCancel(context.Background())
+	cancel()
+
+	_, err = probe.AllParallel(ctx, 4, probe.WithFileSystemLabel("EXTPARALLEL"))
+	suite.Require().ErrorIs(err, context.Canceled)
+}
+
 func (suite *ProbeSuite) TestProbeByFilesystemLabelPartition() {
 	suite.addPartition("FOO", 1024*1024*256, 16)
 	suite.addPartition("FSLABELPART", 1024*1024*2, 12)
@@ -181,6 +232,67 @@ func (suite *ProbeSuite) TestProbeByFilesystemLabelPartition() {
 	suite.Require().Equal(suite.LoopbackDevice.Name()+"p2", probed[0].Path)
 }
 
+func (suite *ProbeSuite) TestCache() {
+	g, err := gpt.New(suite.Dev)
+	suite.Require().NoError(err)
+
+	partition, err := g.Add(1024*1024*64, gpt.WithPartitionName("cachepart"))
+	suite.Require().NoError(err)
+
+	suite.Require().NoError(g.Write())
+
+	partPath, err := partition.Path()
+	suite.Require().NoError(err)
+
+	cmd := exec.Command("mkfs.ext4", "-L", "CACHED", partPath)
+	suite.Require().NoError(cmd.Run())
+
+	sb, err := filesystem.Probe(partPath)
+	suite.Require().NoError(err)
+	suite.Require().NotNil(sb)
+
+	cachePath := filepath.Join(suite.T().TempDir(), "probe.cache")
+
+	cache, err := probe.LoadCache(cachePath)
+	suite.Require().NoError(err)
+
+	for _, tc := range []struct {
+		tag   probe.Tag
+		value string
+	}{
+		{probe.TagLabel, "CACHED"},
+		{probe.TagUUID, filesystem.UUID(sb)},
+		{probe.TagPartLabel, "cachepart"},
+		{probe.TagPartUUID, partition.ID.String()},
+	} {
+		path, err := cache.Lookup(tc.tag, tc.value)
+		suite.Require().NoError(err, tc.tag)
+		suite.Assert().Equal(partPath, path, tc.tag)
+	}
+
+	suite.Require().NoError(cache.Save())
+
+	// the persisted cache is used as is
+	cache, err = probe.LoadCache(cachePath)
+	suite.Require().NoError(err)
+	suite.Require().NotEmpty(cache.Entries())
+
+	path, err := cache.Lookup(probe.TagLabel, "CACHED")
+	suite.Require().NoError(err)
+	suite.Assert().Equal(partPath, path)
+
+	// stale entries are detected
+	cmd = exec.Command("mkfs.ext4", "-F", "-L", "RELABELED", partPath)
+	suite.Require().NoError(cmd.Run())
+
+	_, err = cache.Lookup(probe.TagLabel, "CACHED")
+	suite.Require().ErrorIs(err, os.ErrNotExist)
+
+	path, err = cache.Lookup(probe.TagLabel, "RELABELED")
+	suite.Require().NoError(err)
+	suite.Assert().Equal(partPath, path)
+}
+
 func TestProbe(t *testing.T) {
 	if os.Getuid() != 0 {
 		t.Skip("can't run the test as non-root")
@@ -192,3 +304,51 @@ func TestProbe(t *testing.T) {
 
 	suite.Run(t, new(ProbeSuite))
 }
+
+func BenchmarkAll(b *testing.B) {
+	for _, n := range []int{1, 8, 32} {
+		n := n
+
+		b.Run(fmt.Sprintf("devices=%d", n), func(b *testing.B) {
+			for i := 0; i < n; i++ {
+				d := test.CreateBenchmarkBlockDevice(b, 64*1024*1024)
+
+				g, err := gpt.New(d.Dev)
+				if err != nil {
+					b.Fatal(err)
+				}
+
+				for _, name := range []string{"first", "second"} {
+					if _, err = g.Add(1024*1024, gpt.WithPartitionName(name)); err != nil {
+						b.Fatal(err)
+					}
+				}
+
+				if err = g.Write(); err != nil {
+					b.Fatal(err)
+				}
+			}
+
+			// nothing matches, so that every device and partition is probed
+			b.Run("All", func(b *testing.B) {
+				b.ReportAllocs()
+
+				for i := 0; i < b.N; i++ {
+					if _, err := probe.All(probe.WithPartitionLabel("nonexistent")); err != nil {
+						b.Fatal(err)
+					}
+				}
+			})
+
+			b.Run("AllParallel", func(b *testing.B) {
+				b.ReportAllocs()
+
+				for i := 0; i < b.N; i++ {
+					if _, err := probe.AllParallel(context.Background(), 4, probe.WithPartitionLabel("nonexistent")); err != nil {
+						b.Fatal(err)
+					}
+				}
+			})
+		})
+	}
+}
@@ -19,6 +19,11 @@ type FieldDeserializerFunc = func([]byte, interface{}) error
 // FieldSerializerFunc is the func signature for deserialization.
 type FieldSerializerFunc = func(uint32, uint32, []byte, interface{}) ([]byte, error)
 
+// FieldWriterFunc is the func signature for serialization into the field contents.
+//
+// Unlike FieldSerializerFunc, it writes directly into the data without allocating a copy.
+type FieldWriterFunc = func([]byte, interface{}) error
+
 // Field represents a field in a datastructure.
 //
 //nolint:govet
@@ -28,11 +33,20 @@ type Field struct {
 	Contents         *[]byte
 	SerializerFunc   FieldSerializerFunc
 	DeserializerFunc FieldDeserializerFunc
+	WriterFunc       FieldWriterFunc
 }
 
 // Ser serializes a field.
 func Ser(t Serde, data []byte, offset uint32, opts interface{}) error {
 	for _, field := range t.Fields() {
+		if field.WriterFunc != nil {
+			if err := field.WriterFunc(data[field.start(offset):field.end(offset)], opts); err != nil {
+				return err
+			}
+
+			continue
+		}
+
 		if field.SerializerFunc == nil {
 			return fmt.Errorf("the field is missing the serializer function")
 		}
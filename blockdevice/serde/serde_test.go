@@ -4,11 +4,62 @@
 
 package serde_test
 
-import "testing"
+import (
+	"encoding/binary"
+	"testing"
 
-func TestEmpty(_ *testing.T) {
-	// added for accurate coverage estimation
-	//
-	// please remove it once any unit-test is added
-	// for this package
+	"github.com/stretchr/testify/assert"
+	"github.com/stretchr/testify/require"
+
+	"github.com/siderolabs/go-blockdevice/blockdevice/serde"
+)
+
+type record struct {
+	magic   []byte
+	counter uint32
+}
+
+func (r *record) Fields() []*serde.Field {
+	return []*serde.Field{
+		{
+			Offset: 0,
+			Length: 4,
+			SerializerFunc: func(uint32, uint32, []byte, interface{}) ([]byte, error) {
+				return r.magic, nil
+			},
+			DeserializerFunc: func(contents []byte, _ interface{}) error {
+				r.magic = append(r.magic[:0], contents...)
+
+				return nil
+			},
+		},
+		{
+			Offset: 4,
+			Length: 4,
+			WriterFunc: func(contents []byte, _ interface{}) error {
+				binary.LittleEndian.PutUint32(contents, r.counter)
+
+				return nil
+			},
+			DeserializerFunc: func(contents []byte, _ interface{}) error {
+				r.counter = binary.LittleEndian.Uint32(contents)
+
+				return nil
+			},
+		},
+	}
+}
+
+func TestSerde(t *testing.T) {
+	r := &record{magic: []byte("SERD"), counter: 42}
+
+	data := make([]byte, 10)
+
+	require.NoError(t, serde.Ser(r, data, 2, nil))
+	assert.Equal(t, []byte{0, 0, 'S', 'E', 'R', 'D', 42, 0, 0, 0}, data)
+
+	var decoded record
+
+	require.NoError(t, serde.De(&decoded, data, 2, nil))
+	assert.Equal(t, r, &decoded)
 }
@@ -6,13 +6,99 @@
 package test
 
 import (
+	"errors"
 	"os"
+	"testing"
 
 	"github.com/stretchr/testify/suite"
 
 	"github.com/siderolabs/go-blockdevice/blockdevice/loopback"
 )
 
+// BlockDevice is a loopback device backed by a temporary file.
+type BlockDevice struct {
+	File           *os.File
+	Dev            *os.File
+	LoopbackDevice *os.File
+}
+
+// NewBlockDevice creates a loopback device of the given size.
+func NewBlockDevice(size int64) (_ *BlockDevice, rerr error) { //nolint:nonamedreturns
+	d := &BlockDevice{}
+
+	defer func() {
+		if rerr != nil {
+			d.Close() //nolint:errcheck
+		}
+	}()
+
+	var err error
+
+	if d.File, err = os.CreateTemp("", "blockDevice"); err != nil {
+		return nil, err
+	}
+
+	if err = d.File.Truncate(size); err != nil {
+		return nil, err
+	}
+
+	if d.LoopbackDevice, err = loopback.Attach(d.File); err != nil {
+		return nil, err
+	}
+
+	if d.Dev, err = os.OpenFile(d.LoopbackDevice.Name(), os.O_RDWR, 0); err != nil {
+		return nil, err
+	}
+
+	return d, nil
+}
+
+// Close detaches the loopback device and removes the backing file.
+func (d *BlockDevice) Close() error {
+	var errs []error
+
+	if d.Dev != nil {
+		errs = append(errs, d.Dev.Close())
+		d.Dev = nil
+	}
+
+	if d.LoopbackDevice != nil {
+		errs = append(errs, loopback.Unloop(d.LoopbackDevice), d.LoopbackDevice.Close())
+		d.LoopbackDevice = nil
+	}
+
+	if d.File != nil {
+		errs = append(errs, d.File.Close(), os.Remove(d.File.Name()))
+		d.File = nil
+	}
+
+	return errors.Join(errs...)
+}
+
+// CreateBenchmarkBlockDevice creates a loopback device which is released when the benchmark finishes.
+//
+// The benchmark is skipped if it can't create loopback devices.
+func CreateBenchmarkBlockDevice(b *testing.B, size int64) *BlockDevice {
+	b.Helper()
+
+	if os.Getuid() != 0 {
+		b.Skip("can't run the benchmark as non-root")
+	}
+
+	d, err := NewBlockDevice(size)
+	if err != nil {
+		b.Fatalf("failed to create block device: %s", err)
+	}
+
+	b.Cleanup(func() {
+		if err := d.Close(); err != nil {
+			b.Errorf("failed to release block device: %s", err)
+		}
+	})
+
+	return d
+}
+
 // BlockDeviceSuite is a common base for all tests that rely on loopback device creation.
 type BlockDeviceSuite struct {
 	suite.Suite
@@ -24,24 +110,12 @@ type BlockDeviceSuite struct {
 
 // CreateBlockDevice creates a blockDevice.
 func (suite *BlockDeviceSuite) CreateBlockDevice(size int64) {
-	var err error
-
-	suite.File, err = os.CreateTemp("", "blockDevice")
+	d, err := NewBlockDevice(size)
 	suite.Require().NoError(err)
 
-	suite.Require().NoError(suite.File.Truncate(size))
-
-	suite.LoopbackDevice, err = loopback.NextLoopDevice()
-	suite.Require().NoError(err)
+	suite.File, suite.Dev, suite.LoopbackDevice = d.File, d.Dev, d.LoopbackDevice
 
 	suite.T().Logf("Using %s", suite.LoopbackDevice.Name())
-
-	suite.Require().NoError(loopback.Loop(suite.LoopbackDevice, suite.File))
-
-	suite.Require().NoError(loopback.LoopSetReadWrite(suite.LoopbackDevice))
-
-	suite.Dev, err = os.OpenFile(suite.LoopbackDevice.Name(), os.O_RDWR, 0)
-	suite.Require().NoError(err)
 }
 
 // TearDownTest implements suite.Suite.
@@ -7,13 +7,17 @@ package disk
 
 import (
 	"fmt"
-	"io"
 	"os"
 	"path/filepath"
+	"runtime"
 	"strconv"
 	"strings"
+	"sync"
+	"sync/atomic"
 
 	glob "github.com/ryanuber/go-glob"
+
+	"github.com/siderolabs/go-blockdevice/blockdevice/observe"
 )
 
 // Type is the disk type: HDD, SSD, SD card, NVMe drive.
@@ -94,12 +98,18 @@ type Disk struct {
 	SubSystem string
 	// ReadOnly indicates that the kernel has marked this disk as read-only.
 	ReadOnly bool
+
+	// probe collects the attributes checked by the matchers, see matcherAttributes.
+	probe *attribute
 }
 
 // List returns list of disks by reading /sys/block.
 func List() ([]*Disk, error) {
-	disks := []*Disk{}
+	return list(attrAll)
+}
 
+// list returns disks with the attributes in the mask, gathered concurrently.
+func list(mask attribute) ([]*Disk, error) {
 	sysblock := "/sys/block"
 
 	devices, err := os.ReadDir(sysblock)
@@ -107,6 +117,8 @@ func List() ([]*Disk, error) {
 		return nil, fmt.Errorf("failed to read /sys/block directory %w", err)
 	}
 
+	names := make([]string, 0, len(devices))
+
 	for _, dev := range devices {
 		skip := false
 		deviceName := filepath.Base(dev.Name())
@@ -123,7 +135,45 @@ func List() ([]*Disk, error) {
 			continue
 		}
 
-		disk := Get(deviceName)
+		names = append(names, deviceName)
+	}
+
+	gathered := make([]*Disk, len(names))
+
+	workers := runtime.GOMAXPROCS(0)
+	if workers > len(names) {
+		workers = len(names)
+	}
+
+	var (
+		wg   sync.WaitGroup
+		next atomic.Int32
+	)
+
+	for i := 0; i < workers; i++ {
+		wg.Add(1)
+
+		go func() {
+			defer wg.Done()
+
+			r := newAttrReader()
+
+			for {
+				idx := int(next.Add(1)) - 1
+				if idx >= len(names) {
+					return
+				}
+
+				gathered[idx] = get(names[idx], mask, r)
+			}
+		}()
+	}
+
+	wg.Wait()
+
+	disks := make([]*Disk, 0, len(gathered))
+
+	for _, disk := range gathered {
 		if disk.Size == 0 {
 			continue
 		}
@@ -136,98 +186,165 @@ func List() ([]*Disk, error) {
 
 // Get gathers disk information from sys block.
 func Get(dev string) *Disk {
-	sysblock := "/sys/block"
+	return get(dev, attrAll, newAttrReader())
+}
 
-	dev = filepath.Base(dev)
+// attribute is a bitmask of the disk attributes to gather.
+type attribute uint
+
+const (
+	attrModel attribute = 1 << iota
+	attrName
+	attrSerial
+	attrModalias
+	attrWWID
+	attrUUID
+	attrType
+	attrBusPath
+	attrSubSystem
+	attrReadOnly
+
+	attrAll = attrModel | attrName | attrSerial | attrModalias | attrWWID | attrUUID | attrType | attrBusPath | attrSubSystem | attrReadOnly
+)
+
+// attrReader reads sysfs attributes into a reusable buffer.
+type attrReader struct {
+	buf []byte
+}
+
+func newAttrReader() *attrReader {
+	return &attrReader{buf: make([]byte, 4096)}
+}
+
+func (r *attrReader) read(parts ...string) string {
+	var device string
 
-	fullPath, _ := os.Readlink(filepath.Join(sysblock, dev)) //nolint:errcheck
+	if len(parts) > 1 {
+		device = parts[1]
+	}
+
+	s := observe.Start(nil, observe.KindIO, device, "sysfs")
+
+	f, err := os.Open(filepath.Join(parts...))
+	if err != nil {
+		s.End(err)
+
+		return ""
+	}
 
-	busPath := strings.TrimPrefix(fullPath, "../devices")
-	busPath = strings.TrimSuffix(busPath, filepath.Join("block", dev))
+	defer f.Close() //nolint:errcheck
 
-	readFile := func(parts ...string) string {
-		path := filepath.Join(parts...)
+	n := 0
 
-		f, e := os.Open(path)
-		if e != nil {
-			return ""
+	for {
+		if n == len(r.buf) {
+			r.buf = append(r.buf, make([]byte, len(r.buf))...)
 		}
 
-		data, e := io.ReadAll(f)
-		if e != nil {
-			return ""
+		m, err := f.Read(r.buf[n:])
+		n += m
+
+		if err != nil {
+			break
 		}
+	}
+
+	s.End(nil)
+
+	return strings.TrimSpace(string(r.buf[:n]))
+}
 
-		return strings.TrimSpace(string(data))
+// get gathers disk attributes in the mask, size and device name are always gathered.
+//
+//nolint:gocyclo,cyclop
+func get(dev string, mask attribute, r *attrReader) *Disk {
+	sysblock := "/sys/block"
+
+	dev = filepath.Base(dev)
+
+	disk := &Disk{
+		DeviceName: fmt.Sprintf("/dev/%s", dev),
 	}
 
-	var size uint64
+	if mask&attrBusPath != 0 {
+		fullPath, _ := os.Readlink(filepath.Join(sysblock, dev)) //nolint:errcheck
+
+		busPath := strings.TrimPrefix(fullPath, "../devices")
+		disk.BusPath = strings.TrimSuffix(busPath, filepath.Join("block", dev))
+	}
 
-	s := readFile(sysblock, dev, "size")
+	s := r.read(sysblock, dev, "size")
 	if s != "" {
 		var err error
 
-		size, err = strconv.ParseUint(strings.TrimSpace(s), 10, 64)
+		disk.Size, err = strconv.ParseUint(strings.TrimSpace(s), 10, 64)
 		if err != nil {
-			size = 0
+			disk.Size = 0
 		}
 
-		size *= 512
+		disk.Size *= 512
 	}
 
-	diskType := TypeUnknown
-	rotational := readFile(sysblock, dev, "queue/rotational")
-
-	switch {
-	case strings.Contains(dev, "nvme"):
-		diskType = TypeNVMe
-	case strings.Contains(dev, "mmc"):
-		diskType = TypeSD
-	case rotational == "1":
-		diskType = TypeHDD
-	case rotational == "0":
-		diskType = TypeSSD
+	if mask&attrType != 0 {
+		disk.Type = TypeUnknown
+
+		switch {
+		case strings.Contains(dev, "nvme"):
+			disk.Type = TypeNVMe
+		case strings.Contains(dev, "mmc"):
+			disk.Type = TypeSD
+		default:
+			switch r.read(sysblock, dev, "queue/rotational") {
+			case "1":
+				disk.Type = TypeHDD
+			case "0":
+				disk.Type = TypeSSD
+			}
+		}
 	}
 
-	uuid := readFile(sysblock, dev, "uuid")
-	if uuid == "" {
-		uuid = readFile(sysblock, dev, "device/uuid")
+	if mask&attrUUID != 0 {
+		disk.UUID = r.read(sysblock, dev, "uuid")
+		if disk.UUID == "" {
+			disk.UUID = r.read(sysblock, dev, "device/uuid")
+		}
 	}
 
-	wwid := readFile(sysblock, dev, "wwid")
-	if wwid == "" {
-		wwid = readFile(sysblock, dev, "device/wwid")
+	if mask&attrWWID != 0 {
+		disk.WWID = r.read(sysblock, dev, "wwid")
+		if disk.WWID == "" {
+			disk.WWID = r.read(sysblock, dev, "device/wwid")
+		}
 	}
 
-	serial := readFile(sysblock, dev, "serial")
-	if serial == "" {
-		serial = readFile(sysblock, dev, "device/serial")
+	if mask&attrSerial != 0 {
+		disk.Serial = r.read(sysblock, dev, "serial")
+		if disk.Serial == "" {
+			disk.Serial = r.read(sysblock, dev, "device/serial")
+		}
 	}
 
-	var readOnlyBool bool
+	if mask&attrReadOnly != 0 {
+		disk.ReadOnly = r.read(sysblock, dev, "ro") == "1"
+	}
 
-	readOnly := readFile(sysblock, dev, "ro")
-	if readOnly == "1" {
-		readOnlyBool = true
+	if mask&attrModel != 0 {
+		disk.Model = r.read(sysblock, dev, "device/model")
 	}
 
-	disk := &Disk{
-		DeviceName: fmt.Sprintf("/dev/%s", dev),
-		Size:       size,
-		Model:      readFile(sysblock, dev, "device/model"),
-		Name:       readFile(sysblock, dev, "device/name"),
-		Serial:     serial,
-		Modalias:   readFile(sysblock, dev, "device/modalias"),
-		WWID:       wwid,
-		UUID:       uuid,
-		Type:       diskType,
-		BusPath:    busPath,
-		ReadOnly:   readOnlyBool,
+	if mask&attrName != 0 {
+		disk.Name = r.read(sysblock, dev, "device/name")
+	}
+
+	if mask&attrModalias != 0 {
+		disk.Modalias = r.read(sysblock, dev, "device/modalias")
 	}
 
-	path, err := filepath.EvalSymlinks(filepath.Join(sysblock, dev, "subsystem"))
-	if err == nil {
-		disk.SubSystem = path
+	if mask&attrSubSystem != 0 {
+		path, err := filepath.EvalSymlinks(filepath.Join(sysblock, dev, "subsystem"))
+		if err == nil {
+			disk.SubSystem = path
+		}
 	}
 
 	return disk
@@ -235,14 +352,28 @@ func Get(dev string) *Disk {
 
 // Find disk matching provided spec.
 // string parameters may include wildcards.
+//
+// Only the attributes needed by the matchers are gathered for all disks,
+// the matching disk is returned with all attributes.
 func Find(matchers ...Matcher) (*Disk, error) {
-	disks, err := List()
+	mask := matcherAttributes(matchers)
+
+	disks, err := list(mask)
 	if err != nil {
 		return nil, err
 	}
 
 	for _, disk := range disks {
-		if Match(disk, matchers...) {
+		if !Match(disk, matchers...) {
+			continue
+		}
+
+		if mask == attrAll {
+			return disk, nil
+		}
+
+		// the matchers are checked again with all the attributes
+		if disk = Get(disk.DeviceName); Match(disk, matchers...) {
 			return disk, nil
 		}
 	}
@@ -251,62 +382,80 @@ func Find(matchers ...Matcher) (*Disk, error) {
 }
 
 // Matcher is a function that can handle some custom disk matching logic.
+//
+// Find and Inventory.Find gather only the disk attributes checked by the matchers returned
+// by the With* functions. They learn the attributes by calling each matcher once with a probe
+// disk, any other matcher gets all the attributes gathered. Custom matchers which call the
+// With* matchers get only the attributes of the matchers they call.
 type Matcher func(disk *Disk) bool
 
+// attributeMatcher creates a matcher which checks the disk attributes in the mask.
+func attributeMatcher(mask attribute, match Matcher) Matcher {
+	return func(d *Disk) bool {
+		if d.probe != nil {
+			*d.probe |= mask
+
+			return false
+		}
+
+		return match(d)
+	}
+}
+
 // WithType select disk with type.
 func WithType(t Type) Matcher {
-	return func(d *Disk) bool {
+	return attributeMatcher(attrType, func(d *Disk) bool {
 		return d.Type == t
-	}
+	})
 }
 
 // WithModel select disk with model.
 func WithModel(model string) Matcher {
-	return func(d *Disk) bool {
+	return attributeMatcher(attrModel, func(d *Disk) bool {
 		return glob.Glob(model, d.Model)
-	}
+	})
 }
 
 // WithName select disk with name.
 func WithName(name string) Matcher {
-	return func(d *Disk) bool {
+	return attributeMatcher(attrName, func(d *Disk) bool {
 		return glob.Glob(name, d.Name)
-	}
+	})
 }
 
 // WithSerial select disk with serial.
 func WithSerial(serial string) Matcher {
-	return func(d *Disk) bool {
+	return attributeMatcher(attrSerial, func(d *Disk) bool {
 		return glob.Glob(serial, d.Serial)
-	}
+	})
 }
 
 // WithModalias select disk with modalias.
 func WithModalias(modalias string) Matcher {
-	return func(d *Disk) bool {
+	return attributeMatcher(attrModalias, func(d *Disk) bool {
 		return glob.Glob(modalias, d.Modalias)
-	}
+	})
 }
 
 // WithWWID select disk with WWID.
 func WithWWID(wwid string) Matcher {
-	return func(d *Disk) bool {
+	return attributeMatcher(attrWWID, func(d *Disk) bool {
 		return glob.Glob(wwid, d.WWID)
-	}
+	})
 }
 
 // WithUUID select disk with UUID.
 func WithUUID(uuid string) Matcher {
-	return func(d *Disk) bool {
+	return attributeMatcher(attrUUID, func(d *Disk) bool {
 		return glob.Glob(uuid, d.UUID)
-	}
+	})
 }
 
 // WithBusPath select disk by it's full path.
 func WithBusPath(path string) Matcher {
-	return func(d *Disk) bool {
+	return attributeMatcher(attrBusPath, func(d *Disk) bool {
 		return glob.Glob(path, d.BusPath)
-	}
+	})
 }
 
 // Match checks if the disk matches the spec.
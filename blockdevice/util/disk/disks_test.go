@@ -8,7 +8,9 @@ import (
 	"fmt"
 	"os"
 	"testing"
+	"time"
 
+	"github.com/stretchr/testify/assert"
 	"github.com/stretchr/testify/suite"
 
 	"github.com/siderolabs/go-blockdevice/blockdevice/util/disk"
@@ -145,6 +147,63 @@ func (suite *DisksSuite) TestDiskMatcher() {
 	}
 }
 
+func (suite *DisksSuite) TestInventory() {
+	disks, err := disk.List()
+	suite.Require().NoError(err)
+
+	if len(disks) == 0 {
+		suite.T().Skip("no disks found")
+	}
+
+	inv := disk.NewInventory(time.Minute)
+
+	snapshot, err := inv.List()
+	suite.Require().NoError(err)
+	suite.Require().Equal(disks, snapshot)
+
+	// snapshot is reused
+	cached, err := inv.List()
+	suite.Require().NoError(err)
+	suite.Assert().Same(snapshot[0], cached[0])
+
+	d, err := inv.Find(disk.WithBusPath(disks[0].BusPath))
+	suite.Require().NoError(err)
+	suite.Assert().Same(snapshot[0], d)
+
+	// partial snapshot still returns all attributes
+	inv.Invalidate()
+
+	d, err = inv.Find(disk.WithBusPath(disks[0].BusPath))
+	suite.Require().NoError(err)
+	suite.Assert().Equal(disks[0], d)
+
+	d, err = disk.Find(disk.WithBusPath(disks[0].BusPath), disk.WithType(disks[0].Type))
+	suite.Require().NoError(err)
+	suite.Assert().Equal(disks[0], d)
+
+	// custom matchers are supported
+	d, err = inv.Find(func(d *disk.Disk) bool { return d.SubSystem == disks[0].SubSystem })
+	suite.Require().NoError(err)
+	suite.Assert().Equal(disks[0], d)
+}
+
+func TestMatcherAttributes(t *testing.T) {
+	t.Parallel()
+
+	custom := func(d *disk.Disk) bool { return d.SubSystem == "/sys/class/block" }
+
+	assert.False(t, disk.GathersAllAttributes(disk.WithType(disk.TypeSSD), disk.WithModel("WDC*")))
+	assert.True(t, disk.GathersAllAttributes(disk.WithType(disk.TypeSSD), custom))
+	assert.True(t, disk.GathersAllAttributes(disk.Matcher(custom)))
+
+	// the matcher still works after the attributes are learned
+	matcher := disk.WithModel("WDC*")
+
+	assert.False(t, disk.GathersAllAttributes(matcher))
+	assert.True(t, disk.Match(&disk.Disk{Model: "WDC  WDS100T2B0B"}, matcher))
+	assert.False(t, disk.Match(&disk.Disk{}, matcher))
+}
+
 func TestDisksSuite(t *testing.T) {
 	suite.Run(t, new(DisksSuite))
 }
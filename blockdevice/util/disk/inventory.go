@@ -0,0 +1,120 @@
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+package disk
+
+import (
+	"sync"
+	"time"
+)
+
+// Inventory keeps a snapshot of the disks, which is reused by List and Find calls.
+//
+// The snapshot is gathered again once it is older than the TTL, or after Invalidate.
+// Disks returned from the snapshot are shared, and they should not be modified.
+type Inventory struct {
+	mu sync.Mutex
+
+	ttl   time.Duration
+	disks []*Disk
+	mask  attribute
+	taken time.Time
+}
+
+// NewInventory creates an inventory with snapshots valid for the TTL.
+func NewInventory(ttl time.Duration) *Inventory {
+	return &Inventory{
+		ttl: ttl,
+	}
+}
+
+// List returns the disks from the snapshot.
+func (inv *Inventory) List() ([]*Disk, error) {
+	disks, _, err := inv.snapshot(attrAll)
+
+	return disks, err
+}
+
+// Find disk matching provided spec in the snapshot.
+//
+// If the snapshot doesn't have the attributes needed by the matchers, it is gathered again.
+func (inv *Inventory) Find(matchers ...Matcher) (*Disk, error) {
+	disks, mask, err := inv.snapshot(matcherAttributes(matchers))
+	if err != nil {
+		return nil, err
+	}
+
+	for _, disk := range disks {
+		if !Match(disk, matchers...) {
+			continue
+		}
+
+		if mask == attrAll {
+			return disk, nil
+		}
+
+		// the matchers are checked again with all the attributes
+		if disk = Get(disk.DeviceName); Match(disk, matchers...) {
+			return disk, nil
+		}
+	}
+
+	return nil, nil //nolint:nilnil
+}
+
+// Invalidate drops the snapshot.
+func (inv *Inventory) Invalidate() {
+	inv.mu.Lock()
+	defer inv.mu.Unlock()
+
+	inv.disks = nil
+	inv.mask = 0
+}
+
+// snapshot returns disks with at least the attributes in the mask.
+func (inv *Inventory) snapshot(mask attribute) ([]*Disk, attribute, error) {
+	inv.mu.Lock()
+	defer inv.mu.Unlock()
+
+	if inv.disks != nil && time.Since(inv.taken) < inv.ttl {
+		if inv.mask&mask == mask {
+			return inv.disks, inv.mask, nil
+		}
+
+		// keep the attributes gathered so far
+		mask |= inv.mask
+	}
+
+	taken := time.Now()
+
+	disks, err := list(mask)
+	if err != nil {
+		return nil, 0, err
+	}
+
+	inv.disks, inv.mask, inv.taken = disks, mask, taken
+
+	return disks, mask, nil
+}
+
+// matcherAttributes returns the attributes needed by the matchers, custom matchers need all attributes.
+//
+// The matchers are called with a probe disk, the With* matchers record the attributes they check.
+func matcherAttributes(matchers []Matcher) attribute {
+	var mask attribute
+
+	for _, match := range matchers {
+		var attrs attribute
+
+		match(&Disk{probe: &attrs})
+
+		if attrs == 0 {
+			return attrAll
+		}
+
+		mask |= attrs
+	}
+
+	return mask
+}
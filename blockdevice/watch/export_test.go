@@ -0,0 +1,21 @@
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+package watch
+
+// ReplaceIndex builds two indexes from the events, and returns the events of replacing
+// the first index with the second.
+func ReplaceIndex(from, to []Event) []Event {
+	idx, other := newIndex(), newIndex()
+
+	for i := range from {
+		idx.apply(&from[i])
+	}
+
+	for i := range to {
+		other.apply(&to[i])
+	}
+
+	return idx.replace(other)
+}
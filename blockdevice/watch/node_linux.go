@@ -0,0 +1,260 @@
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+package watch
+
+import (
+	"bytes"
+	"context"
+	"os"
+	"path/filepath"
+	"sync"
+	"unsafe"
+
+	"golang.org/x/sys/unix"
+)
+
+// WaitForNode waits until the path (e.g. a device node or a udev symlink) exists,
+// or the context is canceled.
+//
+// All pending waits in the process share a single inotify instance with one watch
+// per parent directory, so that the waiters wake up as soon as the node is created.
+// If inotify can't be used, the path is polled.
+func WaitForNode(ctx context.Context, path string) error {
+	w, err := getNodeWaiter()
+	if err != nil {
+		return pollNode(ctx, path)
+	}
+
+	ch, err := w.add(path)
+	if err != nil {
+		// e.g. the parent directory doesn't exist yet
+		return pollNode(ctx, path)
+	}
+
+	defer w.remove(path, ch)
+
+	for {
+		// checked after the watch is in place, so that the creation is never missed
+		exists, err := nodeExists(path)
+		if err != nil || exists {
+			return err
+		}
+
+		select {
+		case <-ctx.Done():
+			return ctx.Err()
+		case _, ok := <-ch:
+			if !ok {
+				return pollNode(ctx, path)
+			}
+		}
+	}
+}
+
+// nodeWaiter coalesces the waits for the paths into an inotify watch per directory.
+type nodeWaiter struct {
+	mu sync.Mutex
+
+	f  *os.File
+	fd int
+
+	// dirs maps the watched directory to the watch descriptor, and wds back
+	dirs map[string]int
+	wds  map[int]string
+
+	// waiters are the channels to notify per path
+	waiters map[string]map[chan struct{}]struct{}
+	// refs counts the waiters per watched directory
+	refs map[string]int
+
+	failed bool
+}
+
+var (
+	nodeWaiterOnce     sync.Once
+	nodeWaiterInstance *nodeWaiter
+	nodeWaiterErr      error
+)
+
+func getNodeWaiter() (*nodeWaiter, error) {
+	nodeWaiterOnce.Do(func() {
+		fd, err := unix.InotifyInit1(unix.IN_CLOEXEC | unix.IN_NONBLOCK)
+		if err != nil {
+			nodeWaiterErr = err
+
+			return
+		}
+
+		nodeWaiterInstance = &nodeWaiter{
+			f:       os.NewFile(uintptr(fd), "inotify"),
+			fd:      fd,
+			dirs:    map[string]int{},
+			wds:     map[int]string{},
+			waiters: map[string]map[chan struct{}]struct{}{},
+			refs:    map[string]int{},
+		}
+
+		go nodeWaiterInstance.run()
+	})
+
+	return nodeWaiterInstance, nodeWaiterErr
+}
+
+func (w *nodeWaiter) add(path string) (chan struct{}, error) {
+	path = filepath.Clean(path)
+	dir := filepath.Dir(path)
+
+	w.mu.Lock()
+	defer w.mu.Unlock()
+
+	if w.failed {
+		return nil, os.ErrClosed
+	}
+
+	if _, ok := w.dirs[dir]; !ok {
+		wd, err := unix.InotifyAddWatch(w.fd, dir, unix.IN_CREATE|unix.IN_MOVED_TO|unix.IN_ONLYDIR)
+		if err != nil {
+			return nil, err
+		}
+
+		w.dirs[dir] = wd
+		w.wds[wd] = dir
+	}
+
+	ch := make(chan struct{}, 1)
+
+	if w.waiters[path] == nil {
+		w.waiters[path] = map[chan struct{}]struct{}{}
+	}
+
+	w.waiters[path][ch] = struct{}{}
+	w.refs[dir]++
+
+	return ch, nil
+}
+
+func (w *nodeWaiter) remove(path string, ch chan struct{}) {
+	path = filepath.Clean(path)
+	dir := filepath.Dir(path)
+
+	w.mu.Lock()
+	defer w.mu.Unlock()
+
+	if w.failed {
+		return
+	}
+
+	delete(w.waiters[path], ch)
+
+	if len(w.waiters[path]) == 0 {
+		delete(w.waiters, path)
+	}
+
+	w.refs[dir]--
+
+	if w.refs[dir] > 0 {
+		return
+	}
+
+	delete(w.refs, dir)
+
+	if wd, ok := w.dirs[dir]; ok {
+		unix.InotifyRmWatch(w.fd, uint32(wd)) //nolint:errcheck
+
+		delete(w.dirs, dir)
+		delete(w.wds, wd)
+	}
+}
+
+// notify wakes up the waiters for the path, or all waiters if the path is empty.
+func (w *nodeWaiter) notify(path string) {
+	for p, chans := range w.waiters {
+		if path != "" && p != path {
+			continue
+		}
+
+		for ch := range chans {
+			select {
+			case ch <- struct{}{}:
+			default:
+			}
+		}
+	}
+}
+
+func (w *nodeWaiter) run() {
+	buf := make([]byte, 16*(unix.SizeofInotifyEvent+unix.NAME_MAX+1))
+
+	for {
+		n, err := w.f.Read(buf)
+		if err != nil {
+			w.fail()
+
+			return
+		}
+
+		w.mu.Lock()
+
+		for off := 0; off+unix.SizeofInotifyEvent <= n; {
+			ev := (*unix.InotifyEvent)(unsafe.Pointer(&buf[off]))
+			nameBytes := buf[off+unix.SizeofInotifyEvent : off+unix.SizeofInotifyEvent+int(ev.Len)]
+			off += unix.SizeofInotifyEvent + int(ev.Len)
+
+			if ev.Mask&unix.IN_Q_OVERFLOW != 0 {
+				// events were lost, let every waiter check its path
+				w.notify("")
+
+				continue
+			}
+
+			dir, ok := w.wds[int(ev.Wd)]
+			if !ok {
+				continue
+			}
+
+			if ev.Mask&unix.IN_IGNORED != 0 {
+				// the directory is gone, the waiters fall back to polling
+				delete(w.wds, int(ev.Wd))
+				delete(w.dirs, dir)
+				w.drop(dir)
+
+				continue
+			}
+
+			if i := bytes.IndexByte(nameBytes, 0); i >= 0 {
+				nameBytes = nameBytes[:i]
+			}
+
+			w.notify(filepath.Join(dir, string(nameBytes)))
+		}
+
+		w.mu.Unlock()
+	}
+}
+
+// fail drops all the waiters, new waits fall back to polling.
+func (w *nodeWaiter) fail() {
+	w.mu.Lock()
+	defer w.mu.Unlock()
+
+	w.failed = true
+	w.drop("")
+}
+
+// drop closes the channels of the waiters in the directory (or all waiters if dir is empty),
+// so that the pending waits fall back to polling.
+func (w *nodeWaiter) drop(dir string) {
+	for path, chans := range w.waiters {
+		if dir != "" && filepath.Dir(path) != dir {
+			continue
+		}
+
+		for ch := range chans {
+			close(ch)
+		}
+
+		delete(w.waiters, path)
+	}
+}
@@ -0,0 +1,273 @@
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+package watch
+
+import (
+	"bytes"
+	"path/filepath"
+	"sort"
+	"strconv"
+	"sync"
+
+	"github.com/siderolabs/go-blockdevice/blockdevice/util/disk"
+)
+
+// Action is the kind of the block device event.
+type Action string
+
+// Block device event actions.
+const (
+	ActionAdd    Action = "add"
+	ActionChange Action = "change"
+	ActionRemove Action = "remove"
+)
+
+// Device types.
+const (
+	DevTypeDisk      = "disk"
+	DevTypePartition = "partition"
+)
+
+// Event is a block device event.
+type Event struct {
+	Action Action
+	// DevName is the device node path, e.g. /dev/sda1.
+	DevName string
+	// DevPath is the sysfs path of the device relative to /sys.
+	DevPath string
+	// DevType is either DevTypeDisk or DevTypePartition.
+	DevType string
+	// Parent is the device name of the disk for partitions.
+	Parent string
+	// Partition is the partition number for partitions.
+	Partition int
+	// Disk is the disk information for disks, it is nil on remove.
+	Disk *disk.Disk
+}
+
+// Partition is a partition in the index.
+type Partition struct {
+	DevName string
+	Parent  string
+	Number  int
+}
+
+// index keeps the block devices known to the watcher.
+type index struct {
+	mu         sync.Mutex
+	disks      map[string]*disk.Disk
+	partitions map[string]Partition
+	// devpaths are the sysfs paths of the disks and partitions
+	devpaths map[string]string
+}
+
+func newIndex() *index {
+	return &index{
+		disks:      map[string]*disk.Disk{},
+		partitions: map[string]Partition{},
+		devpaths:   map[string]string{},
+	}
+}
+
+// apply updates the index with the event.
+func (idx *index) apply(ev *Event) {
+	idx.mu.Lock()
+	defer idx.mu.Unlock()
+
+	switch ev.DevType {
+	case DevTypeDisk:
+		if ev.Action == ActionRemove {
+			delete(idx.disks, ev.DevName)
+			delete(idx.devpaths, ev.DevName)
+
+			return
+		}
+
+		idx.disks[ev.DevName] = ev.Disk
+		idx.devpaths[ev.DevName] = ev.DevPath
+	case DevTypePartition:
+		if ev.Action == ActionRemove {
+			delete(idx.partitions, ev.DevName)
+			delete(idx.devpaths, ev.DevName)
+
+			return
+		}
+
+		idx.partitions[ev.DevName] = Partition{
+			DevName: ev.DevName,
+			Parent:  ev.Parent,
+			Number:  ev.Partition,
+		}
+		idx.devpaths[ev.DevName] = ev.DevPath
+	}
+}
+
+// replace replaces the contents of the index with the other index.
+//
+// The returned events turn the old contents into the new ones: the devices missing from
+// the other index are removed, the new ones are added, and the updated ones are changed.
+// Partitions are removed before and added after their disks.
+func (idx *index) replace(other *index) []Event {
+	idx.mu.Lock()
+	defer idx.mu.Unlock()
+
+	var events []Event
+
+	diskEvent := func(action Action, devname, devpath string, d *disk.Disk) {
+		events = append(events, Event{Action: action, DevName: devname, DevPath: devpath, DevType: DevTypeDisk, Disk: d})
+	}
+
+	partitionEvent := func(action Action, devpath string, p Partition) {
+		events = append(events, Event{
+			Action:    action,
+			DevName:   p.DevName,
+			DevPath:   devpath,
+			DevType:   DevTypePartition,
+			Parent:    p.Parent,
+			Partition: p.Number,
+		})
+	}
+
+	for _, name := range sortedKeys(idx.partitions) {
+		if _, ok := other.partitions[name]; !ok {
+			partitionEvent(ActionRemove, idx.devpaths[name], idx.partitions[name])
+		}
+	}
+
+	for _, name := range sortedKeys(idx.disks) {
+		if _, ok := other.disks[name]; !ok {
+			diskEvent(ActionRemove, name, idx.devpaths[name], nil)
+		}
+	}
+
+	for _, name := range sortedKeys(other.disks) {
+		d := other.disks[name]
+
+		old, ok := idx.disks[name]
+
+		switch {
+		case !ok:
+			diskEvent(ActionAdd, name, other.devpaths[name], d)
+		case diskChanged(old, d) || idx.devpaths[name] != other.devpaths[name]:
+			diskEvent(ActionChange, name, other.devpaths[name], d)
+		}
+	}
+
+	for _, name := range sortedKeys(other.partitions) {
+		p := other.partitions[name]
+
+		old, ok := idx.partitions[name]
+
+		switch {
+		case !ok:
+			partitionEvent(ActionAdd, other.devpaths[name], p)
+		case old != p || idx.devpaths[name] != other.devpaths[name]:
+			partitionEvent(ActionChange, other.devpaths[name], p)
+		}
+	}
+
+	idx.disks, idx.partitions, idx.devpaths = other.disks, other.partitions, other.devpaths
+
+	return events
+}
+
+func diskChanged(a, b *disk.Disk) bool {
+	if a == nil || b == nil {
+		return a != b
+	}
+
+	return *a != *b
+}
+
+func sortedKeys[V any](m map[string]V) []string {
+	keys := make([]string, 0, len(m))
+
+	for k := range m {
+		keys = append(keys, k)
+	}
+
+	sort.Strings(keys)
+
+	return keys
+}
+
+// Disks returns the disks in the index.
+func (w *Watcher) Disks() []*disk.Disk {
+	w.index.mu.Lock()
+	defer w.index.mu.Unlock()
+
+	disks := make([]*disk.Disk, 0, len(w.index.disks))
+
+	for _, d := range w.index.disks {
+		disks = append(disks, d)
+	}
+
+	return disks
+}
+
+// Disk returns the disk from the index by device name.
+func (w *Watcher) Disk(devname string) *disk.Disk {
+	w.index.mu.Lock()
+	defer w.index.mu.Unlock()
+
+	return w.index.disks[devname]
+}
+
+// Partitions returns the partitions of the disk in the index.
+func (w *Watcher) Partitions(parent string) []Partition {
+	w.index.mu.Lock()
+	defer w.index.mu.Unlock()
+
+	var partitions []Partition
+
+	for _, p := range w.index.partitions {
+		if p.Parent == parent {
+			partitions = append(partitions, p)
+		}
+	}
+
+	return partitions
+}
+
+// parseUevent parses the kernel uevent message.
+//
+// The message is "ACTION@DEVPATH" followed by "KEY=VALUE" pairs, all separated by NUL bytes.
+// Messages which are not block device events are ignored.
+func parseUevent(msg []byte) (*Event, bool) {
+	fields := bytes.Split(msg, []byte{0})
+	if len(fields) == 0 || !bytes.Contains(fields[0], []byte{'@'}) {
+		return nil, false
+	}
+
+	env := make(map[string]string, len(fields))
+
+	for _, field := range fields[1:] {
+		if k, v, ok := bytes.Cut(field, []byte{'='}); ok {
+			env[string(k)] = string(v)
+		}
+	}
+
+	if env["SUBSYSTEM"] != "block" || env["DEVNAME"] == "" {
+		return nil, false
+	}
+
+	ev := &Event{
+		Action:  Action(env["ACTION"]),
+		DevName: devName(env["DEVNAME"]),
+		DevPath: env["DEVPATH"],
+		DevType: env["DEVTYPE"],
+	}
+
+	if ev.DevType == DevTypePartition {
+		ev.Partition, _ = strconv.Atoi(env["PARTN"]) //nolint:errcheck
+		ev.Parent = devName(filepath.Base(filepath.Dir(ev.DevPath)))
+	}
+
+	return ev, true
+}
+
+func devName(name string) string {
+	return filepath.Join("/dev", name)
+}
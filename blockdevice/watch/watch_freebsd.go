@@ -0,0 +1,35 @@
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+package watch
+
+import (
+	"context"
+	"fmt"
+)
+
+// Watcher watches block device kernel events and keeps an index of the block devices.
+type Watcher struct {
+	index *index
+}
+
+// New subscribes to the kernel uevents and seeds the index from sysfs.
+func New() (*Watcher, error) {
+	return nil, fmt.Errorf("not implemented")
+}
+
+// Close closes the watcher.
+func (w *Watcher) Close() error {
+	return fmt.Errorf("not implemented")
+}
+
+// Run handles the events until the context is canceled or the watcher is closed.
+func (w *Watcher) Run(ctx context.Context, handler func(Event)) error {
+	return fmt.Errorf("not implemented")
+}
+
+// WaitForNode waits until the path exists, or the context is canceled.
+func WaitForNode(ctx context.Context, path string) error {
+	return pollNode(ctx, path)
+}
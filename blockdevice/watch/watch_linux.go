@@ -0,0 +1,169 @@
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+package watch
+
+import (
+	"bytes"
+	"context"
+	"errors"
+	"fmt"
+	"os"
+	"path/filepath"
+	"strings"
+
+	"golang.org/x/sys/unix"
+
+	"github.com/siderolabs/go-blockdevice/blockdevice/util/disk"
+)
+
+// Watcher watches block device kernel events and keeps an index of the block devices.
+type Watcher struct {
+	f     *os.File
+	index *index
+}
+
+// New subscribes to the kernel uevents and seeds the index from sysfs.
+func New() (*Watcher, error) {
+	fd, err := unix.Socket(unix.AF_NETLINK, unix.SOCK_DGRAM|unix.SOCK_CLOEXEC|unix.SOCK_NONBLOCK, unix.NETLINK_KOBJECT_UEVENT)
+	if err != nil {
+		return nil, fmt.Errorf("failed to create uevent socket: %w", err)
+	}
+
+	// kernel events are multicast to the group 1
+	if err = unix.Bind(fd, &unix.SockaddrNetlink{Family: unix.AF_NETLINK, Groups: 1}); err != nil {
+		unix.Close(fd) //nolint:errcheck
+
+		return nil, fmt.Errorf("failed to bind uevent socket: %w", err)
+	}
+
+	// a larger buffer avoids losing events when many devices appear at once
+	unix.SetsockoptInt(fd, unix.SOL_SOCKET, unix.SO_RCVBUFFORCE, 8*1024*1024) //nolint:errcheck
+
+	w := &Watcher{
+		f: os.NewFile(uintptr(fd), "uevent"),
+	}
+
+	// subscribe first, so that no device is missed between the scan and the events
+	if w.index, err = scan(); err != nil {
+		w.f.Close() //nolint:errcheck
+
+		return nil, err
+	}
+
+	return w, nil
+}
+
+// Close closes the watcher.
+func (w *Watcher) Close() error {
+	return w.f.Close()
+}
+
+// Run handles the events until the context is canceled or the watcher is closed.
+//
+// The index is updated before the handler is called, events are delivered in order.
+// If the kernel drops events because they are not read fast enough, the index is
+// rebuilt from sysfs, and the handler gets the add, remove and change events for
+// the differences between the old and the rebuilt index.
+func (w *Watcher) Run(ctx context.Context, handler func(Event)) error {
+	stop := make(chan struct{})
+	defer close(stop)
+
+	go func() {
+		select {
+		case <-ctx.Done():
+			w.f.Close() //nolint:errcheck
+		case <-stop:
+		}
+	}()
+
+	buf := make([]byte, 64*1024)
+
+	for {
+		n, err := w.f.Read(buf)
+		if err != nil {
+			if ctx.Err() != nil {
+				return ctx.Err()
+			}
+
+			if errors.Is(err, unix.ENOBUFS) {
+				var idx *index
+
+				if idx, err = scan(); err != nil {
+					return err
+				}
+
+				for _, ev := range w.index.replace(idx) {
+					if handler != nil {
+						handler(ev)
+					}
+				}
+
+				continue
+			}
+
+			if errors.Is(err, os.ErrClosed) {
+				return nil
+			}
+
+			return fmt.Errorf("error reading uevent: %w", err)
+		}
+
+		ev, ok := parseUevent(buf[:n])
+		if !ok {
+			continue
+		}
+
+		if ev.DevType == DevTypeDisk && ev.Action != ActionRemove {
+			ev.Disk = disk.Get(ev.DevName)
+		}
+
+		w.index.apply(ev)
+
+		if handler != nil {
+			handler(*ev)
+		}
+	}
+}
+
+// scan builds the index from /sys/class/block.
+func scan() (*index, error) {
+	sysclass := "/sys/class/block"
+
+	entries, err := os.ReadDir(sysclass)
+	if err != nil {
+		return nil, fmt.Errorf("failed to read %s: %w", sysclass, err)
+	}
+
+	idx := newIndex()
+
+	for _, entry := range entries {
+		path, err := filepath.EvalSymlinks(filepath.Join(sysclass, entry.Name()))
+		if err != nil {
+			continue
+		}
+
+		data, err := os.ReadFile(filepath.Join(path, "uevent"))
+		if err != nil {
+			continue
+		}
+
+		// uevent file has the same variables as the event, one per line
+		msg := append([]byte("add@\x00ACTION=add\x00SUBSYSTEM=block\x00DEVPATH="+strings.TrimPrefix(path, "/sys")+"\x00"),
+			bytes.ReplaceAll(data, []byte{'\n'}, []byte{0})...)
+
+		ev, ok := parseUevent(msg)
+		if !ok {
+			continue
+		}
+
+		if ev.DevType == DevTypeDisk {
+			ev.Disk = disk.Get(ev.DevName)
+		}
+
+		idx.apply(ev)
+	}
+
+	return idx, nil
+}
@@ -0,0 +1,221 @@
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+package watch_test
+
+import (
+	"context"
+	"os"
+	"path/filepath"
+	"testing"
+	"time"
+
+	"github.com/stretchr/testify/assert"
+	"github.com/stretchr/testify/require"
+	"github.com/stretchr/testify/suite"
+
+	"github.com/siderolabs/go-blockdevice/blockdevice/partition/gpt"
+	"github.com/siderolabs/go-blockdevice/blockdevice/test"
+	"github.com/siderolabs/go-blockdevice/blockdevice/util/disk"
+	"github.com/siderolabs/go-blockdevice/blockdevice/watch"
+)
+
+type WatchSuite struct {
+	test.BlockDeviceSuite
+}
+
+func (suite *WatchSuite) SetupTest() {
+	suite.CreateBlockDevice(256 * 1024 * 1024)
+}
+
+func (suite *WatchSuite) TestPartitionEvents() {
+	w, err := watch.New()
+	suite.Require().NoError(err)
+
+	defer w.Close() //nolint:errcheck
+
+	devname := suite.LoopbackDevice.Name()
+
+	// the index is seeded with existing devices
+	suite.Require().NotNil(w.Disk(devname))
+	suite.Assert().Empty(w.Partitions(devname))
+
+	ctx, cancel := context.WithCancel(context.Background())
+	defer cancel()
+
+	events := make(chan watch.Event, 64)
+	errCh := make(chan error, 1)
+
+	go func() {
+		errCh <- w.Run(ctx, func(ev watch.Event) { events <- ev })
+	}()
+
+	g, err := gpt.New(suite.Dev)
+	suite.Require().NoError(err)
+
+	_, err = g.Add(16*1024*1024, gpt.WithPartitionName("boot"))
+	suite.Require().NoError(err)
+
+	suite.Require().NoError(g.Write())
+
+	timeout := time.After(10 * time.Second)
+
+	for {
+		var ev watch.Event
+
+		select {
+		case ev = <-events:
+		case <-timeout:
+			suite.Require().Fail("timed out waiting for the partition event")
+		}
+
+		if ev.Action != watch.ActionAdd || ev.DevType != watch.DevTypePartition || ev.Parent != devname {
+			continue
+		}
+
+		suite.Assert().EqualValues(1, ev.Partition)
+
+		break
+	}
+
+	partitions := w.Partitions(devname)
+	suite.Require().Len(partitions, 1)
+	suite.Assert().Equal(1, partitions[0].Number)
+
+	cancel()
+
+	suite.Require().ErrorIs(<-errCh, context.Canceled)
+}
+
+func TestWatchSuite(t *testing.T) {
+	if os.Getuid() != 0 {
+		t.Skip("can't run the test as non-root")
+	}
+
+	suite.Run(t, new(WatchSuite))
+}
+
+func TestReplaceIndex(t *testing.T) {
+	t.Parallel()
+
+	sda := watch.Event{Action: watch.ActionAdd, DevName: "/dev/sda", DevPath: "/devices/sda", DevType: watch.DevTypeDisk, Disk: &disk.Disk{Size: 1024}}
+	sda1 := watch.Event{
+		Action: watch.ActionAdd, DevName: "/dev/sda1", DevPath: "/devices/sda/sda1", DevType: watch.DevTypePartition,
+		Parent: "/dev/sda", Partition: 1,
+	}
+	sdb := watch.Event{Action: watch.ActionAdd, DevName: "/dev/sdb", DevPath: "/devices/sdb", DevType: watch.DevTypeDisk, Disk: &disk.Disk{Size: 2048}}
+	sdb1 := watch.Event{
+		Action: watch.ActionAdd, DevName: "/dev/sdb1", DevPath: "/devices/sdb/sdb1", DevType: watch.DevTypePartition,
+		Parent: "/dev/sdb", Partition: 1,
+	}
+
+	resized := sda
+	resized.Disk = &disk.Disk{Size: 4096}
+
+	renumbered := sda1
+	renumbered.Partition = 2
+
+	removed := func(ev watch.Event) watch.Event {
+		ev.Action = watch.ActionRemove
+		ev.Disk = nil
+
+		return ev
+	}
+
+	changed := func(ev watch.Event) watch.Event {
+		ev.Action = watch.ActionChange
+
+		return ev
+	}
+
+	for _, tc := range []struct { //nolint:govet
+		name     string
+		from, to []watch.Event
+		expected []watch.Event
+	}{
+		{
+			name: "unchanged",
+			from: []watch.Event{sda, sda1},
+			to:   []watch.Event{sda, sda1},
+		},
+		{
+			name:     "added",
+			from:     []watch.Event{sda},
+			to:       []watch.Event{sda, sdb1, sdb},
+			expected: []watch.Event{sdb, sdb1},
+		},
+		{
+			name:     "removed",
+			from:     []watch.Event{sda, sda1, sdb},
+			to:       []watch.Event{sdb},
+			expected: []watch.Event{removed(sda1), removed(sda)},
+		},
+		{
+			name:     "changed",
+			from:     []watch.Event{sda, sda1},
+			to:       []watch.Event{resized, renumbered},
+			expected: []watch.Event{changed(resized), changed(renumbered)},
+		},
+		{
+			name:     "replaced",
+			from:     []watch.Event{sda, sda1},
+			to:       []watch.Event{sdb, sdb1},
+			expected: []watch.Event{removed(sda1), removed(sda), sdb, sdb1},
+		},
+	} {
+		tc := tc
+
+		t.Run(tc.name, func(t *testing.T) {
+			t.Parallel()
+
+			assert.Equal(t, tc.expected, watch.ReplaceIndex(tc.from, tc.to))
+		})
+	}
+}
+
+func TestWaitForNode(t *testing.T) {
+	dir := t.TempDir()
+
+	ctx, cancel := context.WithTimeout(context.Background(), 5*time.Second)
+	defer cancel()
+
+	errCh := make(chan error, 3)
+
+	// several waiters for the same and different paths share the watch
+	for _, name := range []string{"node1", "node1", "node2"} {
+		name := name
+
+		go func() {
+			errCh <- watch.WaitForNode(ctx, filepath.Join(dir, name))
+		}()
+	}
+
+	time.Sleep(100 * time.Millisecond)
+
+	for _, name := range []string{"node1", "node2"} {
+		require.NoError(t, os.WriteFile(filepath.Join(dir, name), nil, 0o600))
+	}
+
+	for i := 0; i < 3; i++ {
+		require.NoError(t, <-errCh)
+	}
+
+	// existing path returns immediately
+	require.NoError(t, watch.WaitForNode(ctx, filepath.Join(dir, "node1")))
+
+	shortCtx, shortCancel := context.WithTimeout(context.Background(), 100*time.Millisecond)
+	defer shortCancel()
+
+	assert.ErrorIs(t, watch.WaitForNode(shortCtx, filepath.Join(dir, "missing")), context.DeadlineExceeded)
+
+	// missing parent directory falls back to polling
+	go func() {
+		time.Sleep(100 * time.Millisecond)
+
+		errCh <- os.MkdirAll(filepath.Join(dir, "sub", "node"), 0o700)
+	}()
+
+	require.NoError(t, watch.WaitForNode(ctx, filepath.Join(dir, "sub", "node")))
+	require.NoError(t, <-errCh)
+}